@@ -11,7 +11,9 @@ workspace "mta-navigation"
 
     defines {  
         "_CRT_SECURE_NO_WARNINGS",
-        "NAVIGATION_EXPORT"
+        "NAVIGATION_EXPORT",
+        -- dtQueryFilter::passFilter and getCost are called outside DetourNavMeshQuery.cpp, where they are otherwise inline
+        "DT_VIRTUAL_QUERYFILTER"
     }
 
     newoption {
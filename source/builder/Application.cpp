@@ -81,9 +81,11 @@ bool Application::Run()
         }    
 
         // Remove specific models
+        const std::unordered_set<int32_t> noInteriors;
         const PlacementModifier placementModifier = {
             .ignoredModels_ = IGNORED_MODELS,
-            .excludedInteriors_ = EXCLUDED_INTERIORS
+            .excludedInteriors_ = params_.keepInteriors_ ? noInteriors : EXCLUDED_INTERIORS,
+            .keepInteriors_ = params_.keepInteriors_
         };
         const size_t nodesRemoved = game_->ApplyPlacementModifier(placementModifier);
         spdlog::info("{} nodes removed", nodesRemoved);
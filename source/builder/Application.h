@@ -12,6 +12,8 @@ struct ApplicationParameters
 {
 	std::filesystem::path gamePath_;
 	std::filesystem::path outputPath_;
+	// Keep interior placements, so navigation meshes of interiors can be built on demand.
+	bool keepInteriors_{};
 };
 
 class Application
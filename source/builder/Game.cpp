@@ -58,6 +58,12 @@ std::size_t Game::ApplyPlacementModifier(const PlacementModifier& modifier)
 		return modifier.ignoredModels_.contains(placement.model_) || modifier.excludedInteriors_.contains(placement.interior_);
 	});
 
+	if (!modifier.keepInteriors_) {
+		for (auto& placement : placements_) {
+			placement.interior_ = 0;
+		}
+	}
+
 	return count;
 }
 
@@ -91,9 +97,8 @@ std::shared_ptr<World> Game::CreateWorld()
 		transform[3][1] = placement.z_;
 		transform[3][2] = placement.y_;
 
-		SceneNode* node = scene->AddNode(placement.model_, transform);
+		SceneNode* node = scene->AddNode(placement.model_, transform, placement.interior_);
 		if (node) {
-			node->SetInterior(placement.interior_);
 			node->SetFlags(placement.flags_);
 		}
 	}	
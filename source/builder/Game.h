@@ -38,6 +38,8 @@ struct PlacementModifier
 	const std::unordered_set<uint32_t>& ignoredModels_;
 	const std::unordered_set<int32_t>& excludedInteriors_;
 	bool excludeLODs_{ true };
+	// Keep the interior of the remaining placements, otherwise they are all moved to interior 0 and built into the default navigation mesh.
+	bool keepInteriors_{};
 };
 
 class Game
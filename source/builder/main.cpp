@@ -11,6 +11,7 @@ int main(int argc, char *argv[])
         ("h,help", "Print help and exit.")
         ("o,output", "Output directory.", cxxopts::value<std::string>())
         ("g,game", "GTA:SA folder.", cxxopts::value<std::string>())
+        ("i,interiors", "Keep interior placements.")
         ;
 
     const auto result = options.parse(argc, argv);
@@ -23,6 +24,7 @@ int main(int argc, char *argv[])
     ApplicationParameters parameters;
     parameters.gamePath_ = result["game"].as<std::string>();
     parameters.outputPath_ = result["output"].as<std::string>();
+    parameters.keepInteriors_ = result.count("interiors") > 0;
 
     Application app(parameters);
     app.Run();
@@ -2,6 +2,14 @@
 
 #include <spdlog/spdlog.h>
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #define COLLISION_UNPACK_SSE2
+    #include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+    #define COLLISION_UNPACK_NEON
+    #include <arm_neon.h>
+#endif
+
 #define PACK_COORDINATE(x) (static_cast<int16_t>(x * 128.0f))
 #define UNPACK_COORDINATE(x) (static_cast<float>(static_cast<float>(x) / 128.0f))
 
@@ -10,6 +18,102 @@ namespace WorldAssistant
 
 namespace
 {
+    static_assert(sizeof(Vector3F) == 12, "Vertices are written as packed float triples");
+
+    // Scale of UNPACK_COORDINATE, a power of two so multiplying by it gives the same result as the division.
+    const float UNPACK_SCALE = 1.0f / 128.0f;
+
+    // Dequantize and transform vertices one at a time. Sums are taken in the order glm uses for mat4 * vec4, all kernels produce the same bits.
+    void UnpackVerticesScalar(const ColVertex* source, std::size_t count, const glm::mat4& transform, Vector3F* dest)
+    {
+        for (std::size_t i = 0; i < count; ++i) {
+            const float x = static_cast<float>(source[i].x_) * UNPACK_SCALE;
+            const float y = static_cast<float>(source[i].y_) * UNPACK_SCALE;
+            const float z = static_cast<float>(source[i].z_) * UNPACK_SCALE;
+
+            dest[i].x_ = (transform[0][0] * x + transform[1][0] * y) + (transform[2][0] * z + transform[3][0]);
+            dest[i].y_ = (transform[0][1] * x + transform[1][1] * y) + (transform[2][1] * z + transform[3][1]);
+            dest[i].z_ = (transform[0][2] * x + transform[1][2] * y) + (transform[2][2] * z + transform[3][2]);
+        }
+    }
+
+#if defined(COLLISION_UNPACK_SSE2)
+    // Dequantize and transform vertices four at a time, one vertex per register with the matrix columns as operands.
+    void UnpackVertices(const ColVertex* source, std::size_t count, const glm::mat4& transform, Vector3F* dest)
+    {
+        const __m128 c0 = _mm_loadu_ps(&transform[0][0]);
+        const __m128 c1 = _mm_loadu_ps(&transform[1][0]);
+        const __m128 c2 = _mm_loadu_ps(&transform[2][0]);
+        const __m128 c3 = _mm_loadu_ps(&transform[3][0]);
+        const __m128 scale = _mm_set1_ps(UNPACK_SCALE);
+
+        std::size_t i = 0;
+        for (; i + 4 <= count; i += 4) {
+            // Twelve coordinates of four vertices, sign-extended to 32 bits
+            const auto* packed = reinterpret_cast<const std::uint8_t*>(source + i);
+            const __m128i low = _mm_loadu_si128(reinterpret_cast<const __m128i*>(packed));
+            const __m128i high = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(packed + 16));
+            const __m128 a = _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(low, low), 16)), scale);   // x0 y0 z0 x1
+            const __m128 b = _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(low, low), 16)), scale);   // y1 z1 x2 y2
+            const __m128 c = _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(high, high), 16)), scale); // z2 x3 y3 z3
+
+            const auto transformVertex = [&](__m128 x, __m128 y, __m128 z) {
+                return _mm_add_ps(_mm_add_ps(_mm_mul_ps(c0, x), _mm_mul_ps(c1, y)), _mm_add_ps(_mm_mul_ps(c2, z), c3));
+            };
+
+            const __m128 r0 = transformVertex(_mm_shuffle_ps(a, a, _MM_SHUFFLE(0, 0, 0, 0)), _mm_shuffle_ps(a, a, _MM_SHUFFLE(1, 1, 1, 1)),
+                _mm_shuffle_ps(a, a, _MM_SHUFFLE(2, 2, 2, 2)));
+            const __m128 r1 = transformVertex(_mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 3, 3, 3)), _mm_shuffle_ps(b, b, _MM_SHUFFLE(0, 0, 0, 0)),
+                _mm_shuffle_ps(b, b, _MM_SHUFFLE(1, 1, 1, 1)));
+            const __m128 r2 = transformVertex(_mm_shuffle_ps(b, b, _MM_SHUFFLE(2, 2, 2, 2)), _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 3, 3, 3)),
+                _mm_shuffle_ps(c, c, _MM_SHUFFLE(0, 0, 0, 0)));
+            const __m128 r3 = transformVertex(_mm_shuffle_ps(c, c, _MM_SHUFFLE(1, 1, 1, 1)), _mm_shuffle_ps(c, c, _MM_SHUFFLE(2, 2, 2, 2)),
+                _mm_shuffle_ps(c, c, _MM_SHUFFLE(3, 3, 3, 3)));
+
+            // Drop the w lanes: x0 y0 z0 x1 | y1 z1 x2 y2 | z2 x3 y3 z3
+            const __m128 t0 = _mm_shuffle_ps(r0, r1, _MM_SHUFFLE(0, 0, 2, 2));
+            const __m128 t2 = _mm_shuffle_ps(r2, r3, _MM_SHUFFLE(0, 0, 2, 2));
+
+            float* out = &dest[i].x_;
+            _mm_storeu_ps(out, _mm_shuffle_ps(r0, t0, _MM_SHUFFLE(2, 0, 1, 0)));
+            _mm_storeu_ps(out + 4, _mm_shuffle_ps(r1, r2, _MM_SHUFFLE(1, 0, 2, 1)));
+            _mm_storeu_ps(out + 8, _mm_shuffle_ps(t2, r3, _MM_SHUFFLE(2, 1, 2, 0)));
+        }
+
+        UnpackVerticesScalar(source + i, count - i, transform, dest + i);
+    }
+#elif defined(COLLISION_UNPACK_NEON)
+    // Dequantize and transform vertices four at a time, the coordinates deinterleaved so every register holds one axis of four vertices.
+    void UnpackVertices(const ColVertex* source, std::size_t count, const glm::mat4& transform, Vector3F* dest)
+    {
+        const float32x4_t scale = vdupq_n_f32(UNPACK_SCALE);
+
+        std::size_t i = 0;
+        for (; i + 4 <= count; i += 4) {
+            const int16x4x3_t packed = vld3_s16(reinterpret_cast<const std::int16_t*>(source + i));
+            const float32x4_t x = vmulq_f32(vcvtq_f32_s32(vmovl_s16(packed.val[0])), scale);
+            const float32x4_t y = vmulq_f32(vcvtq_f32_s32(vmovl_s16(packed.val[1])), scale);
+            const float32x4_t z = vmulq_f32(vcvtq_f32_s32(vmovl_s16(packed.val[2])), scale);
+
+            // Separate multiplies and adds, a fused multiply-add would round differently from the other kernels
+            float32x4x3_t result;
+            for (int axis = 0; axis < 3; ++axis) {
+                result.val[axis] = vaddq_f32(vaddq_f32(vmulq_n_f32(x, transform[0][axis]), vmulq_n_f32(y, transform[1][axis])),
+                    vaddq_f32(vmulq_n_f32(z, transform[2][axis]), vdupq_n_f32(transform[3][axis])));
+            }
+
+            vst3q_f32(&dest[i].x_, result);
+        }
+
+        UnpackVerticesScalar(source + i, count - i, transform, dest + i);
+    }
+#else
+    void UnpackVertices(const ColVertex* source, std::size_t count, const glm::mat4& transform, Vector3F* dest)
+    {
+        UnpackVerticesScalar(source, count, transform, dest);
+    }
+#endif
+
     std::size_t GetIndicesNum(const std::vector<ColFace>& faces)
     {
         if (faces.size() < 1) {
@@ -237,17 +341,20 @@ void Collision::Unpack(std::vector<Vector3F>& vertices, std::vector<std::int32_t
         indices.clear();
     }
 
-    for (const auto& vertex : vertices_) {
-        glm::vec4 pos(UNPACK_COORDINATE(vertex.x_), UNPACK_COORDINATE(vertex.y_), UNPACK_COORDINATE(vertex.z_), 1.0f);
-        pos = transform * pos;
+    // Outputs are grown once and written in place
+    const std::size_t vertexStart = vertices.size();
+    vertices.resize(vertexStart + vertices_.size());
+    UnpackVertices(vertices_.data(), vertices_.size(), transform, vertices.data() + vertexStart);
 
-        vertices.push_back(Vector3F(pos.x, pos.y, pos.z));
-    }
+    const std::size_t indexStart = indices.size();
+    indices.resize(indexStart + faces_.size() * 3);
 
+    std::int32_t* index = indices.data() + indexStart;
     for (const auto& face : faces_) {
-        indices.push_back(startIndex + static_cast<std::int32_t>(face.a_));
-        indices.push_back(startIndex + static_cast<std::int32_t>(face.b_));
-        indices.push_back(startIndex + static_cast<std::int32_t>(face.c_));
+        index[0] = startIndex + static_cast<std::int32_t>(face.a_);
+        index[1] = startIndex + static_cast<std::int32_t>(face.b_);
+        index[2] = startIndex + static_cast<std::int32_t>(face.c_);
+        index += 3;
     }
 }
 
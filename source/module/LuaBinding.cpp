@@ -4,14 +4,143 @@
 #include "../navigation/DynamicNavigationMesh.h"
 
 #ifdef EXPORT_LUA_API
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <string>
+#include <unordered_map>
+
 #include "module-sdk/extra/CLuaArguments.h"
 
+#include <spdlog/spdlog.h>
+
 #pragma warning( push )
 #pragma warning( disable : 4244 )
 
 namespace WorldAssistant
 {
 
+namespace
+{
+
+// Lua function waiting for an asynchronous request.
+struct LuaCallback
+{
+    lua_State* luaVM_{};
+    int ref_{};
+};
+
+std::unordered_map<unsigned, LuaCallback> PATH_CALLBACKS;
+
+std::vector<PathResult> FINISHED_PATHS;
+
+// Resource owning each crowd agent.
+std::unordered_map<unsigned, lua_State*> CROWD_AGENTS;
+
+// Time of the previous pulse.
+std::chrono::steady_clock::time_point LAST_PULSE;
+
+// Scratch memory of the batched queries, reused across calls.
+std::vector<NavigationPathRequest> BATCH_REQUESTS;
+std::vector<std::vector<Vector3F>> BATCH_PATHS;
+std::vector<Vector3F> BATCH_POINTS;
+std::vector<Vector3F> BATCH_NEAREST_POINTS;
+std::vector<dtPolyRef> BATCH_NEAREST_REFS;
+std::vector<NavigationRaycastResult> BATCH_RAYCASTS;
+
+// Largest number of random points one navRandomPoints call picks. Other batches are bounded by the table they are given.
+constexpr double MAX_RANDOM_POINTS = 65536.0;
+
+// Push a flat table of points and their polygons in the { x1, y1, z1, ref1, x2, ... } format.
+void PushPointsWithRefs(lua_State* luaVM, const std::vector<Vector3F>& points, const std::vector<dtPolyRef>& refs)
+{
+    const int pointsNum = static_cast<int>(points.size());
+
+    lua_createtable(luaVM, pointsNum * 4, 0);
+
+    for (int i = 0; i < pointsNum; ++i) {
+        const Vector3F& point = points[i];
+
+        lua_pushnumber(luaVM, point.x_);
+        lua_rawseti(luaVM, -2, i * 4 + 1);
+        lua_pushnumber(luaVM, point.z_);
+        lua_rawseti(luaVM, -2, i * 4 + 2);
+        lua_pushnumber(luaVM, point.y_);
+        lua_rawseti(luaVM, -2, i * 4 + 3);
+        lua_pushnumber(luaVM, refs[i]);
+        lua_rawseti(luaVM, -2, i * 4 + 4);
+    }
+}
+
+// Push a table of points in the { { x, y, z }, ... } format.
+void PushPath(lua_State* luaVM, const std::vector<Vector3F>& path)
+{
+    lua_createtable(luaVM, static_cast<int>(path.size()), 0);
+
+    for (size_t i = 0; i < path.size(); ++i) {
+        const Vector3F& point = path[i];
+
+		lua_createtable(luaVM, 3, 0);
+		lua_pushnumber(luaVM, point.x_);
+		lua_rawseti(luaVM, -2, 1);
+		lua_pushnumber(luaVM, point.z_);
+		lua_rawseti(luaVM, -2, 2);
+		lua_pushnumber(luaVM, point.y_);
+		lua_rawseti(luaVM, -2, 3);
+
+		lua_rawseti(luaVM, -2, static_cast<int>(i + 1));      /* Stores the point in the table */
+    }
+}
+
+// Push a table of the agent in the { x, y, z, vx, vy, vz, state } format.
+void PushAgent(lua_State* luaVM, const CrowdAgent& agent)
+{
+    const float values[] = {
+        agent.position_.x_, agent.position_.z_, agent.position_.y_,
+        agent.velocity_.x_, agent.velocity_.z_, agent.velocity_.y_,
+        static_cast<float>(agent.state_)
+    };
+
+    lua_createtable(luaVM, 7, 0);
+    for (int i = 0; i < 7; ++i) {
+        lua_pushnumber(luaVM, values[i]);
+        lua_rawseti(luaVM, -2, i + 1);
+    }
+}
+
+// Return the profile name at the stack index, empty for the default profile.
+std::string ReadProfile(lua_State* luaVM, int index)
+{
+    if (lua_type(luaVM, index) != LUA_TSTRING) {
+        return {};
+    }
+
+    return lua_tostring(luaVM, index);
+}
+
+// Return crowd of the agent if the calling resource added it, null otherwise.
+Crowd* FindOwnedAgentCrowd(lua_State* luaVM, unsigned agent)
+{
+    auto found = CROWD_AGENTS.find(agent);
+    if (found == CROWD_AGENTS.end() || found->second != luaVM) {
+        return nullptr;
+    }
+
+    return Navigation::GetInstance().FindAgentCrowd(agent);
+}
+
+// Read a number from the table at the top of the stack.
+float ReadTableNumber(lua_State* luaVM, int index)
+{
+    lua_rawgeti(luaVM, -1, index);
+    const float value = static_cast<float>(lua_tonumber(luaVM, -1));
+    lua_pop(luaVM, 1);
+    return value;
+}
+
+}
+
 int LuaBinding::navState(lua_State* luaVM)
 {
     bool state{};
@@ -57,14 +186,49 @@ int LuaBinding::navSave(lua_State* luaVM)
     return 1;
 }
 
+int LuaBinding::navAddProfile(lua_State* luaVM)
+{
+    if (lua_gettop(luaVM) != 5 || lua_type(luaVM, 1) != LUA_TSTRING) {
+        return luaL_error(luaVM, "expecting a profile name, agent radius, height, maximum climb and maximum slope");
+    }
+
+    NavigationProfile profile;
+    profile.name_ = lua_tostring(luaVM, 1);
+    profile.agentRadius_ = static_cast<float>(lua_tonumber(luaVM, 2));
+    profile.agentHeight_ = static_cast<float>(lua_tonumber(luaVM, 3));
+    profile.agentMaxClimb_ = static_cast<float>(lua_tonumber(luaVM, 4));
+    profile.agentMaxSlope_ = static_cast<float>(lua_tonumber(luaVM, 5));
+
+    auto& navigation = Navigation::GetInstance();
+
+    lua_pushboolean(luaVM, navigation.AddProfile(profile));
+    return 1;
+}
+
+int LuaBinding::navAddInstance(lua_State* luaVM)
+{
+    if ((lua_gettop(luaVM) != 3 && lua_gettop(luaVM) != 4) || lua_type(luaVM, 1) != LUA_TSTRING) {
+        return luaL_error(luaVM, "expecting an instance name, interior, dimension and optionally a profile");
+    }
+
+    const std::string name = lua_tostring(luaVM, 1);
+    const std::int32_t interior = static_cast<std::int32_t>(lua_tonumber(luaVM, 2));
+    const std::int32_t dimension = static_cast<std::int32_t>(lua_tonumber(luaVM, 3));
+
+    auto& navigation = Navigation::GetInstance();
+
+    lua_pushboolean(luaVM, navigation.AddInstance(name, interior, dimension, ReadProfile(luaVM, 4)));
+    return 1;
+}
+
 int LuaBinding::navFindPath(lua_State* luaVM)
 {
-    if (lua_gettop(luaVM) != 6) {
-        return luaL_error(luaVM, "expecting exactly 6 arguments");
+    if (lua_gettop(luaVM) != 6 && lua_gettop(luaVM) != 7) {
+        return luaL_error(luaVM, "expecting 6 numbers and optionally a profile");
     }
 
     auto& navigation = Navigation::GetInstance();
-    auto* navmesh = navigation.GetNavMesh();
+    auto* navmesh = navigation.GetNavMesh(ReadProfile(luaVM, 7));
     if (!navmesh) {
         lua_pushboolean(luaVM, false);
         return 1;
@@ -74,12 +238,12 @@ int LuaBinding::navFindPath(lua_State* luaVM)
 	Vector3F pointEnd;
 	Vector3F extents(2.0f, 2.0f, 2.0f);
 
-	pointStart.x_ = static_cast<float>(lua_tonumber(luaVM, -6));
-	pointStart.z_ = static_cast<float>(lua_tonumber(luaVM, -5));
-	pointStart.y_ = static_cast<float>(lua_tonumber(luaVM, -4));
-	pointEnd.x_ = static_cast<float>(lua_tonumber(luaVM, -3));
-	pointEnd.z_ = static_cast<float>(lua_tonumber(luaVM, -2));
-	pointEnd.y_ = static_cast<float>(lua_tonumber(luaVM, -1));
+	pointStart.x_ = static_cast<float>(lua_tonumber(luaVM, 1));
+	pointStart.z_ = static_cast<float>(lua_tonumber(luaVM, 2));
+	pointStart.y_ = static_cast<float>(lua_tonumber(luaVM, 3));
+	pointEnd.x_ = static_cast<float>(lua_tonumber(luaVM, 4));
+	pointEnd.z_ = static_cast<float>(lua_tonumber(luaVM, 5));
+	pointEnd.y_ = static_cast<float>(lua_tonumber(luaVM, 6));
 
     std::vector<Vector3F> path;
     navmesh->FindPath(path, pointStart, pointEnd, extents);
@@ -89,39 +253,373 @@ int LuaBinding::navFindPath(lua_State* luaVM)
         return 1;
     }
 
-    lua_newtable(luaVM);
+    PushPath(luaVM, path);
+      
+    return 1;
+}
 
-    for (size_t i = 0; i < path.size(); ++i) {
-        const Vector3F& point = path[i];
+int LuaBinding::navFindPathAsync(lua_State* luaVM)
+{
+    if ((lua_gettop(luaVM) != 7 && lua_gettop(luaVM) != 8) || lua_type(luaVM, 7) != LUA_TFUNCTION) {
+        return luaL_error(luaVM, "expecting 6 numbers, a callback function and optionally a profile");
+    }
 
-		lua_pushnumber(luaVM, i + 1);   /* Push the table index */
+    Vector3F pointStart;
+	Vector3F pointEnd;
+	Vector3F extents(2.0f, 2.0f, 2.0f);
 
-		lua_newtable(luaVM);
-		lua_pushnumber(luaVM, 1);
-		lua_pushnumber(luaVM, point.x_);
-		lua_rawset(luaVM, -3);
-		lua_pushnumber(luaVM, 2);
-		lua_pushnumber(luaVM, point.z_);
-		lua_rawset(luaVM, -3);
-		lua_pushnumber(luaVM, 3);
-		lua_pushnumber(luaVM, point.y_);
-		lua_rawset(luaVM, -3);
+	pointStart.x_ = static_cast<float>(lua_tonumber(luaVM, 1));
+	pointStart.z_ = static_cast<float>(lua_tonumber(luaVM, 2));
+	pointStart.y_ = static_cast<float>(lua_tonumber(luaVM, 3));
+	pointEnd.x_ = static_cast<float>(lua_tonumber(luaVM, 4));
+	pointEnd.z_ = static_cast<float>(lua_tonumber(luaVM, 5));
+	pointEnd.y_ = static_cast<float>(lua_tonumber(luaVM, 6));
 
-		//lua_pushnumber(lua_vm, i * 2); /* Push the cell value */
-		lua_rawset(luaVM, -3);      /* Stores the pair in the table */
+    auto& navigation = Navigation::GetInstance();
+    const unsigned requestId = navigation.FindPathAsync(pointStart, pointEnd, extents, ReadProfile(luaVM, 8));
+    if (requestId == 0) {
+        lua_pushboolean(luaVM, false);
+        return 1;
     }
-      
+
+    lua_pushvalue(luaVM, 7);
+    PATH_CALLBACKS[requestId] = LuaCallback{ luaVM, luaL_ref(luaVM, LUA_REGISTRYINDEX) };
+
+    lua_pushnumber(luaVM, requestId);
+    return 1;
+}
+
+int LuaBinding::navFindPaths(lua_State* luaVM)
+{
+    if ((lua_gettop(luaVM) != 1 && lua_gettop(luaVM) != 2) || lua_type(luaVM, 1) != LUA_TTABLE) {
+        return luaL_error(luaVM, "expecting a table of { startX, startY, startZ, endX, endY, endZ } entries and optionally a profile");
+    }
+
+	Vector3F extents(2.0f, 2.0f, 2.0f);
+
+    const int pathsNum = static_cast<int>(lua_objlen(luaVM, 1));
+
+    BATCH_REQUESTS.resize(pathsNum);
+    for (int i = 0; i < pathsNum; ++i) {
+        lua_rawgeti(luaVM, 1, i + 1);
+        if (lua_type(luaVM, -1) != LUA_TTABLE) {
+            return luaL_error(luaVM, "entry %d is not a table", i + 1);
+        }
+
+        NavigationPathRequest& request = BATCH_REQUESTS[i];
+        request.start_.x_ = ReadTableNumber(luaVM, 1);
+        request.start_.z_ = ReadTableNumber(luaVM, 2);
+        request.start_.y_ = ReadTableNumber(luaVM, 3);
+        request.end_.x_ = ReadTableNumber(luaVM, 4);
+        request.end_.z_ = ReadTableNumber(luaVM, 5);
+        request.end_.y_ = ReadTableNumber(luaVM, 6);
+
+        lua_pop(luaVM, 1);
+    }
+
+    auto& navigation = Navigation::GetInstance();
+    navigation.FindPaths(BATCH_PATHS, BATCH_REQUESTS, extents, ReadProfile(luaVM, 2));
+
+    lua_createtable(luaVM, pathsNum, 0);
+
+    for (int i = 0; i < pathsNum && i < static_cast<int>(BATCH_PATHS.size()); ++i) {
+        if (BATCH_PATHS[i].empty()) {
+            lua_pushboolean(luaVM, false);
+        }
+        else {
+            PushPath(luaVM, BATCH_PATHS[i]);
+        }
+
+        lua_rawseti(luaVM, -2, i + 1);
+    }
+
+    return 1;
+}
+
+int LuaBinding::navIsReachable(lua_State* luaVM)
+{
+    if (lua_gettop(luaVM) != 6 && lua_gettop(luaVM) != 7) {
+        return luaL_error(luaVM, "expecting 6 numbers and optionally a profile");
+    }
+
+    auto& navigation = Navigation::GetInstance();
+    auto* navmesh = navigation.GetNavMesh(ReadProfile(luaVM, 7));
+    if (!navmesh) {
+        lua_pushboolean(luaVM, false);
+        return 1;
+    }
+
+    Vector3F pointStart;
+	Vector3F pointEnd;
+	Vector3F extents(2.0f, 2.0f, 2.0f);
+
+	pointStart.x_ = static_cast<float>(lua_tonumber(luaVM, 1));
+	pointStart.z_ = static_cast<float>(lua_tonumber(luaVM, 2));
+	pointStart.y_ = static_cast<float>(lua_tonumber(luaVM, 3));
+	pointEnd.x_ = static_cast<float>(lua_tonumber(luaVM, 4));
+	pointEnd.z_ = static_cast<float>(lua_tonumber(luaVM, 5));
+	pointEnd.y_ = static_cast<float>(lua_tonumber(luaVM, 6));
+
+    lua_pushboolean(luaVM, navmesh->IsReachable(pointStart, pointEnd, extents));
+    return 1;
+}
+
+int LuaBinding::navFlowFieldNextPoint(lua_State* luaVM)
+{
+    if (lua_gettop(luaVM) != 6 && lua_gettop(luaVM) != 7) {
+        return luaL_error(luaVM, "expecting 6 numbers and optionally a profile");
+    }
+
+    auto& navigation = Navigation::GetInstance();
+    auto* navmesh = navigation.GetNavMesh(ReadProfile(luaVM, 7));
+    if (!navmesh) {
+        lua_pushboolean(luaVM, false);
+        return 1;
+    }
+
+    Vector3F goal;
+	Vector3F position;
+	Vector3F extents(2.0f, 2.0f, 2.0f);
+
+	goal.x_ = static_cast<float>(lua_tonumber(luaVM, 1));
+	goal.z_ = static_cast<float>(lua_tonumber(luaVM, 2));
+	goal.y_ = static_cast<float>(lua_tonumber(luaVM, 3));
+	position.x_ = static_cast<float>(lua_tonumber(luaVM, 4));
+	position.z_ = static_cast<float>(lua_tonumber(luaVM, 5));
+	position.y_ = static_cast<float>(lua_tonumber(luaVM, 6));
+
+    Vector3F waypoint;
+    float distance;
+    if (!navmesh->FindFlowFieldStep(goal, position, extents, waypoint, &distance)) {
+        lua_pushboolean(luaVM, false);
+        return 1;
+    }
+
+    lua_pushnumber(luaVM, waypoint.x_);
+    lua_pushnumber(luaVM, waypoint.z_);
+    lua_pushnumber(luaVM, waypoint.y_);
+    lua_pushnumber(luaVM, distance);
+    return 4;
+}
+
+int LuaBinding::navSetPathBudget(lua_State* luaVM)
+{
+    if (lua_gettop(luaVM) != 2) {
+        return luaL_error(luaVM, "expecting exactly 2 arguments");
+    }
+
+    const double maxIterations = lua_tonumber(luaVM, 1);
+    const double maxMicroseconds = lua_tonumber(luaVM, 2);
+    if (!std::isfinite(maxIterations) || !std::isfinite(maxMicroseconds)) {
+        return luaL_error(luaVM, "budget must be finite");
+    }
+
+    if (maxIterations < 0.0 || maxMicroseconds < 0.0) {
+        return luaL_error(luaVM, "budget must not be negative");
+    }
+
+    // Budgets beyond the range of unsigned are as good as unlimited
+    constexpr double maxBudget = std::numeric_limits<unsigned>::max();
+    auto& navigation = Navigation::GetInstance();
+    navigation.SetPathBudget(static_cast<unsigned>(std::min(maxIterations, maxBudget)), static_cast<unsigned>(std::min(maxMicroseconds, maxBudget)));
+
+    lua_pushboolean(luaVM, true);
+    return 1;
+}
+
+int LuaBinding::navSetBuildCache(lua_State* luaVM)
+{
+    auto& navigation = Navigation::GetInstance();
+
+    // Anything but a directory turns the cache off
+    const char* directory = lua_type(luaVM, 1) == LUA_TSTRING ? lua_tostring(luaVM, 1) : nullptr;
+    navigation.SetBuildCache(directory ? std::filesystem::path(directory) : std::filesystem::path());
+
+    lua_pushboolean(luaVM, true);
+    return 1;
+}
+
+int LuaBinding::navSetBuildReport(lua_State* luaVM)
+{
+    auto& navigation = Navigation::GetInstance();
+
+    // Anything but a file name turns the report off
+    const char* path = lua_type(luaVM, 1) == LUA_TSTRING ? lua_tostring(luaVM, 1) : nullptr;
+    navigation.SetBuildReport(path ? std::filesystem::path(path) : std::filesystem::path());
+
+    lua_pushboolean(luaVM, true);
+    return 1;
+}
+
+int LuaBinding::navCrowdAddAgent(lua_State* luaVM)
+{
+    // The profile comes last, the radius and speed may be left out before it
+    const int numArgs = lua_gettop(luaVM);
+    const bool hasProfile = numArgs > 3 && lua_type(luaVM, numArgs) == LUA_TSTRING;
+    const int numNumbers = hasProfile ? numArgs - 1 : numArgs;
+    if (numNumbers < 3 || numNumbers > 5) {
+        return luaL_error(luaVM, "expecting 3 to 5 numbers and optionally a profile");
+    }
+
+    auto* crowd = Navigation::GetInstance().GetCrowd(hasProfile ? ReadProfile(luaVM, numArgs) : std::string());
+    if (!crowd) {
+        lua_pushboolean(luaVM, false);
+        return 1;
+    }
+
+    Vector3F position;
+	position.x_ = static_cast<float>(lua_tonumber(luaVM, 1));
+	position.z_ = static_cast<float>(lua_tonumber(luaVM, 2));
+	position.y_ = static_cast<float>(lua_tonumber(luaVM, 3));
+
+    CrowdAgentParams params;
+    if (numNumbers >= 4) {
+        params.radius_ = static_cast<float>(lua_tonumber(luaVM, 4));
+    }
+    if (numNumbers >= 5) {
+        params.maxSpeed_ = static_cast<float>(lua_tonumber(luaVM, 5));
+    }
+
+    if (params.radius_ <= 0.0f || params.maxSpeed_ <= 0.0f) {
+        return luaL_error(luaVM, "radius and speed must be positive");
+    }
+
+    const unsigned id = crowd->AddAgent(position, params);
+    if (id == 0) {
+        lua_pushboolean(luaVM, false);
+        return 1;
+    }
+
+    CROWD_AGENTS[id] = luaVM;
+
+    lua_pushnumber(luaVM, id);
+    return 1;
+}
+
+int LuaBinding::navCrowdRemoveAgent(lua_State* luaVM)
+{
+    if (lua_gettop(luaVM) != 1) {
+        return luaL_error(luaVM, "expecting exactly 1 argument");
+    }
+
+    // Agents of other resources are left alone
+    const auto id = static_cast<unsigned>(lua_tonumber(luaVM, 1));
+    auto* crowd = FindOwnedAgentCrowd(luaVM, id);
+    if (!crowd) {
+        lua_pushboolean(luaVM, false);
+        return 1;
+    }
+
+    CROWD_AGENTS.erase(id);
+    lua_pushboolean(luaVM, crowd->RemoveAgent(id));
+    return 1;
+}
+
+int LuaBinding::navCrowdSetTarget(lua_State* luaVM)
+{
+    // A single agent, only the resource that added it may move it
+    if (lua_gettop(luaVM) == 4) {
+        const auto id = static_cast<unsigned>(lua_tonumber(luaVM, 1));
+
+        Vector3F target;
+        target.x_ = static_cast<float>(lua_tonumber(luaVM, 2));
+        target.z_ = static_cast<float>(lua_tonumber(luaVM, 3));
+        target.y_ = static_cast<float>(lua_tonumber(luaVM, 4));
+
+        auto* crowd = FindOwnedAgentCrowd(luaVM, id);
+        lua_pushboolean(luaVM, crowd && crowd->SetTarget(id, target));
+        return 1;
+    }
+
+    if (lua_gettop(luaVM) != 1 || lua_type(luaVM, 1) != LUA_TTABLE) {
+        return luaL_error(luaVM, "expecting an agent and 3 numbers or a table of { agent, x, y, z } entries");
+    }
+
+    const int targetsNum = static_cast<int>(lua_objlen(luaVM, 1));
+
+    int numAccepted = 0;
+    for (int i = 0; i < targetsNum; ++i) {
+        lua_rawgeti(luaVM, 1, i + 1);
+        if (lua_type(luaVM, -1) != LUA_TTABLE) {
+            return luaL_error(luaVM, "entry %d is not a table", i + 1);
+        }
+
+        const auto id = static_cast<unsigned>(ReadTableNumber(luaVM, 1));
+
+        Vector3F target;
+        target.x_ = ReadTableNumber(luaVM, 2);
+        target.z_ = ReadTableNumber(luaVM, 3);
+        target.y_ = ReadTableNumber(luaVM, 4);
+
+        lua_pop(luaVM, 1);
+
+        auto* crowd = FindOwnedAgentCrowd(luaVM, id);
+        if (crowd && crowd->SetTarget(id, target)) {
+            ++numAccepted;
+        }
+    }
+
+    lua_pushnumber(luaVM, numAccepted);
+    return 1;
+}
+
+int LuaBinding::navCrowdGetPositions(lua_State* luaVM)
+{
+    auto& navigation = Navigation::GetInstance();
+
+    // Every agent of the calling resource by ID, whatever crowd it walks in
+    if (lua_gettop(luaVM) == 0) {
+        lua_newtable(luaVM);
+
+        for (const auto& [id, owner] : CROWD_AGENTS) {
+            auto* crowd = owner == luaVM ? navigation.FindAgentCrowd(id) : nullptr;
+            if (!crowd) {
+                continue;
+            }
+
+            PushAgent(luaVM, *crowd->GetAgent(id));
+            lua_rawseti(luaVM, -2, static_cast<int>(id));
+        }
+
+        return 1;
+    }
+
+    if (lua_gettop(luaVM) != 1 || lua_type(luaVM, 1) != LUA_TTABLE) {
+        return luaL_error(luaVM, "expecting nothing or a table of agents");
+    }
+
+    const int agentsNum = static_cast<int>(lua_objlen(luaVM, 1));
+
+    lua_createtable(luaVM, agentsNum, 0);
+
+    for (int i = 0; i < agentsNum; ++i) {
+        lua_rawgeti(luaVM, 1, i + 1);
+        const auto id = static_cast<unsigned>(lua_tonumber(luaVM, -1));
+        lua_pop(luaVM, 1);
+
+        // Agents of other resources are reported like missing ones
+        auto* crowd = FindOwnedAgentCrowd(luaVM, id);
+        if (const CrowdAgent* agent = crowd ? crowd->GetAgent(id) : nullptr) {
+            PushAgent(luaVM, *agent);
+        }
+        else {
+            lua_pushboolean(luaVM, false);
+        }
+
+        lua_rawseti(luaVM, -2, i + 1);
+    }
+
     return 1;
 }
 
 int LuaBinding::navNearestPoint(lua_State* luaVM)
 {
-    if (lua_gettop(luaVM) != 3) {
-        return luaL_error(luaVM, "expecting exactly 3 arguments");
+    if (lua_gettop(luaVM) != 3 && lua_gettop(luaVM) != 4) {
+        return luaL_error(luaVM, "expecting 3 numbers and optionally a profile");
     }
 
     auto& navigation = Navigation::GetInstance();
-    auto* navmesh = navigation.GetNavMesh();
+    auto* navmesh = navigation.GetNavMesh(ReadProfile(luaVM, 4));
     if (!navmesh) {
         lua_pushboolean(luaVM, false);
         return 1;
@@ -130,9 +628,9 @@ int LuaBinding::navNearestPoint(lua_State* luaVM)
     Vector3F point;
 	Vector3F extents(2.0f, 2.0f, 2.0f);
 
-	point.x_ = static_cast<float>(lua_tonumber(luaVM, -3));
-	point.z_ = static_cast<float>(lua_tonumber(luaVM, -2));
-	point.y_ = static_cast<float>(lua_tonumber(luaVM, -1));
+	point.x_ = static_cast<float>(lua_tonumber(luaVM, 1));
+	point.z_ = static_cast<float>(lua_tonumber(luaVM, 2));
+	point.y_ = static_cast<float>(lua_tonumber(luaVM, 3));
 
     dtPolyRef nearestRef{};
 
@@ -149,6 +647,247 @@ int LuaBinding::navNearestPoint(lua_State* luaVM)
     return 1;
 }
 
+int LuaBinding::navNearestPoints(lua_State* luaVM)
+{
+    // The profile comes last, the extents may be left out before it
+    const int numArgs = lua_gettop(luaVM);
+    const bool hasProfile = numArgs > 1 && lua_type(luaVM, numArgs) == LUA_TSTRING;
+    const int numValues = hasProfile ? numArgs - 1 : numArgs;
+    if ((numValues != 1 && numValues != 4) || lua_type(luaVM, 1) != LUA_TTABLE) {
+        return luaL_error(luaVM, "expecting a table of coordinates, optionally 3 extents and a profile");
+    }
+
+	Vector3F extents(2.0f, 2.0f, 2.0f);
+    if (numValues == 4) {
+        extents.x_ = static_cast<float>(lua_tonumber(luaVM, 2));
+        extents.z_ = static_cast<float>(lua_tonumber(luaVM, 3));
+        extents.y_ = static_cast<float>(lua_tonumber(luaVM, 4));
+    }
+
+    const int pointsNum = static_cast<int>(lua_objlen(luaVM, 1)) / 3;
+
+    // Coordinates are read straight from the flat table without building a table per point
+    lua_pushvalue(luaVM, 1);
+
+    BATCH_POINTS.resize(pointsNum);
+    for (int i = 0; i < pointsNum; ++i) {
+        Vector3F& point = BATCH_POINTS[i];
+        point.x_ = ReadTableNumber(luaVM, i * 3 + 1);
+        point.z_ = ReadTableNumber(luaVM, i * 3 + 2);
+        point.y_ = ReadTableNumber(luaVM, i * 3 + 3);
+    }
+
+    lua_pop(luaVM, 1);
+
+    auto& navigation = Navigation::GetInstance();
+    navigation.FindNearestPoints(BATCH_NEAREST_POINTS, BATCH_NEAREST_REFS, BATCH_POINTS, extents, hasProfile ? ReadProfile(luaVM, numArgs) : std::string());
+
+    if (BATCH_NEAREST_POINTS.size() != BATCH_POINTS.size()) {
+        lua_pushboolean(luaVM, false);
+        return 1;
+    }
+
+    PushPointsWithRefs(luaVM, BATCH_NEAREST_POINTS, BATCH_NEAREST_REFS);
+    return 1;
+}
+
+int LuaBinding::navRandomPoints(lua_State* luaVM)
+{
+    if ((lua_gettop(luaVM) != 1 && lua_gettop(luaVM) != 2) || lua_type(luaVM, 1) != LUA_TNUMBER) {
+        return luaL_error(luaVM, "expecting a number of points and optionally a profile");
+    }
+
+    const double pointsNum = lua_tonumber(luaVM, 1);
+    if (!std::isfinite(pointsNum) || pointsNum < 0.0 || pointsNum > MAX_RANDOM_POINTS) {
+        return luaL_error(luaVM, "number of points must be between 0 and %d", static_cast<int>(MAX_RANDOM_POINTS));
+    }
+
+    auto& navigation = Navigation::GetInstance();
+    if (!navigation.FindRandomPoints(BATCH_NEAREST_POINTS, BATCH_NEAREST_REFS, static_cast<unsigned>(pointsNum), ReadProfile(luaVM, 2))) {
+        lua_pushboolean(luaVM, false);
+        return 1;
+    }
+
+    PushPointsWithRefs(luaVM, BATCH_NEAREST_POINTS, BATCH_NEAREST_REFS);
+    return 1;
+}
+
+int LuaBinding::navRandomPointsAroundCircle(lua_State* luaVM)
+{
+    // The profile comes last, the extents may be left out before it
+    const int numArgs = lua_gettop(luaVM);
+    const bool hasProfile = numArgs > 2 && lua_type(luaVM, numArgs) == LUA_TSTRING;
+    const int numValues = hasProfile ? numArgs - 1 : numArgs;
+    if ((numValues != 2 && numValues != 5) || lua_type(luaVM, 1) != LUA_TTABLE) {
+        return luaL_error(luaVM, "expecting a table of coordinates, a radius, optionally 3 extents and a profile");
+    }
+
+    const float radius = static_cast<float>(lua_tonumber(luaVM, 2));
+
+	Vector3F extents(2.0f, 2.0f, 2.0f);
+    if (numValues == 5) {
+        extents.x_ = static_cast<float>(lua_tonumber(luaVM, 3));
+        extents.z_ = static_cast<float>(lua_tonumber(luaVM, 4));
+        extents.y_ = static_cast<float>(lua_tonumber(luaVM, 5));
+    }
+
+    const int centersNum = static_cast<int>(lua_objlen(luaVM, 1)) / 3;
+
+    lua_pushvalue(luaVM, 1);
+
+    BATCH_POINTS.resize(centersNum);
+    for (int i = 0; i < centersNum; ++i) {
+        Vector3F& center = BATCH_POINTS[i];
+        center.x_ = ReadTableNumber(luaVM, i * 3 + 1);
+        center.z_ = ReadTableNumber(luaVM, i * 3 + 2);
+        center.y_ = ReadTableNumber(luaVM, i * 3 + 3);
+    }
+
+    lua_pop(luaVM, 1);
+
+    auto& navigation = Navigation::GetInstance();
+    navigation.FindRandomPointsAroundCircle(BATCH_NEAREST_POINTS, BATCH_NEAREST_REFS, BATCH_POINTS, radius, extents,
+        hasProfile ? ReadProfile(luaVM, numArgs) : std::string());
+
+    if (BATCH_NEAREST_POINTS.size() != BATCH_POINTS.size()) {
+        lua_pushboolean(luaVM, false);
+        return 1;
+    }
+
+    PushPointsWithRefs(luaVM, BATCH_NEAREST_POINTS, BATCH_NEAREST_REFS);
+    return 1;
+}
+
+int LuaBinding::navRaycast(lua_State* luaVM)
+{
+    if (lua_gettop(luaVM) != 6 && lua_gettop(luaVM) != 7) {
+        return luaL_error(luaVM, "expecting 6 numbers and optionally a profile");
+    }
+
+    auto* navmesh = Navigation::GetInstance().GetNavMesh(ReadProfile(luaVM, 7));
+    if (!navmesh) {
+        lua_pushboolean(luaVM, false);
+        return 1;
+    }
+
+    Vector3F start;
+    Vector3F end;
+	Vector3F extents(2.0f, 2.0f, 2.0f);
+
+    start.x_ = static_cast<float>(lua_tonumber(luaVM, 1));
+    start.z_ = static_cast<float>(lua_tonumber(luaVM, 2));
+    start.y_ = static_cast<float>(lua_tonumber(luaVM, 3));
+    end.x_ = static_cast<float>(lua_tonumber(luaVM, 4));
+    end.z_ = static_cast<float>(lua_tonumber(luaVM, 5));
+    end.y_ = static_cast<float>(lua_tonumber(luaVM, 6));
+
+    NavigationRaycastResult result;
+    const bool walkable = navmesh->Raycast(result, start, end, extents);
+
+    lua_pushboolean(luaVM, walkable);
+    lua_pushnumber(luaVM, result.position_.x_);
+    lua_pushnumber(luaVM, result.position_.z_);
+    lua_pushnumber(luaVM, result.position_.y_);
+    return 4;
+}
+
+int LuaBinding::navRaycasts(lua_State* luaVM)
+{
+    if ((lua_gettop(luaVM) != 1 && lua_gettop(luaVM) != 2) || lua_type(luaVM, 1) != LUA_TTABLE) {
+        return luaL_error(luaVM, "expecting a table of startX, startY, startZ, endX, endY, endZ coordinates and optionally a profile");
+    }
+
+	Vector3F extents(2.0f, 2.0f, 2.0f);
+
+    const int raysNum = static_cast<int>(lua_objlen(luaVM, 1)) / 6;
+
+    lua_pushvalue(luaVM, 1);
+
+    BATCH_REQUESTS.resize(raysNum);
+    for (int i = 0; i < raysNum; ++i) {
+        NavigationPathRequest& request = BATCH_REQUESTS[i];
+        request.start_.x_ = ReadTableNumber(luaVM, i * 6 + 1);
+        request.start_.z_ = ReadTableNumber(luaVM, i * 6 + 2);
+        request.start_.y_ = ReadTableNumber(luaVM, i * 6 + 3);
+        request.end_.x_ = ReadTableNumber(luaVM, i * 6 + 4);
+        request.end_.z_ = ReadTableNumber(luaVM, i * 6 + 5);
+        request.end_.y_ = ReadTableNumber(luaVM, i * 6 + 6);
+    }
+
+    lua_pop(luaVM, 1);
+
+    auto& navigation = Navigation::GetInstance();
+    navigation.Raycasts(BATCH_RAYCASTS, BATCH_REQUESTS, extents, ReadProfile(luaVM, 2));
+
+    if (BATCH_RAYCASTS.size() != BATCH_REQUESTS.size()) {
+        lua_pushboolean(luaVM, false);
+        return 1;
+    }
+
+    lua_createtable(luaVM, raysNum, 0);
+
+    for (int i = 0; i < raysNum; ++i) {
+        const NavigationRaycastResult& result = BATCH_RAYCASTS[i];
+        if (result.walkable_) {
+            lua_pushboolean(luaVM, true);
+        }
+        else {
+            lua_pushnumber(luaVM, result.fraction_);
+        }
+
+        lua_rawseti(luaVM, -2, i + 1);
+    }
+
+    return 1;
+}
+
+int LuaBinding::navAddArea(lua_State* luaVM)
+{
+    if (lua_gettop(luaVM) != 7) {
+        return luaL_error(luaVM, "expecting exactly 7 arguments");
+    }
+
+    Vector3F min;
+    Vector3F max;
+    min.x_ = static_cast<float>(lua_tonumber(luaVM, 1));
+    min.z_ = static_cast<float>(lua_tonumber(luaVM, 2));
+    min.y_ = static_cast<float>(lua_tonumber(luaVM, 3));
+    max.x_ = static_cast<float>(lua_tonumber(luaVM, 4));
+    max.z_ = static_cast<float>(lua_tonumber(luaVM, 5));
+    max.y_ = static_cast<float>(lua_tonumber(luaVM, 6));
+
+    BoundingBox bounds;
+    bounds.Merge(min);
+    bounds.Merge(max);
+
+    // Casting NaN or values out of range is undefined, AddNavArea checks the rest
+    const double areaNumber = lua_tonumber(luaVM, 7);
+    if (!(areaNumber >= 0.0 && areaNumber <= std::numeric_limits<unsigned>::max())) {
+        lua_pushboolean(luaVM, false);
+        return 1;
+    }
+
+    const auto areaID = static_cast<unsigned>(areaNumber);
+    const unsigned handle = Navigation::GetInstance().AddNavArea(bounds, areaID);
+    if (handle == 0) {
+        lua_pushboolean(luaVM, false);
+        return 1;
+    }
+
+    lua_pushnumber(luaVM, handle);
+    return 1;
+}
+
+int LuaBinding::navRemoveArea(lua_State* luaVM)
+{
+    if (lua_gettop(luaVM) != 1) {
+        return luaL_error(luaVM, "expecting exactly 1 argument");
+    }
+
+    lua_pushboolean(luaVM, Navigation::GetInstance().RemoveNavArea(static_cast<unsigned>(lua_tonumber(luaVM, 1))));
+    return 1;
+}
+
 int LuaBinding::navDump(lua_State* luaVM)
 {
     if (lua_type(luaVM, 1) != LUA_TSTRING) {
@@ -168,17 +907,47 @@ int LuaBinding::navDump(lua_State* luaVM)
 int LuaBinding::navBuild(lua_State* luaVM)
 {
     auto& navigation = Navigation::GetInstance(); 
-    auto* navmesh = navigation.GetNavMesh();
-    if (!navmesh) {
-        lua_pushboolean(luaVM, false);
-        return 1;
-    }
 
-    const bool result = navmesh->Build();
+    const bool changedOnly = lua_toboolean(luaVM, 1);
+    const bool result = navigation.Build(changedOnly);
     lua_pushboolean(luaVM, result);
     return 1; 
 }
 
+int LuaBinding::navBuildAsync(lua_State* luaVM)
+{
+    auto& navigation = Navigation::GetInstance();
+
+    const bool changedOnly = lua_toboolean(luaVM, 1);
+    const bool result = navigation.BuildAsync(changedOnly);
+    lua_pushboolean(luaVM, result);
+    return 1;
+}
+
+int LuaBinding::navBuildStatus(lua_State* luaVM)
+{
+    const NavigationBuildStatus status = Navigation::GetInstance().GetBuildStatus();
+
+    lua_createtable(luaVM, 0, 4);
+
+    lua_pushboolean(luaVM, status.building_);
+    lua_setfield(luaVM, -2, "building");
+    lua_pushnumber(luaVM, status.tilesDone_);
+    lua_setfield(luaVM, -2, "tilesDone");
+    lua_pushnumber(luaVM, status.tilesTotal_);
+    lua_setfield(luaVM, -2, "tilesTotal");
+
+    if (status.eta_ >= 0.0f) {
+        lua_pushnumber(luaVM, status.eta_);
+    }
+    else {
+        lua_pushboolean(luaVM, false);
+    }
+    lua_setfield(luaVM, -2, "eta");
+
+    return 1;
+}
+
 int LuaBinding::navCollisionMesh(lua_State* luaVM)
 {
     if (lua_gettop(luaVM) != 7) {
@@ -344,6 +1113,76 @@ int LuaBinding::navScanWorld(lua_State* luaVM)
     return 1;
 }
 
+void LuaBinding::DoPulse()
+{
+    auto& navigation = Navigation::GetInstance();
+    navigation.UpdateBuild();
+    navigation.UpdateLandmarks();
+
+    const auto now = std::chrono::steady_clock::now();
+    if (LAST_PULSE != std::chrono::steady_clock::time_point()) {
+        navigation.UpdateCrowd(std::chrono::duration<float>(now - LAST_PULSE).count());
+    }
+
+    LAST_PULSE = now;
+
+    navigation.CollectPaths(FINISHED_PATHS);
+
+    for (const auto& result : FINISHED_PATHS) {
+        auto found = PATH_CALLBACKS.find(result.id_);
+        if (found == PATH_CALLBACKS.end()) {
+            continue; // The owner resource was stopped
+        }
+
+        const LuaCallback callback = found->second;
+        PATH_CALLBACKS.erase(found);
+
+        lua_State* luaVM = callback.luaVM_;
+        lua_rawgeti(luaVM, LUA_REGISTRYINDEX, callback.ref_);
+        luaL_unref(luaVM, LUA_REGISTRYINDEX, callback.ref_);
+
+        lua_pushnumber(luaVM, result.id_);
+        if (result.path_.empty()) {
+            lua_pushboolean(luaVM, false);
+        }
+        else {
+            PushPath(luaVM, result.path_);
+        }
+
+        if (lua_pcall(luaVM, 2, 0, 0) != 0) {
+            spdlog::error("Path callback failed: {}", lua_tostring(luaVM, -1));
+            lua_pop(luaVM, 1);
+        }
+    }
+
+    FINISHED_PATHS.clear();
+}
+
+void LuaBinding::ResourceStopping(lua_State* luaVM)
+{
+    std::erase_if(PATH_CALLBACKS, [luaVM](const auto& entry) {
+        if (entry.second.luaVM_ != luaVM) {
+            return false;
+        }
+
+        luaL_unref(luaVM, LUA_REGISTRYINDEX, entry.second.ref_);
+        return true;
+    });
+
+    auto& navigation = Navigation::GetInstance();
+    std::erase_if(CROWD_AGENTS, [luaVM, &navigation](const auto& entry) {
+        if (entry.second != luaVM) {
+            return false;
+        }
+
+        if (auto* crowd = navigation.FindAgentCrowd(entry.first)) {
+            crowd->RemoveAgent(entry.first);
+        }
+
+        return true;
+    });
+}
+
 }
 
 #pragma warning( pop )
@@ -15,13 +15,40 @@ public:
     static int navState(lua_State* luaVM);
     static int navLoad(lua_State* luaVM);
     static int navSave(lua_State* luaVM);
+    static int navAddProfile(lua_State* luaVM);
+    static int navAddInstance(lua_State* luaVM);
     static int navFindPath(lua_State* luaVM);
+    static int navFindPathAsync(lua_State* luaVM);
+    static int navFindPaths(lua_State* luaVM);
+    static int navIsReachable(lua_State* luaVM);
+    static int navFlowFieldNextPoint(lua_State* luaVM);
+    static int navSetPathBudget(lua_State* luaVM);
+    static int navSetBuildCache(lua_State* luaVM);
+    static int navSetBuildReport(lua_State* luaVM);
+    static int navCrowdAddAgent(lua_State* luaVM);
+    static int navCrowdRemoveAgent(lua_State* luaVM);
+    static int navCrowdSetTarget(lua_State* luaVM);
+    static int navCrowdGetPositions(lua_State* luaVM);
     static int navNearestPoint(lua_State* luaVM);
+    static int navNearestPoints(lua_State* luaVM);
+    static int navRandomPoints(lua_State* luaVM);
+    static int navRandomPointsAroundCircle(lua_State* luaVM);
+    static int navRaycast(lua_State* luaVM);
+    static int navRaycasts(lua_State* luaVM);
+    static int navAddArea(lua_State* luaVM);
+    static int navRemoveArea(lua_State* luaVM);
     static int navDump(lua_State* luaVM);
     static int navBuild(lua_State* luaVM);
+    static int navBuildAsync(lua_State* luaVM);
+    static int navBuildStatus(lua_State* luaVM);
     static int navCollisionMesh(lua_State* luaVM);
     static int navNavigationMesh(lua_State* luaVM);
     static int navScanWorld(lua_State* luaVM);
+
+    // Swap in a finished background build, move the crowd and deliver results of asynchronous requests to their Lua callbacks.
+    static void DoPulse();
+    // Forget callbacks and crowd agents of a stopping resource.
+    static void ResourceStopping(lua_State* luaVM);
 };
 
 }
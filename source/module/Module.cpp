@@ -33,10 +33,32 @@ MTAEXPORT void RegisterFunctions(lua_State* luaVM)
         pModuleManager->RegisterFunction(luaVM, "navState", LuaBinding::navState);
         pModuleManager->RegisterFunction(luaVM, "navLoad", LuaBinding::navLoad);
         pModuleManager->RegisterFunction(luaVM, "navSave", LuaBinding::navSave);
+        pModuleManager->RegisterFunction(luaVM, "navAddProfile", LuaBinding::navAddProfile);
+        pModuleManager->RegisterFunction(luaVM, "navAddInstance", LuaBinding::navAddInstance);
         pModuleManager->RegisterFunction(luaVM, "navFindPath", LuaBinding::navFindPath);
+        pModuleManager->RegisterFunction(luaVM, "navFindPathAsync", LuaBinding::navFindPathAsync);
+        pModuleManager->RegisterFunction(luaVM, "navFindPaths", LuaBinding::navFindPaths);
+        pModuleManager->RegisterFunction(luaVM, "navIsReachable", LuaBinding::navIsReachable);
+        pModuleManager->RegisterFunction(luaVM, "navFlowFieldNextPoint", LuaBinding::navFlowFieldNextPoint);
+        pModuleManager->RegisterFunction(luaVM, "navSetPathBudget", LuaBinding::navSetPathBudget);
+        pModuleManager->RegisterFunction(luaVM, "navSetBuildCache", LuaBinding::navSetBuildCache);
+        pModuleManager->RegisterFunction(luaVM, "navSetBuildReport", LuaBinding::navSetBuildReport);
+        pModuleManager->RegisterFunction(luaVM, "navCrowdAddAgent", LuaBinding::navCrowdAddAgent);
+        pModuleManager->RegisterFunction(luaVM, "navCrowdRemoveAgent", LuaBinding::navCrowdRemoveAgent);
+        pModuleManager->RegisterFunction(luaVM, "navCrowdSetTarget", LuaBinding::navCrowdSetTarget);
+        pModuleManager->RegisterFunction(luaVM, "navCrowdGetPositions", LuaBinding::navCrowdGetPositions);
         pModuleManager->RegisterFunction(luaVM, "navNearestPoint", LuaBinding::navNearestPoint);
+        pModuleManager->RegisterFunction(luaVM, "navNearestPoints", LuaBinding::navNearestPoints);
+        pModuleManager->RegisterFunction(luaVM, "navRandomPoints", LuaBinding::navRandomPoints);
+        pModuleManager->RegisterFunction(luaVM, "navRandomPointsAroundCircle", LuaBinding::navRandomPointsAroundCircle);
+        pModuleManager->RegisterFunction(luaVM, "navRaycast", LuaBinding::navRaycast);
+        pModuleManager->RegisterFunction(luaVM, "navRaycasts", LuaBinding::navRaycasts);
+        pModuleManager->RegisterFunction(luaVM, "navAddArea", LuaBinding::navAddArea);
+        pModuleManager->RegisterFunction(luaVM, "navRemoveArea", LuaBinding::navRemoveArea);
         pModuleManager->RegisterFunction(luaVM, "navDump", LuaBinding::navDump);
         pModuleManager->RegisterFunction(luaVM, "navBuild", LuaBinding::navBuild);
+        pModuleManager->RegisterFunction(luaVM, "navBuildAsync", LuaBinding::navBuildAsync);
+        pModuleManager->RegisterFunction(luaVM, "navBuildStatus", LuaBinding::navBuildStatus);
         pModuleManager->RegisterFunction(luaVM, "navCollisionMesh", LuaBinding::navCollisionMesh);
         pModuleManager->RegisterFunction(luaVM, "navNavigationMesh", LuaBinding::navNavigationMesh);
         pModuleManager->RegisterFunction(luaVM, "navScanWorld", LuaBinding::navScanWorld);
@@ -45,6 +67,8 @@ MTAEXPORT void RegisterFunctions(lua_State* luaVM)
 
 MTAEXPORT bool DoPulse(void)
 {
+    LuaBinding::DoPulse();
+
     return true;
 }
 
@@ -59,6 +83,8 @@ MTAEXPORT bool ShutdownModule(void)
 
 MTAEXPORT bool ResourceStopping(lua_State* luaVM)
 {
+    LuaBinding::ResourceStopping(luaVM);
+
     return true;
 }
 
@@ -6,8 +6,10 @@
 
 #include <fstream>
 
+#include <DetourNavMesh.h>
 #include <spdlog/spdlog.h>
 #include <spdlog/sinks/basic_file_sink.h>
+#include "thread_pool/thread_pool.hpp"
 
 #ifdef EXPORT_LUA_API 
 extern ILuaModuleManager10* pModuleManager;
@@ -55,6 +57,21 @@ using server_sink_mt = server_sink<std::mutex>;
 namespace WorldAssistant
 {
 
+// Longest crowd step in seconds, a stalled server must not throw the agents through walls.
+static const float MAX_CROWD_TIME_STEP = 0.25f;
+// Name of the profile every navigation mesh query uses unless told otherwise.
+static const char* DEFAULT_PROFILE = "ped";
+// Largest number of path requests of a navigation mesh waiting to be solved, further ones are rejected until some are solved.
+static const unsigned MAX_PENDING_PATHS = 4096u;
+
+Navigation::Navigation()
+{
+}
+
+Navigation::~Navigation()
+{
+}
+
 bool Navigation::Initialize()
 {
 	try
@@ -75,6 +92,16 @@ bool Navigation::Initialize()
     }
 
     navmesh_ = std::make_shared<DynamicNavigationMesh>(world_.get());   
+    navmesh_->SetProfile(NavigationProfile{ DEFAULT_PROFILE });
+    navmeshes_.push_back(navmesh_);
+
+    // Leave one core to the server main thread
+    const unsigned threadsNum = std::max(std::thread::hardware_concurrency(), 2u) - 1u;
+    workers_ = std::make_unique<thread_pool>(threadsNum);
+    // Queued path requests get their own threads, the batches run by a pulse never wait behind them
+    pathWorkers_ = std::make_unique<thread_pool>(threadsNum);
+    pathRequests_ = std::make_unique<PathRequestQueue>(*pathWorkers_);
+    crowds_.emplace(navmesh_->GetProfile().name_, std::make_unique<Crowd>(navmesh_.get()));
 
 	spdlog::info("Navigation module successfully loaded");
 
@@ -83,6 +110,27 @@ bool Navigation::Initialize()
 
 void Navigation::Shutdown()
 {
+    if (buildJob_.valid()) {
+        buildJob_.wait();
+        buildJob_ = {};
+    }
+
+    // Instance builds read the world as well
+    for (auto& [name, instance] : instances_) {
+        if (instance.buildJob_.valid()) {
+            instance.buildJob_.wait();
+        }
+    }
+
+    buildMeshes_.clear();
+    crowds_.clear();
+    pathRequests_.reset();
+    pathWorkers_.reset();
+    workers_.reset();
+
+	instances_.clear();
+	navAreas_.clear();
+	navmeshes_.clear();
 	navmesh_.reset();
 	world_.reset();
 
@@ -96,13 +144,39 @@ bool Navigation::Save(const std::filesystem::path& path)
         return false;
     }
 
-    std::ofstream stream(path, std::ios::out | std::ios::binary);
-    if (stream.is_open()) {
+    // Every profile goes into its own file, the default one keeps the given path
+    for (const auto& navmesh : navmeshes_) {
+        const std::filesystem::path profilePath = navmesh == navmesh_ ? path : GetProfilePath(path, navmesh->GetProfile().name_);
+
+        std::ofstream stream(profilePath, std::ios::out | std::ios::binary);
+        if (!stream.is_open()) {
+            return false;
+        }
+
         OutputFileStream output(stream);
-	    return navmesh_->Serialize(output);
+        if (!navmesh->Serialize(output)) {
+            return false;
+        }
     }
 
-    return false;
+    // Instances never used are not built, there is nothing to save
+    for (const auto& [name, instance] : instances_) {
+        if (!instance.ready_) {
+            continue;
+        }
+
+        std::ofstream stream(GetProfilePath(path, name), std::ios::out | std::ios::binary);
+        if (!stream.is_open()) {
+            return false;
+        }
+
+        OutputFileStream output(stream);
+        if (!instance.navmesh_->Serialize(output)) {
+            return false;
+        }
+    }
+
+    return true;
 }
 
 bool Navigation::Load(const std::filesystem::path& path)
@@ -111,10 +185,54 @@ bool Navigation::Load(const std::filesystem::path& path)
         return false;
     }
 
+    // The build in progress would replace the loaded navigation meshes
+    if (IsBuilding()) {
+        spdlog::error("Could not load navigation mesh while it is being built");
+        return false;
+    }
+
     std::ifstream stream(path, std::ios::in | std::ios::binary);
 	if (stream.is_open()) {
+        WaitQueries();
+
         InputFileStream input(stream);
-        return navmesh_->Deserialize(input);
+        if (!navmesh_->Deserialize(input)) {
+            return false;
+        }
+
+        // Other profiles are optional, a missing one is left as it is until the next build
+        for (const auto& navmesh : navmeshes_) {
+            if (navmesh == navmesh_) {
+                continue;
+            }
+
+            const std::string profile = navmesh->GetProfile().name_;
+            std::ifstream profileStream(GetProfilePath(path, profile), std::ios::in | std::ios::binary);
+            if (!profileStream.is_open()) {
+                spdlog::warn("Could not find navigation mesh of profile {}", profile);
+                continue;
+            }
+
+            InputFileStream profileInput(profileStream);
+            if (!navmesh->Deserialize(profileInput)) {
+                spdlog::error("Could not load navigation mesh of profile {}", profile);
+            }
+        }
+
+        for (const auto& navmesh : navmeshes_) {
+            navmesh->UpdateGraph();
+            navmesh->UpdateLandmarks(workers_.get());
+        }
+
+        // Instances are loaded from next to the navigation mesh on their next use
+        instancesPath_ = path;
+        ResetInstances();
+
+        for (const auto& [name, crowd] : crowds_) {
+            crowd->ResetPaths();
+        }
+
+        return true;
     }	
 
     return false;
@@ -135,4 +253,586 @@ bool Navigation::Dump(const std::filesystem::path& path)
     return false;
 }
 
+bool Navigation::Build(bool changedOnly)
+{
+    if (!navmesh_) {
+        return false;
+    }
+
+    if (IsBuilding()) {
+        spdlog::error("Navigation mesh is already being built");
+        return false;
+    }
+
+    WaitQueries();
+
+    // All profiles are built in one pass over the world geometry
+    const bool result = changedOnly ? DynamicNavigationMesh::BuildChangedProfiles(navmeshes_) : DynamicNavigationMesh::BuildProfiles(navmeshes_);
+    if (!result) {
+        return false;
+    }
+
+    for (const auto& navmesh : navmeshes_) {
+        navmesh->UpdateGraph();
+        navmesh->UpdateLandmarks(workers_.get());
+    }
+
+    // Instances are built again on their next use, saved ones are out of date
+    instancesPath_.clear();
+    ResetInstances();
+
+    for (const auto& [name, crowd] : crowds_) {
+        crowd->ResetPaths();
+    }
+
+    return true;
+}
+
+bool Navigation::BuildAsync(bool changedOnly)
+{
+    if (!navmesh_ || IsBuilding()) {
+        return false;
+    }
+
+    // New navigation meshes copy the settings of the current ones
+    buildMeshes_.clear();
+    for (const auto& navmesh : navmeshes_) {
+        auto buildMesh = std::make_shared<DynamicNavigationMesh>(world_.get());
+        buildMesh->SetProfile(navmesh->GetProfile());
+        buildMesh->SetInterior(navmesh->GetInterior());
+        buildMesh->SetHierarchicalPaths(navmesh->GetHierarchicalPaths());
+        buildMesh->SetNumLandmarks(navmesh->GetNumLandmarks());
+        buildMesh->SetFlowFieldDistance(navmesh->GetFlowFieldDistance());
+        buildMesh->SetBuildCache(navmesh->GetBuildCache());
+        buildMesh->SetBuildReport(navmesh->GetBuildReport());
+        buildMeshes_.push_back(std::move(buildMesh));
+    }
+
+    buildProgress_.tilesDone_ = 0;
+    buildProgress_.tilesTotal_ = 0;
+    buildStart_ = std::chrono::steady_clock::now();
+
+    // Landmarks are computed on the build thread alone, the workers keep serving queries
+    buildJob_ = std::async(std::launch::async, [this, navmeshes = buildMeshes_, current = navmeshes_, changedOnly]() {
+        if (changedOnly) {
+            // Changed tiles are rebuilt over a copy of the current tiles. The copy is taken here, as the calls changing the tiles of the current
+            // navigation meshes refuse or wait while a build is running, and queries only read them. Navigation meshes failing to copy are left empty,
+            // they are built in full.
+            for (std::size_t i = 0; i < navmeshes.size() && i < current.size(); ++i) {
+                std::vector<unsigned char> buildData;
+                OutputMemoryStream output(buildData);
+                if (current[i]->Serialize(output) && !buildData.empty()) {
+                    InputMemoryStream input(buildData);
+                    navmeshes[i]->Deserialize(input);
+                }
+            }
+
+            if (!DynamicNavigationMesh::BuildChangedProfiles(navmeshes, &buildProgress_)) {
+                return false;
+            }
+        }
+        else if (!DynamicNavigationMesh::BuildProfiles(navmeshes, &buildProgress_)) {
+            return false;
+        }
+
+        for (const auto& navmesh : navmeshes) {
+            navmesh->UpdateGraph();
+            navmesh->UpdateLandmarks();
+        }
+
+        return true;
+    });
+
+    spdlog::info("Started navigation mesh build in the background");
+
+    return true;
+}
+
+bool Navigation::UpdateBuild()
+{
+    for (auto& [name, instance] : instances_) {
+        UpdateInstance(instance);
+    }
+
+    if (!buildJob_.valid() || buildJob_.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+        return false;
+    }
+
+    const bool result = buildJob_.get();
+    const auto buildMeshes = std::move(buildMeshes_);
+    buildMeshes_.clear();
+
+    if (!result) {
+        spdlog::error("Background navigation mesh build failed, keeping the current navigation mesh");
+        return false;
+    }
+
+    // Queued requests keep the old navigation meshes alive until they are solved, sliced ones are finished on them at once
+    for (std::size_t i = 0; i < buildMeshes.size() && i < navmeshes_.size(); ++i) {
+        navmeshes_[i]->UpdateSlicedPaths(replacedPaths_, 0u, 0u);
+        navmeshes_[i] = buildMeshes[i];
+    }
+
+    navmesh_ = navmeshes_.front();
+
+    instancesPath_.clear();
+    ResetInstances();
+
+    for (const auto& [name, crowd] : crowds_) {
+        crowd->SetNavigationMesh(FindProfile(name).get());
+    }
+
+    const float elapsed = std::chrono::duration<float>(std::chrono::steady_clock::now() - buildStart_).count();
+    spdlog::info("Background navigation mesh build finished in {:.1f} s", elapsed);
+
+    return true;
+}
+
+void Navigation::UpdateLandmarks()
+{
+    for (const auto& navmesh : navmeshes_) {
+        navmesh->UpdateLandmarks(workers_.get(), true);
+    }
+
+    for (const auto& [name, instance] : instances_) {
+        if (instance.ready_) {
+            instance.navmesh_->UpdateLandmarks(workers_.get(), true);
+        }
+    }
+}
+
+bool Navigation::IsBuilding() const
+{
+    if (buildJob_.valid()) {
+        return true;
+    }
+
+    for (const auto& [name, instance] : instances_) {
+        if (instance.buildJob_.valid()) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+NavigationBuildStatus Navigation::GetBuildStatus() const
+{
+    NavigationBuildStatus status;
+    status.building_ = buildJob_.valid();
+    status.tilesDone_ = buildProgress_.tilesDone_;
+    status.tilesTotal_ = buildProgress_.tilesTotal_;
+
+    // Tiles take roughly the same time on average, the landmarks after them are not accounted for
+    if (status.building_ && status.tilesDone_ > 0u) {
+        const float elapsed = std::chrono::duration<float>(std::chrono::steady_clock::now() - buildStart_).count();
+        status.eta_ = elapsed * static_cast<float>(status.tilesTotal_ - status.tilesDone_) / static_cast<float>(status.tilesDone_);
+    }
+
+    return status;
+}
+
+bool Navigation::AddProfile(const NavigationProfile& profile)
+{
+    if (!world_ || IsBuilding() || profile.name_.empty() || FindProfile(profile.name_) || instances_.contains(profile.name_)) {
+        return false;
+    }
+
+    auto navmesh = std::make_shared<DynamicNavigationMesh>(world_.get());
+    navmesh->SetProfile(profile);
+    navmesh->SetBuildCache(buildCache_);
+    navmesh->SetBuildReport(buildReport_);
+    navmeshes_.push_back(std::move(navmesh));
+
+    return true;
+}
+
+bool Navigation::AddInstance(const std::string& name, std::int32_t interior, std::int32_t dimension, const std::string& profile)
+{
+    auto base = FindProfile(profile);
+    if (!world_ || !base || name.empty() || FindProfile(name) || instances_.contains(name)) {
+        return false;
+    }
+
+    const std::string baseName = base->GetProfile().name_;
+    for (const auto& [instanceName, instance] : instances_) {
+        if (instance.interior_ == interior && instance.dimension_ == dimension && instance.profile_ == baseName) {
+            return false;
+        }
+    }
+
+    // The instance saves and builds under its own name
+    NavigationProfile instanceProfile = base->GetProfile();
+    instanceProfile.name_ = name;
+
+    auto navmesh = std::make_shared<DynamicNavigationMesh>(world_.get());
+    navmesh->SetProfile(instanceProfile);
+    navmesh->SetInterior(interior);
+    navmesh->SetBuildCache(buildCache_);
+    navmesh->SetBuildReport(buildReport_);
+
+    instances_.emplace(name, NavigationInstance{ interior, dimension, baseName, std::move(navmesh), false, false, {} });
+
+    return true;
+}
+
+unsigned Navigation::FindPathAsync(const Vector3F& start, const Vector3F& end, const Vector3F& extents, const std::string& profile)
+{
+    auto navmesh = FindNavMesh(profile);
+    if (!navmesh || !pathRequests_) {
+        return 0u;
+    }
+
+    // Scripts could otherwise queue requests faster than the workers solve them
+    const bool sliced = pathBudgetIterations_ || pathBudgetMicroseconds_;
+    if ((sliced ? navmesh->GetSlicedPathCount() : pathRequests_->GetPendingCount()) >= MAX_PENDING_PATHS) {
+        spdlog::warn("Too many path requests in flight, rejecting the request");
+        return 0u;
+    }
+
+    const unsigned id = nextPathId_++;
+    if (nextPathId_ == 0u) {
+        nextPathId_ = 1u;
+    }
+
+    if (sliced) {
+        navmesh->FindPathSliced(id, start, end, extents);
+    }
+    else {
+        pathRequests_->Push(id, navmesh, start, end, extents);
+    }
+
+    return id;
+}
+
+void Navigation::FindPaths(std::vector<std::vector<Vector3F>>& dest, const std::vector<NavigationPathRequest>& requests, const Vector3F& extents, const std::string& profile)
+{
+    auto* navmesh = GetNavMesh(profile);
+    if (!navmesh) {
+        dest.clear();
+        return;
+    }
+
+    navmesh->FindPaths(dest, requests, extents, workers_.get());
+}
+
+void Navigation::FindNearestPoints(std::vector<Vector3F>& dest, std::vector<dtPolyRef>& destRefs, const std::vector<Vector3F>& points, const Vector3F& extents,
+    const std::string& profile)
+{
+    auto* navmesh = GetNavMesh(profile);
+    if (!navmesh) {
+        dest.clear();
+        destRefs.clear();
+        return;
+    }
+
+    navmesh->FindNearestPoints(dest, destRefs, points, extents, workers_.get());
+}
+
+bool Navigation::FindRandomPoints(std::vector<Vector3F>& dest, std::vector<dtPolyRef>& destRefs, unsigned count, const std::string& profile)
+{
+    auto* navmesh = GetNavMesh(profile);
+    if (!navmesh) {
+        dest.clear();
+        destRefs.clear();
+        return false;
+    }
+
+    return navmesh->FindRandomPoints(dest, destRefs, count, workers_.get());
+}
+
+void Navigation::FindRandomPointsAroundCircle(std::vector<Vector3F>& dest, std::vector<dtPolyRef>& destRefs, const std::vector<Vector3F>& centers, float radius, const Vector3F& extents,
+    const std::string& profile)
+{
+    auto* navmesh = GetNavMesh(profile);
+    if (!navmesh) {
+        dest.clear();
+        destRefs.clear();
+        return;
+    }
+
+    navmesh->FindRandomPointsAroundCircle(dest, destRefs, centers, radius, extents, workers_.get());
+}
+
+void Navigation::Raycasts(std::vector<NavigationRaycastResult>& dest, const std::vector<NavigationPathRequest>& requests, const Vector3F& extents, const std::string& profile)
+{
+    auto* navmesh = GetNavMesh(profile);
+    if (!navmesh) {
+        dest.clear();
+        return;
+    }
+
+    navmesh->Raycasts(dest, requests, extents, workers_.get());
+}
+
+void Navigation::CollectPaths(std::vector<PathResult>& dest)
+{
+    dest.insert(dest.end(), std::make_move_iterator(replacedPaths_.begin()), std::make_move_iterator(replacedPaths_.end()));
+    replacedPaths_.clear();
+
+    if (pathRequests_) {
+        pathRequests_->Collect(dest);
+    }
+
+    // Requests left over from a removed budget are solved at once
+    for (const auto& navmesh : navmeshes_) {
+        navmesh->UpdateSlicedPaths(dest, pathBudgetIterations_, pathBudgetMicroseconds_);
+    }
+
+    for (const auto& [name, instance] : instances_) {
+        if (instance.ready_) {
+            instance.navmesh_->UpdateSlicedPaths(dest, pathBudgetIterations_, pathBudgetMicroseconds_);
+        }
+    }
+}
+
+void Navigation::SetPathBudget(unsigned maxIterations, unsigned maxMicroseconds)
+{
+    pathBudgetIterations_ = maxIterations;
+    pathBudgetMicroseconds_ = maxMicroseconds;
+}
+
+void Navigation::SetBuildCache(const std::filesystem::path& directory)
+{
+    buildCache_ = directory.empty() ? nullptr : std::make_shared<TileBuildCache>(directory);
+
+    for (const auto& navmesh : navmeshes_) {
+        navmesh->SetBuildCache(buildCache_);
+    }
+
+    for (auto& [name, instance] : instances_) {
+        instance.navmesh_->SetBuildCache(buildCache_);
+    }
+}
+
+void Navigation::SetBuildReport(const std::filesystem::path& path)
+{
+    buildReport_ = path;
+
+    for (const auto& navmesh : navmeshes_) {
+        navmesh->SetBuildReport(buildReport_);
+    }
+
+    for (auto& [name, instance] : instances_) {
+        instance.navmesh_->SetBuildReport(buildReport_);
+    }
+}
+
+void Navigation::UpdateCrowd(float timeStep)
+{
+    for (const auto& [name, crowd] : crowds_) {
+        crowd->Update(std::min(timeStep, MAX_CROWD_TIME_STEP), workers_.get());
+    }
+}
+
+Crowd* Navigation::GetCrowd(const std::string& profile)
+{
+    auto navmesh = FindProfile(profile);
+    if (!navmesh) {
+        return nullptr;
+    }
+
+    auto& crowd = crowds_[navmesh->GetProfile().name_];
+    if (!crowd) {
+        crowd = std::make_unique<Crowd>(navmesh.get());
+    }
+
+    return crowd.get();
+}
+
+Crowd* Navigation::FindAgentCrowd(unsigned agent) const
+{
+    for (const auto& [name, crowd] : crowds_) {
+        if (crowd->GetAgent(agent)) {
+            return crowd.get();
+        }
+    }
+
+    return nullptr;
+}
+
+unsigned Navigation::AddNavArea(const BoundingBox& bounds, unsigned areaID)
+{
+    // Area volumes are read by the build thread and the path workers
+    if (!world_ || IsBuilding() || areaID >= DT_MAX_AREAS) {
+        return 0;
+    }
+
+    auto area = std::make_shared<NavArea>();
+    area->SetAreaID(areaID);
+    area->SetBoundingBox(bounds);
+    area->SetEnabled(true);
+
+    WaitQueries();
+
+    NavArea* added = area.get();
+    if (!world_->GetScene()->AddNavArea(std::move(area))) {
+        return 0;
+    }
+
+    const unsigned handle = nextNavArea_++;
+    navAreas_.emplace(handle, added);
+    return handle;
+}
+
+bool Navigation::RemoveNavArea(unsigned handle)
+{
+    auto it = navAreas_.find(handle);
+    if (!world_ || IsBuilding() || it == navAreas_.end()) {
+        return false;
+    }
+
+    WaitQueries();
+
+    world_->GetScene()->RemoveNavArea(it->second);
+    navAreas_.erase(it);
+    return true;
+}
+
+void Navigation::WaitQueries()
+{
+    if (pathRequests_) {
+        pathRequests_->Wait();
+    }
+
+    // Landmark tables computed in the background read the tiles as well
+    for (const auto& navmesh : navmeshes_) {
+        navmesh->WaitLandmarks();
+    }
+
+    for (const auto& [name, instance] : instances_) {
+        if (instance.navmesh_) {
+            instance.navmesh_->WaitLandmarks();
+        }
+    }
+}
+
+std::shared_ptr<DynamicNavigationMesh> Navigation::FindProfile(const std::string& profile) const
+{
+    if (profile.empty()) {
+        return navmesh_;
+    }
+
+    for (const auto& navmesh : navmeshes_) {
+        if (navmesh->GetProfile().name_ == profile) {
+            return navmesh;
+        }
+    }
+
+    return {};
+}
+
+std::shared_ptr<DynamicNavigationMesh> Navigation::FindNavMesh(const std::string& name)
+{
+    if (auto navmesh = FindProfile(name)) {
+        return navmesh;
+    }
+
+    auto found = instances_.find(name);
+    if (found == instances_.end() || !PrepareInstance(found->second)) {
+        return {};
+    }
+
+    return found->second.navmesh_;
+}
+
+void Navigation::ResetInstances()
+{
+    for (auto& [name, instance] : instances_) {
+        // Sliced requests are only advanced on ready instances, they would wait for the next use otherwise
+        if (instance.ready_) {
+            instance.navmesh_->UpdateSlicedPaths(replacedPaths_, 0u, 0u);
+        }
+
+        instance.ready_ = false;
+        instance.failed_ = false;
+    }
+}
+
+bool Navigation::PrepareInstance(NavigationInstance& instance)
+{
+    UpdateInstance(instance);
+
+    if (instance.ready_) {
+        return true;
+    }
+
+    // Builds read the world and the area volumes, one runs at a time
+    if (instance.failed_ || IsBuilding()) {
+        return false;
+    }
+
+    const auto& current = instance.navmesh_;
+    const std::string name = current->GetProfile().name_;
+    const std::filesystem::path path = instancesPath_.empty() ? std::filesystem::path() : GetProfilePath(instancesPath_, name);
+
+    // The instance is loaded or built into a new navigation mesh on a background thread, queries naming it fail until it is swapped in
+    auto navmesh = std::make_shared<DynamicNavigationMesh>(world_.get());
+    navmesh->SetProfile(current->GetProfile());
+    navmesh->SetInterior(current->GetInterior());
+    navmesh->SetHierarchicalPaths(current->GetHierarchicalPaths());
+    navmesh->SetNumLandmarks(current->GetNumLandmarks());
+    navmesh->SetFlowFieldDistance(current->GetFlowFieldDistance());
+    navmesh->SetBuildCache(buildCache_);
+    navmesh->SetBuildReport(buildReport_);
+
+    instance.buildJob_ = std::async(std::launch::async, [navmesh, path, name]() -> std::shared_ptr<DynamicNavigationMesh> {
+        // A saved instance is loaded, a missing one is built from the shared world
+        bool loaded = false;
+        if (!path.empty()) {
+            std::ifstream stream(path, std::ios::in | std::ios::binary);
+            if (stream.is_open()) {
+                InputFileStream input(stream);
+                loaded = navmesh->Deserialize(input);
+                if (!loaded) {
+                    spdlog::warn("Could not load navigation mesh of instance {}, building it", name);
+                }
+            }
+        }
+
+        if (!loaded && !navmesh->Build()) {
+            spdlog::error("Could not build navigation mesh of instance {}", name);
+            return {};
+        }
+
+        navmesh->UpdateGraph();
+        navmesh->UpdateLandmarks();
+        return navmesh;
+    });
+
+    spdlog::info("Started navigation mesh of instance {} in the background", name);
+
+    return false;
+}
+
+void Navigation::UpdateInstance(NavigationInstance& instance)
+{
+    if (!instance.buildJob_.valid() || instance.buildJob_.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+        return;
+    }
+
+    auto navmesh = instance.buildJob_.get();
+    if (!navmesh) {
+        instance.failed_ = true;
+        return;
+    }
+
+    // Settings changed meanwhile went to the previous navigation mesh
+    navmesh->SetBuildCache(buildCache_);
+    navmesh->SetBuildReport(buildReport_);
+
+    instance.navmesh_ = std::move(navmesh);
+    instance.ready_ = true;
+
+    spdlog::info("Navigation mesh of instance {} (interior {}, dimension {}) is ready", instance.navmesh_->GetProfile().name_, instance.interior_,
+        instance.dimension_);
+}
+
+std::filesystem::path Navigation::GetProfilePath(const std::filesystem::path& path, const std::string& profile)
+{
+    std::filesystem::path profilePath = path;
+    profilePath.replace_filename(path.stem().string() + "." + profile + path.extension().string());
+    return profilePath;
+}
+
 }
\ No newline at end of file
@@ -1,15 +1,64 @@
 #pragma once
 
+#include <chrono>
 #include <memory>
 #include <filesystem>
+#include <future>
+#include <string>
+#include <unordered_map>
 
+#include "../navigation/Crowd.h"
 #include "../navigation/DynamicNavigationMesh.h"
+#include "../navigation/PathRequestQueue.h"
+#include "../navigation/TileBuildCache.h"
 #include "../scene/World.h"
 #include "../scene/Scene.h"
 
+class thread_pool;
+
 namespace WorldAssistant
 {
 
+// Navigation mesh of an interior or dimension, loaded or built in the background on first use.
+struct NavigationInstance
+{
+	// Interior the navigation mesh is built from.
+	std::int32_t interior_{};
+
+	// Dimension the navigation mesh serves.
+	std::int32_t dimension_{};
+
+	// Profile the agent dimensions are taken from.
+	std::string profile_;
+
+	std::shared_ptr<DynamicNavigationMesh> navmesh_;
+
+	// Whether the navigation mesh is loaded or built.
+	bool ready_{};
+
+	// Whether loading and building failed, not retried until the next build or load.
+	bool failed_{};
+
+	// Background load or build of the next navigation mesh, invalid if none is running.
+	std::future<std::shared_ptr<DynamicNavigationMesh>> buildJob_;
+};
+
+// State of the background build.
+struct NavigationBuildStatus
+{
+	// Whether a background build is running.
+	bool building_{};
+
+	// Number of tiles built by the last or running build.
+	unsigned tilesDone_{};
+
+	// Number of tiles to build, zero until known.
+	unsigned tilesTotal_{};
+
+	// Estimated seconds left, negative if unknown.
+	float eta_{-1.0f};
+};
+
 class Navigation
 {
 public:
@@ -33,18 +82,178 @@ public:
 
 	bool Dump(const std::filesystem::path& path);
 
+	// Build all profiles. Only the tiles whose input geometry changed since they were built are rebuilt if changedOnly is set. Return true if successful.
+	bool Build(bool changedOnly = false);
+
+	// Start building all profiles into new navigation meshes on a background thread while the current ones keep serving queries. They take over in
+	// UpdateBuild once finished. With changedOnly set the new navigation meshes start from copies of the current ones and only the tiles whose input changed
+	// are rebuilt. Return false if a build is already running.
+	bool BuildAsync(bool changedOnly = false);
+
+	// Swap in the navigation meshes of a finished background build and of finished instances. Called once per pulse. Return true if the navigation
+	// meshes of the profiles were swapped.
+	bool UpdateBuild();
+
+	// Recompute the landmark tables dropped by tile changes in the background once the tiles settle and swap in finished ones. Called once per pulse.
+	void UpdateLandmarks();
+
+	// Return progress of the background build.
+	NavigationBuildStatus GetBuildStatus() const;
+
+	// Return whether a background build of the profiles or of an instance is running.
+	bool IsBuilding() const;
+
+	// Register a profile built and saved alongside the default one. Takes effect on the next build or load. Return false if the name is taken.
+	bool AddProfile(const NavigationProfile& profile);
+
+	// Register a navigation mesh of the interior and dimension with the agent dimensions of the profile. It shares the world with the other navigation meshes
+	// and is loaded or built on first use under its name, which is accepted wherever a profile is. Return false if the name or the instance is taken.
+	bool AddInstance(const std::string& name, std::int32_t interior, std::int32_t dimension, const std::string& profile = {});
+
+	// Queue a path request. It is solved by the worker threads, or sliced over pulses if a path budget is set. Return request ID, zero on failure or if
+	// too many requests are in flight.
+	unsigned FindPathAsync(const Vector3F& start, const Vector3F& end, const Vector3F& extents, const std::string& profile = {});
+
+	// Find paths for a batch of start/end pairs on the worker threads.
+	void FindPaths(std::vector<std::vector<Vector3F>>& dest, const std::vector<NavigationPathRequest>& requests, const Vector3F& extents, const std::string& profile = {});
+
+	// Find the nearest points on the navigation mesh for a batch of points on the worker threads.
+	void FindNearestPoints(std::vector<Vector3F>& dest, std::vector<dtPolyRef>& destRefs, const std::vector<Vector3F>& points, const Vector3F& extents,
+		const std::string& profile = {});
+
+	// Pick random points over the navigation mesh with uniform density on the worker threads. Return false if there is nothing to sample.
+	bool FindRandomPoints(std::vector<Vector3F>& dest, std::vector<dtPolyRef>& destRefs, unsigned count, const std::string& profile = {});
+
+	// Pick a random point reachable from every center within the radius on the worker threads.
+	void FindRandomPointsAroundCircle(std::vector<Vector3F>& dest, std::vector<dtPolyRef>& destRefs, const std::vector<Vector3F>& centers, float radius, const Vector3F& extents,
+		const std::string& profile = {});
+
+	// Test a batch of start/end pairs for straight walkability on the worker threads.
+	void Raycasts(std::vector<NavigationRaycastResult>& dest, const std::vector<NavigationPathRequest>& requests, const Vector3F& extents, const std::string& profile = {});
+
+	// Advance sliced path requests within the budget and move solved path requests into dest. Called once per pulse.
+	void CollectPaths(std::vector<PathResult>& dest);
+
+	// Set the per-pulse budget of sliced path requests in search iterations and microseconds. Zero for both turns slicing off.
+	void SetPathBudget(unsigned maxIterations, unsigned maxMicroseconds);
+
+	// Set directory of the tile build cache shared by all navigation meshes, an empty path disables it. Takes effect on the next build.
+	void SetBuildCache(const std::filesystem::path& directory);
+
+	// Set CSV file the per-tile build times of every build are written to, an empty path writes none. Takes effect on the next build.
+	void SetBuildReport(const std::filesystem::path& path);
+
+	// Add an area volume with the area ID, marked on the polygons of the tiles it intersects by the next build. Path points fall back to it right away.
+	// Return area handle, zero if the area ID is out of range or a build is running.
+	unsigned AddNavArea(const BoundingBox& bounds, unsigned areaID);
+
+	// Remove an area volume by handle, the next build unmarks it. Return false if there is no such area or a build is running.
+	bool RemoveNavArea(unsigned handle);
+
+	// Move the crowd agents by the time step in seconds. Called once per pulse.
+	void UpdateCrowd(float timeStep);
+
 	World* GetWorld() const { return world_.get(); }
 
 	DynamicNavigationMesh* GetNavMesh() const { return navmesh_.get(); }
 
+	// Return navigation mesh of the profile or instance, the default one for an empty name. The first use of an instance starts loading or building it in
+	// the background. Null if there is no such profile or the instance is not available yet.
+	DynamicNavigationMesh* GetNavMesh(const std::string& profile) { return FindNavMesh(profile).get(); }
+
+	thread_pool* GetWorkers() const { return workers_.get(); }
+
+	// Return crowd walking on the navigation mesh of the profile, the default one for an empty name. Created on first use. Null if there is no such
+	// profile.
+	Crowd* GetCrowd(const std::string& profile = {});
+
+	// Return crowd the agent belongs to, null if there is no such agent.
+	Crowd* FindAgentCrowd(unsigned agent) const;
+
 private:
-	Navigation()
-	{
-	}
+	Navigation();
+
+	~Navigation();
+
+	// Wait for the worker threads and the background landmark computations to stop reading the navigation meshes.
+	void WaitQueries();
+
+	// Return navigation mesh of the profile, the default one for an empty name. Null if there is no such profile.
+	std::shared_ptr<DynamicNavigationMesh> FindProfile(const std::string& profile) const;
+
+	// Return navigation mesh of the profile or instance, preparing the instance first. Null if there is no such profile or the instance is not available.
+	std::shared_ptr<DynamicNavigationMesh> FindNavMesh(const std::string& name);
+
+	// Swap in the navigation mesh of the instance once its background load or build is finished.
+	void UpdateInstance(NavigationInstance& instance);
+
+	// Make the instances load or build again on their next use. Sliced requests still running on them are finished at once.
+	void ResetInstances();
+
+	// Start loading the instance from the last loaded navigation data or building it in the background unless it is ready. Return true if it is ready.
+	bool PrepareInstance(NavigationInstance& instance);
+
+	// Return path the profile is saved to, next to the default navigation mesh.
+	static std::filesystem::path GetProfilePath(const std::filesystem::path& path, const std::string& profile);
 
 	std::unique_ptr<World> world_;
 
+	// Navigation mesh of the default profile.
 	std::shared_ptr<DynamicNavigationMesh> navmesh_;
+
+	// Navigation meshes of all profiles, the default one first.
+	std::vector<std::shared_ptr<DynamicNavigationMesh>> navmeshes_;
+
+	// Interior and dimension navigation meshes by name.
+	std::unordered_map<std::string, NavigationInstance> instances_;
+
+	// Path of the last loaded navigation data, instances are loaded from next to it.
+	std::filesystem::path instancesPath_;
+
+	// Worker threads of the batched queries the server thread waits for.
+	std::unique_ptr<thread_pool> workers_;
+
+	// Worker threads of the queued path requests.
+	std::unique_ptr<thread_pool> pathWorkers_;
+
+	std::unique_ptr<PathRequestQueue> pathRequests_;
+
+	// Crowds by profile name.
+	std::unordered_map<std::string, std::unique_ptr<Crowd>> crowds_;
+
+	// Area volumes added to the scene by handle.
+	std::unordered_map<unsigned, NavArea*> navAreas_;
+
+	// Handle of the next area volume.
+	unsigned nextNavArea_{ 1 };
+
+	// Background build returning whether it succeeded, invalid if none is running.
+	std::future<bool> buildJob_;
+
+	// Navigation meshes of the background build, one per profile in the order of navmeshes_.
+	std::vector<std::shared_ptr<DynamicNavigationMesh>> buildMeshes_;
+
+	NavigationBuildProgress buildProgress_;
+
+	std::chrono::steady_clock::time_point buildStart_;
+
+	// Built tile layers by input hash, null if disabled.
+	std::shared_ptr<TileBuildCache> buildCache_;
+
+	// CSV file of the build report, empty if none is written.
+	std::filesystem::path buildReport_;
+
+	// Sliced path requests finished on the navigation meshes replaced by a background build.
+	std::vector<PathResult> replacedPaths_;
+
+	// Next path request ID, zero is never used.
+	unsigned nextPathId_{1};
+
+	// Search iterations of sliced path requests per pulse.
+	unsigned pathBudgetIterations_{};
+
+	// Time of sliced path requests per pulse in microseconds.
+	unsigned pathBudgetMicroseconds_{};
 };
 
 }
\ No newline at end of file
@@ -44,14 +44,46 @@ struct NavigationCache
     }
 };
 
+// Profile the queries run on, empty for the default one.
+std::string SELECTED_PROFILE;
+
 std::vector<Vector3F> SHARED_VECTORS;
 std::vector<std::uint32_t> SHARED_NUMBERS;
 
-NavigationCache<Vector3F> NAVMESH_PATH_CACHE(SHARED_VECTORS);
+// Points of the last path. Repeated queries are served by the navigation mesh path cache.
+std::vector<Vector3F> PATH_POINTS;
+
+// Batched path requests and results, reused across calls.
+std::vector<NavigationPathRequest> PATHS_BATCH_REQUESTS;
+std::vector<std::vector<Vector3F>> PATHS_BATCH;
+
+// Batched nearest points, reused across calls.
+std::vector<Vector3F> NEAREST_BATCH_POINTS;
+std::vector<Vector3F> NEAREST_BATCH;
+std::vector<dtPolyRef> NEAREST_BATCH_REFS;
+
+// Batched raycasts, reused across calls.
+std::vector<NavigationPathRequest> RAYCAST_BATCH_REQUESTS;
+std::vector<NavigationRaycastResult> RAYCAST_BATCH;
+
 NavigationCache<Vector3F> COLLISION_VERTICES_CACHE(SHARED_VECTORS);
 NavigationCache<Vector3F> NAVMESH_VERTICES_CACHE(SHARED_VECTORS);
 NavigationCache<std::uint32_t> MODEL_INDICES_CACHE(SHARED_NUMBERS);
 
+// Copy the batched points into the output arrays in the API axis order.
+void WritePointsWithRefs(const std::vector<Vector3F>& points, const std::vector<dtPolyRef>& refs, float* outPoints, std::uint32_t* outRefs)
+{
+    for (std::size_t i = 0; i < points.size(); ++i) {
+        Vector3F point = points[i];
+        std::swap(point.y_, point.z_);
+        std::memcpy(outPoints + i * 3u, &point.x_, sizeof(Vector3F));
+
+        if (outRefs) {
+            outRefs[i] = static_cast<std::uint32_t>(refs[i]);
+        }
+    }
+}
+
 }
 
 extern "C"
@@ -70,7 +102,7 @@ void NAVIGATION_API navShutdown()
 bool NAVIGATION_API navState()
 {
     auto& navigation = Navigation::GetInstance();
-    if (auto* navMesh = navigation.GetNavMesh()) {
+    if (auto* navMesh = navigation.GetNavMesh(SELECTED_PROFILE)) {
         return navMesh->GetEffectiveTilesCount() > 0u; 
     }
 
@@ -89,6 +121,46 @@ bool NAVIGATION_API navSave(const char* filename)
     return navigation.Save(filename);
 }
 
+bool NAVIGATION_API navAddProfile(const char* name, float agentRadius, float agentHeight, float agentMaxClimb, float agentMaxSlope)
+{
+    if (!name) {
+        return false;
+    }
+
+    NavigationProfile profile;
+    profile.name_ = name;
+    profile.agentRadius_ = agentRadius;
+    profile.agentHeight_ = agentHeight;
+    profile.agentMaxClimb_ = agentMaxClimb;
+    profile.agentMaxSlope_ = agentMaxSlope;
+
+    auto& navigation = Navigation::GetInstance();
+    return navigation.AddProfile(profile);
+}
+
+bool NAVIGATION_API navAddInstance(const char* name, std::int32_t interior, std::int32_t dimension, const char* profile)
+{
+    if (!name) {
+        return false;
+    }
+
+    auto& navigation = Navigation::GetInstance();
+    return navigation.AddInstance(name, interior, dimension, profile ? profile : "");
+}
+
+bool NAVIGATION_API navSelectProfile(const char* name)
+{
+    const std::string profile = name ? name : "";
+
+    auto& navigation = Navigation::GetInstance();
+    if (!navigation.GetNavMesh(profile)) {
+        return false;
+    }
+
+    SELECTED_PROFILE = profile;
+    return true;
+}
+
 bool NAVIGATION_API navFindPath(float* startPos, float* endPos, std::uint32_t* outPointsNum, float* outPoints)
 {
     if (outPointsNum == nullptr) {
@@ -97,7 +169,7 @@ bool NAVIGATION_API navFindPath(float* startPos, float* endPos, std::uint32_t* o
     }
 
     auto& navigation = Navigation::GetInstance();
-    auto* navmesh = navigation.GetNavMesh();
+    auto* navmesh = navigation.GetNavMesh(SELECTED_PROFILE);
     if (!navmesh) {
         return false;
     }  
@@ -111,36 +183,217 @@ bool NAVIGATION_API navFindPath(float* startPos, float* endPos, std::uint32_t* o
     std::swap(args.pointStart_.y_, args.pointStart_.z_);
     std::swap(args.pointEnd_.y_, args.pointEnd_.z_);
 
-    // Update path if required
-    if (NAVMESH_PATH_CACHE.IsUpdateRequired(args)) {
-        navmesh->FindPath(NAVMESH_PATH_CACHE.array_, args.pointStart_, args.pointEnd_, args.extents_);
-
-        for (auto& point : NAVMESH_PATH_CACHE.array_) {
-            std::swap(point.y_, point.z_);
-        }
+    navmesh->FindPath(PATH_POINTS, args.pointStart_, args.pointEnd_, args.extents_);
 
-        NAVMESH_PATH_CACHE.args_ = args;
-    }    
+    for (auto& point : PATH_POINTS) {
+        std::swap(point.y_, point.z_);
+    }
 
     if (outPoints) {
-        *outPointsNum = std::min(*outPointsNum, static_cast<std::uint32_t>(NAVMESH_PATH_CACHE.array_.size()));
+        *outPointsNum = std::min(*outPointsNum, static_cast<std::uint32_t>(PATH_POINTS.size()));
         if (*outPointsNum == 0) {
             return false;
         }     
 
-        std::memcpy(outPoints, NAVMESH_PATH_CACHE.array_.data(), static_cast<std::size_t>(*outPointsNum) * sizeof(Vector3F));
+        std::memcpy(outPoints, PATH_POINTS.data(), static_cast<std::size_t>(*outPointsNum) * sizeof(Vector3F));
     }
     else {
-        *outPointsNum = static_cast<std::uint32_t>(NAVMESH_PATH_CACHE.array_.size());
+        *outPointsNum = static_cast<std::uint32_t>(PATH_POINTS.size());
     }
     
     return true;
 }
 
+bool NAVIGATION_API navFindPaths(std::uint32_t pathsNum, float* startPositions, float* endPositions, std::uint32_t* outPathsPointsNum, std::uint32_t* outPointsNum, float* outPoints)
+{
+    if (outPointsNum == nullptr || outPathsPointsNum == nullptr) {
+        spdlog::error("Invalid points pointer");
+        return false;
+    }
+
+    auto& navigation = Navigation::GetInstance();
+    if (!navigation.GetNavMesh(SELECTED_PROFILE)) {
+        return false;
+    }
+
+    PATHS_BATCH_REQUESTS.resize(pathsNum);
+    for (std::uint32_t i = 0; i < pathsNum; ++i) {
+        auto& request = PATHS_BATCH_REQUESTS[i];
+        request.start_ = Vector3F(startPositions + i * 3u);
+        request.end_ = Vector3F(endPositions + i * 3u);
+
+        std::swap(request.start_.y_, request.start_.z_);
+        std::swap(request.end_.y_, request.end_.z_);
+    }
+
+    navigation.FindPaths(PATHS_BATCH, PATHS_BATCH_REQUESTS, Vector3F(2.0f, 2.0f, 2.0f), SELECTED_PROFILE);
+
+    for (auto& path : PATHS_BATCH) {
+        for (auto& point : path) {
+            std::swap(point.y_, point.z_);
+        }
+    }
+
+    std::uint32_t totalPointsNum{};
+    for (std::uint32_t i = 0; i < pathsNum; ++i) {
+        outPathsPointsNum[i] = static_cast<std::uint32_t>(PATHS_BATCH[i].size());
+        totalPointsNum += outPathsPointsNum[i];
+    }
+
+    if (outPoints) {
+        // Paths that do not fit entirely are truncated
+        std::uint32_t written{};
+        for (std::uint32_t i = 0; i < pathsNum; ++i) {
+            const auto& path = PATHS_BATCH[i];
+            const std::uint32_t count = std::min(*outPointsNum - written, static_cast<std::uint32_t>(path.size()));
+
+            std::memcpy(outPoints + static_cast<std::size_t>(written) * 3u, path.data(), static_cast<std::size_t>(count) * sizeof(Vector3F));
+            outPathsPointsNum[i] = count;
+            written += count;
+        }
+
+        *outPointsNum = written;
+    }
+    else {
+        *outPointsNum = totalPointsNum;
+    }
+
+    return true;
+}
+
+bool NAVIGATION_API navIsReachable(float* startPos, float* endPos)
+{
+    auto& navigation = Navigation::GetInstance();
+    auto* navmesh = navigation.GetNavMesh(SELECTED_PROFILE);
+    if (!navmesh) {
+        return false;
+    }
+
+    Vector3F pointStart(startPos);
+    Vector3F pointEnd(endPos);
+	Vector3F extents(2.0f, 2.0f, 2.0f);
+
+    std::swap(pointStart.y_, pointStart.z_);
+    std::swap(pointEnd.y_, pointEnd.z_);
+
+    return navmesh->IsReachable(pointStart, pointEnd, extents);
+}
+
+bool NAVIGATION_API navFlowFieldNextPoint(float* goalPos, float* pos, float* outPoint, float* outDistance)
+{
+    auto& navigation = Navigation::GetInstance();
+    auto* navmesh = navigation.GetNavMesh(SELECTED_PROFILE);
+    if (!navmesh || !outPoint) {
+        return false;
+    }
+
+    Vector3F goal(goalPos);
+    Vector3F position(pos);
+	Vector3F extents(2.0f, 2.0f, 2.0f);
+
+    std::swap(goal.y_, goal.z_);
+    std::swap(position.y_, position.z_);
+
+    Vector3F waypoint;
+    if (!navmesh->FindFlowFieldStep(goal, position, extents, waypoint, outDistance)) {
+        return false;
+    }
+
+    std::swap(waypoint.y_, waypoint.z_);
+    std::memcpy(outPoint, &waypoint.x_, sizeof(Vector3F));
+    return true;
+}
+
+void NAVIGATION_API navSetBuildCache(const char* directory)
+{
+    auto& navigation = Navigation::GetInstance();
+    navigation.SetBuildCache(directory ? std::filesystem::path(directory) : std::filesystem::path());
+}
+
+void NAVIGATION_API navSetBuildReport(const char* path)
+{
+    auto& navigation = Navigation::GetInstance();
+    navigation.SetBuildReport(path ? std::filesystem::path(path) : std::filesystem::path());
+}
+
+std::uint32_t NAVIGATION_API navCrowdAddAgent(float* pos, float radius, float maxSpeed)
+{
+    auto* crowd = Navigation::GetInstance().GetCrowd(SELECTED_PROFILE);
+    if (!crowd || radius <= 0.0f || maxSpeed <= 0.0f) {
+        return 0u;
+    }
+
+    Vector3F position(pos);
+    std::swap(position.y_, position.z_);
+
+    CrowdAgentParams params;
+    params.radius_ = radius;
+    params.maxSpeed_ = maxSpeed;
+
+    return crowd->AddAgent(position, params);
+}
+
+bool NAVIGATION_API navCrowdRemoveAgent(std::uint32_t agent)
+{
+    auto* crowd = Navigation::GetInstance().FindAgentCrowd(agent);
+    return crowd && crowd->RemoveAgent(agent);
+}
+
+std::uint32_t NAVIGATION_API navCrowdSetTarget(std::uint32_t agentsNum, std::uint32_t* agents, float* targets)
+{
+    auto& navigation = Navigation::GetInstance();
+
+    std::uint32_t acceptedNum = 0u;
+    for (std::uint32_t i = 0; i < agentsNum; ++i) {
+        Vector3F target(&targets[i * 3]);
+        std::swap(target.y_, target.z_);
+
+        auto* crowd = navigation.FindAgentCrowd(agents[i]);
+        if (crowd && crowd->SetTarget(agents[i], target)) {
+            ++acceptedNum;
+        }
+    }
+
+    return acceptedNum;
+}
+
+void NAVIGATION_API navCrowdUpdate(float timeStep)
+{
+    Navigation::GetInstance().UpdateCrowd(timeStep);
+}
+
+std::uint32_t NAVIGATION_API navCrowdGetPositions(std::uint32_t agentsNum, std::uint32_t* agents, float* outPositions, float* outVelocities)
+{
+    auto& navigation = Navigation::GetInstance();
+
+    std::uint32_t foundNum = 0u;
+    for (std::uint32_t i = 0; i < agentsNum; ++i) {
+        Vector3F position;
+        Vector3F velocity;
+
+        auto* crowd = navigation.FindAgentCrowd(agents[i]);
+        if (const CrowdAgent* agent = crowd ? crowd->GetAgent(agents[i]) : nullptr) {
+            position = agent->position_;
+            velocity = agent->velocity_;
+            ++foundNum;
+        }
+
+        std::swap(position.y_, position.z_);
+        std::swap(velocity.y_, velocity.z_);
+
+        std::memcpy(&outPositions[i * 3], &position.x_, sizeof(Vector3F));
+        if (outVelocities) {
+            std::memcpy(&outVelocities[i * 3], &velocity.x_, sizeof(Vector3F));
+        }
+    }
+
+    return foundNum;
+}
+
 bool NAVIGATION_API navNearestPoint(float* pos, float* outPoint)
 {
     auto& navigation = Navigation::GetInstance();
-    auto* navmesh = navigation.GetNavMesh();
+    auto* navmesh = navigation.GetNavMesh(SELECTED_PROFILE);
     if (!navmesh) {
         return false;
     }
@@ -160,6 +413,142 @@ bool NAVIGATION_API navNearestPoint(float* pos, float* outPoint)
     return false;
 }
 
+bool NAVIGATION_API navNearestPoints(std::uint32_t pointsNum, float* points, float* extents, float* outPoints, std::uint32_t* outRefs)
+{
+    auto& navigation = Navigation::GetInstance();
+    if (!navigation.GetNavMesh(SELECTED_PROFILE) || !outPoints) {
+        return false;
+    }
+
+	Vector3F pointExtents(2.0f, 2.0f, 2.0f);
+    if (extents) {
+        pointExtents = Vector3F(extents);
+        std::swap(pointExtents.y_, pointExtents.z_);
+    }
+
+    NEAREST_BATCH_POINTS.resize(pointsNum);
+    for (std::uint32_t i = 0; i < pointsNum; ++i) {
+        Vector3F& point = NEAREST_BATCH_POINTS[i];
+        point = Vector3F(points + i * 3u);
+        std::swap(point.y_, point.z_);
+    }
+
+    navigation.FindNearestPoints(NEAREST_BATCH, NEAREST_BATCH_REFS, NEAREST_BATCH_POINTS, pointExtents, SELECTED_PROFILE);
+
+    WritePointsWithRefs(NEAREST_BATCH, NEAREST_BATCH_REFS, outPoints, outRefs);
+    return true;
+}
+
+bool NAVIGATION_API navRandomPoints(std::uint32_t pointsNum, float* outPoints, std::uint32_t* outRefs)
+{
+    if (!outPoints) {
+        return false;
+    }
+
+    auto& navigation = Navigation::GetInstance();
+    if (!navigation.FindRandomPoints(NEAREST_BATCH, NEAREST_BATCH_REFS, pointsNum, SELECTED_PROFILE)) {
+        return false;
+    }
+
+    WritePointsWithRefs(NEAREST_BATCH, NEAREST_BATCH_REFS, outPoints, outRefs);
+    return true;
+}
+
+bool NAVIGATION_API navRandomPointsAroundCircle(std::uint32_t centersNum, float* centers, float radius, float* outPoints, std::uint32_t* outRefs)
+{
+    auto& navigation = Navigation::GetInstance();
+    if (!navigation.GetNavMesh(SELECTED_PROFILE) || !outPoints) {
+        return false;
+    }
+
+    NEAREST_BATCH_POINTS.resize(centersNum);
+    for (std::uint32_t i = 0; i < centersNum; ++i) {
+        Vector3F& center = NEAREST_BATCH_POINTS[i];
+        center = Vector3F(centers + i * 3u);
+        std::swap(center.y_, center.z_);
+    }
+
+    navigation.FindRandomPointsAroundCircle(NEAREST_BATCH, NEAREST_BATCH_REFS, NEAREST_BATCH_POINTS, radius, Vector3F(2.0f, 2.0f, 2.0f), SELECTED_PROFILE);
+
+    WritePointsWithRefs(NEAREST_BATCH, NEAREST_BATCH_REFS, outPoints, outRefs);
+    return true;
+}
+
+bool NAVIGATION_API navRaycast(float* startPos, float* endPos, float* outPoint)
+{
+    auto* navmesh = Navigation::GetInstance().GetNavMesh(SELECTED_PROFILE);
+    if (!navmesh) {
+        return false;
+    }
+
+    Vector3F start(startPos);
+    Vector3F end(endPos);
+	Vector3F extents(2.0f, 2.0f, 2.0f);
+
+    std::swap(start.y_, start.z_);
+    std::swap(end.y_, end.z_);
+
+    NavigationRaycastResult result;
+    const bool walkable = navmesh->Raycast(result, start, end, extents);
+
+    if (outPoint) {
+        Vector3F point = result.position_;
+        std::swap(point.y_, point.z_);
+        std::memcpy(outPoint, &point.x_, sizeof(Vector3F));
+    }
+
+    return walkable;
+}
+
+bool NAVIGATION_API navRaycasts(std::uint32_t raysNum, float* startPositions, float* endPositions, bool* outWalkable, float* outFractions)
+{
+    auto& navigation = Navigation::GetInstance();
+    if (!navigation.GetNavMesh(SELECTED_PROFILE) || !outWalkable) {
+        return false;
+    }
+
+    RAYCAST_BATCH_REQUESTS.resize(raysNum);
+    for (std::uint32_t i = 0; i < raysNum; ++i) {
+        auto& request = RAYCAST_BATCH_REQUESTS[i];
+        request.start_ = Vector3F(startPositions + i * 3u);
+        request.end_ = Vector3F(endPositions + i * 3u);
+
+        std::swap(request.start_.y_, request.start_.z_);
+        std::swap(request.end_.y_, request.end_.z_);
+    }
+
+    navigation.Raycasts(RAYCAST_BATCH, RAYCAST_BATCH_REQUESTS, Vector3F(2.0f, 2.0f, 2.0f), SELECTED_PROFILE);
+
+    for (std::uint32_t i = 0; i < raysNum; ++i) {
+        outWalkable[i] = RAYCAST_BATCH[i].walkable_;
+
+        if (outFractions) {
+            outFractions[i] = RAYCAST_BATCH[i].fraction_;
+        }
+    }
+
+    return true;
+}
+
+std::uint32_t NAVIGATION_API navAddArea(float* boundsMin, float* boundsMax, std::uint32_t areaId)
+{
+    Vector3F min(boundsMin);
+    Vector3F max(boundsMax);
+    std::swap(min.y_, min.z_);
+    std::swap(max.y_, max.z_);
+
+    BoundingBox bounds;
+    bounds.Merge(min);
+    bounds.Merge(max);
+
+    return Navigation::GetInstance().AddNavArea(bounds, areaId);
+}
+
+bool NAVIGATION_API navRemoveArea(std::uint32_t area)
+{
+    return Navigation::GetInstance().RemoveNavArea(area);
+}
+
 bool NAVIGATION_API navDump(const char* filename)
 {
     auto& navigation = Navigation::GetInstance();
@@ -169,12 +558,44 @@ bool NAVIGATION_API navDump(const char* filename)
 bool NAVIGATION_API navBuild()
 {
     auto& navigation = Navigation::GetInstance(); 
-    auto* navmesh = navigation.GetNavMesh();
-    if (navmesh) {
-        return navmesh->Build();
+    return navigation.Build();
+}
+
+bool NAVIGATION_API navBuildChanged()
+{
+    auto& navigation = Navigation::GetInstance();
+    return navigation.Build(true);
+}
+
+bool NAVIGATION_API navBuildAsync(bool changedOnly)
+{
+    auto& navigation = Navigation::GetInstance();
+    return navigation.BuildAsync(changedOnly);
+}
+
+bool NAVIGATION_API navBuildStatus(bool* outBuilding, std::uint32_t* outTilesDone, std::uint32_t* outTilesTotal, float* outEta)
+{
+    auto& navigation = Navigation::GetInstance();
+
+    // There is no pulse in the native API, a finished build is swapped in when its status is asked for
+    const bool swapped = navigation.UpdateBuild();
+    navigation.UpdateLandmarks();
+    const NavigationBuildStatus status = navigation.GetBuildStatus();
+
+    if (outBuilding) {
+        *outBuilding = status.building_;
+    }
+    if (outTilesDone) {
+        *outTilesDone = status.tilesDone_;
+    }
+    if (outTilesTotal) {
+        *outTilesTotal = status.tilesTotal_;
+    }
+    if (outEta) {
+        *outEta = status.eta_;
     }
 
-    return false;
+    return swapped;
 }
 
 bool NAVIGATION_API navCollisionMesh(float* boundsMin, float* boundsMax, float bias, std::uint32_t* outVerticesNum, float* outVertices)
@@ -190,7 +611,8 @@ bool NAVIGATION_API navCollisionMesh(float* boundsMin, float* boundsMax, float b
 
     NavigationArguments args = {
         .pointStart_{ boundsMin },
-        .pointEnd_{ boundsMax }
+        .pointEnd_{ boundsMax },
+        .extents_{}
     };
 
     std::swap(args.pointStart_.y_, args.pointStart_.z_);
@@ -249,14 +671,15 @@ bool NAVIGATION_API navNavigationMesh(float* boundsMin, float* boundsMax, float
         return false;
     }
 
-    auto* navmesh = Navigation::GetInstance().GetNavMesh();
+    auto* navmesh = Navigation::GetInstance().GetNavMesh(SELECTED_PROFILE);
     if (!navmesh) {
         return false;
     }
 
     NavigationArguments args = {
         .pointStart_{ boundsMin },
-        .pointEnd_{ boundsMax }
+        .pointEnd_{ boundsMax },
+        .extents_{}
     };
 
     std::swap(args.pointStart_.y_, args.pointStart_.z_);
@@ -308,7 +731,8 @@ bool NAVIGATION_API navScanWorld(float* boundsMin, float* boundsMax, std::uint32
 
     NavigationArguments args = {
         .pointStart_{ boundsMin },
-        .pointEnd_{ boundsMax }
+        .pointEnd_{ boundsMax },
+        .extents_{}
     };
 
     std::swap(args.pointStart_.y_, args.pointStart_.z_);
@@ -34,14 +34,60 @@ extern "C"
 
 	bool NAVIGATION_API navSave(const char* filename);
 
+	bool NAVIGATION_API navAddProfile(const char* name, float agentRadius, float agentHeight, float agentMaxClimb, float agentMaxSlope);
+
+	bool NAVIGATION_API navAddInstance(const char* name, std::int32_t interior, std::int32_t dimension, const char* profile);
+
+	bool NAVIGATION_API navSelectProfile(const char* name);
+
 	bool NAVIGATION_API navFindPath(float* startPos, float* endPos, std::uint32_t* outPointsNum, float* outPoints);
 
+	bool NAVIGATION_API navFindPaths(std::uint32_t pathsNum, float* startPositions, float* endPositions, std::uint32_t* outPathsPointsNum, std::uint32_t* outPointsNum, float* outPoints);
+
+	bool NAVIGATION_API navIsReachable(float* startPos, float* endPos);
+
+	bool NAVIGATION_API navFlowFieldNextPoint(float* goalPos, float* pos, float* outPoint, float* outDistance);
+
+	void NAVIGATION_API navSetBuildCache(const char* directory);
+
+	void NAVIGATION_API navSetBuildReport(const char* path);
+
+	std::uint32_t NAVIGATION_API navCrowdAddAgent(float* pos, float radius, float maxSpeed);
+
+	bool NAVIGATION_API navCrowdRemoveAgent(std::uint32_t agent);
+
+	std::uint32_t NAVIGATION_API navCrowdSetTarget(std::uint32_t agentsNum, std::uint32_t* agents, float* targets);
+
+	void NAVIGATION_API navCrowdUpdate(float timeStep);
+
+	std::uint32_t NAVIGATION_API navCrowdGetPositions(std::uint32_t agentsNum, std::uint32_t* agents, float* outPositions, float* outVelocities);
+
 	bool NAVIGATION_API navNearestPoint(float* point, float* outPoint);
 
+	bool NAVIGATION_API navNearestPoints(std::uint32_t pointsNum, float* points, float* extents, float* outPoints, std::uint32_t* outRefs);
+
+	bool NAVIGATION_API navRandomPoints(std::uint32_t pointsNum, float* outPoints, std::uint32_t* outRefs);
+
+	bool NAVIGATION_API navRandomPointsAroundCircle(std::uint32_t centersNum, float* centers, float radius, float* outPoints, std::uint32_t* outRefs);
+
+	bool NAVIGATION_API navRaycast(float* startPos, float* endPos, float* outPoint);
+
+	bool NAVIGATION_API navRaycasts(std::uint32_t raysNum, float* startPositions, float* endPositions, bool* outWalkable, float* outFractions);
+
+	std::uint32_t NAVIGATION_API navAddArea(float* boundsMin, float* boundsMax, std::uint32_t areaId);
+
+	bool NAVIGATION_API navRemoveArea(std::uint32_t area);
+
 	bool NAVIGATION_API navDump(const char* filename);
 
 	bool NAVIGATION_API navBuild();
 
+	bool NAVIGATION_API navBuildChanged();
+
+	bool NAVIGATION_API navBuildAsync(bool changedOnly);
+
+	bool NAVIGATION_API navBuildStatus(bool* outBuilding, std::uint32_t* outTilesDone, std::uint32_t* outTilesTotal, float* outEta);
+
 	bool NAVIGATION_API navCollisionMesh(float* boundsMin, float* boundsMax, float bias, std::uint32_t* outVerticesNum, float* outVertices);
 
 	bool NAVIGATION_API navNavigationMesh(float* boundsMin, float* boundsMax, float bias, std::uint32_t* outVerticesNum, float* outVertices);
@@ -0,0 +1,594 @@
+#include "../navigation/Crowd.h"
+#include "../navigation/NavigationMesh.h"
+
+#include <DetourNavMesh.h>
+#include <DetourNavMeshQuery.h>
+
+#include <cmath>
+
+#include "thread_pool/thread_pool.hpp"
+
+namespace WorldAssistant
+{
+
+// Maximum number of corridors planned in one update.
+static const unsigned CROWD_MAX_PATHS_PER_UPDATE = 8;
+// Smallest crowd worth spreading over the workers.
+static const std::size_t CROWD_PARALLEL_AGENTS = 64;
+// Number of path corners looked ahead when steering.
+static const int CROWD_MAX_CORNERS = 4;
+// Number of corridor polygons checked for removal by a rebuild.
+static const std::size_t CROWD_CHECK_LOOKAHEAD = 10;
+// Maximum number of polygons crossed by a single move.
+static const int CROWD_MAX_VISITED = 16;
+// Corners closer than this are treated as reached.
+static const float CROWD_MIN_CORNER_DISTANCE = 0.01f;
+// Share of the overlap removed per collision iteration.
+static const float CROWD_COLLISION_RESOLVE_FACTOR = 0.7f;
+// Number of collision iterations.
+static const unsigned CROWD_COLLISION_ITERATIONS = 4;
+
+namespace
+{
+
+// Return horizontal distance between points.
+float Distance2D(const Vector3F& lhs, const Vector3F& rhs)
+{
+    const float dx = lhs.x_ - rhs.x_;
+    const float dz = lhs.z_ - rhs.z_;
+    return std::sqrt(dx * dx + dz * dz);
+}
+
+// Pack grid cell coordinates into a key.
+std::uint64_t MakeCellKey(int x, int z)
+{
+    return (static_cast<std::uint64_t>(static_cast<std::uint32_t>(x)) << 32u) | static_cast<std::uint32_t>(z);
+}
+
+// Replace the beginning of the corridor with the polygons visited by a move, as dtMergeCorridorStartMoved does.
+void MergeCorridorStart(std::vector<dtPolyRef>& corridor, const dtPolyRef* visited, int numVisited)
+{
+    int furthestPath = -1;
+    int furthestVisited = -1;
+
+    // Find furthest common polygon
+    for (int i = static_cast<int>(corridor.size()) - 1; i >= 0 && furthestPath < 0; --i)
+    {
+        for (int j = numVisited - 1; j >= 0; --j)
+        {
+            if (corridor[i] == visited[j])
+            {
+                furthestPath = i;
+                furthestVisited = j;
+                break;
+            }
+        }
+    }
+
+    // The move left the corridor, it is kept and the agent is replanned on the next check
+    if (furthestPath < 0)
+        return;
+
+    // Visited polygons past the common one lead back to it in reverse
+    corridor.erase(corridor.begin(), corridor.begin() + furthestPath + 1);
+    corridor.insert(corridor.begin(), std::make_reverse_iterator(visited + numVisited), std::make_reverse_iterator(visited + furthestVisited));
+}
+
+}
+
+/*
+    Crowd
+*/
+unsigned Crowd::nextAgentId_ = 1;
+
+Crowd::Crowd(NavigationMesh* navigationMesh) :
+    navigationMesh_(navigationMesh)
+{
+}
+
+unsigned Crowd::AddAgent(const Vector3F& position, const CrowdAgentParams& params)
+{
+    NavigationQueryLease query = navigationMesh_->AcquireQuery();
+    if (!query)
+        return 0;
+
+    CrowdAgent agent;
+    query->query_->findNearestPoly(&position.x_, &extents_.x_, navigationMesh_->queryFilter_, &agent.polyRef_, &agent.position_.x_);
+    if (!agent.polyRef_)
+        return 0;
+
+    agent.id_ = nextAgentId_++;
+    if (nextAgentId_ == 0)
+        nextAgentId_ = 1;
+
+    agent.params_ = params;
+    agent.nextPosition_ = agent.position_;
+    agent.target_ = agent.position_;
+
+    lookup_[agent.id_] = agents_.size();
+    agents_.push_back(std::move(agent));
+
+    return agents_.back().id_;
+}
+
+bool Crowd::RemoveAgent(unsigned id)
+{
+    auto found = lookup_.find(id);
+    if (found == lookup_.end())
+        return false;
+
+    const std::size_t index = found->second;
+    lookup_.erase(found);
+
+    // The last agent takes the place of the removed one
+    if (index + 1 != agents_.size())
+    {
+        agents_[index] = std::move(agents_.back());
+        lookup_[agents_[index].id_] = index;
+    }
+
+    agents_.pop_back();
+    return true;
+}
+
+bool Crowd::SetTarget(unsigned id, const Vector3F& target)
+{
+    CrowdAgent* agent = FindAgent(id);
+    if (!agent)
+        return false;
+
+    agent->target_ = target;
+    agent->targetRef_ = 0;
+    agent->state_ = CROWD_AGENT_MOVING;
+    agent->pathPending_ = true;
+    return true;
+}
+
+void Crowd::Clear()
+{
+    agents_.clear();
+    lookup_.clear();
+    grid_.clear();
+    nextPathAgent_ = 0;
+}
+
+void Crowd::ResetPaths()
+{
+    for (auto& agent : agents_)
+    {
+        agent.polyRef_ = 0;
+        agent.targetRef_ = 0;
+        agent.offMeshRef_ = 0;
+        agent.corridor_.clear();
+        agent.velocity_ = Vector3F();
+        agent.pathPending_ = agent.state_ == CROWD_AGENT_MOVING;
+    }
+}
+
+void Crowd::SetNavigationMesh(NavigationMesh* navigationMesh)
+{
+    navigationMesh_ = navigationMesh;
+    ResetPaths();
+}
+
+template <class T> void Crowd::ForEachAgent(NavigationQuery& query, thread_pool* workers, const T& callback)
+{
+    if (!workers || agents_.size() < CROWD_PARALLEL_AGENTS)
+    {
+        for (auto& agent : agents_)
+            callback(query, agent);
+
+        return;
+    }
+
+    // Every block leases its own query context
+    workers->parallelize_loop(std::size_t(0), agents_.size(), [this, &callback](std::size_t from, std::size_t to) {
+        NavigationQueryLease blockQuery = navigationMesh_->AcquireQuery();
+        if (!blockQuery)
+            return;
+
+        for (std::size_t i = from; i < to; ++i)
+            callback(*blockQuery, agents_[i]);
+    });
+}
+
+void Crowd::Update(float timeStep, thread_pool* workers)
+{
+    if (agents_.empty() || !navigationMesh_->navMesh_ || timeStep <= 0.0f)
+        return;
+
+    NavigationQueryLease query = navigationMesh_->AcquireQuery();
+    if (!query)
+        return;
+
+    for (auto& agent : agents_)
+        CheckAgent(*query, agent);
+
+    UpdatePaths(*query);
+    UpdateNeighbours();
+
+    // Neighbours are read and not written until the collisions, so the agents can be steered independently
+    ForEachAgent(*query, workers, [this, timeStep](NavigationQuery& blockQuery, CrowdAgent& agent) {
+        UpdateSteering(blockQuery, agent, timeStep);
+    });
+
+    ResolveCollisions();
+
+    ForEachAgent(*query, workers, [this](NavigationQuery& blockQuery, CrowdAgent& agent) {
+        UpdatePosition(blockQuery, agent);
+    });
+}
+
+const CrowdAgent* Crowd::GetAgent(unsigned id) const
+{
+    auto found = lookup_.find(id);
+    return found != lookup_.end() ? &agents_[found->second] : nullptr;
+}
+
+CrowdAgent* Crowd::FindAgent(unsigned id)
+{
+    auto found = lookup_.find(id);
+    return found != lookup_.end() ? &agents_[found->second] : nullptr;
+}
+
+void Crowd::CheckAgent(NavigationQuery& query, CrowdAgent& agent)
+{
+    const dtNavMesh* navMesh = navigationMesh_->navMesh_;
+    const dtQueryFilter* filter = navigationMesh_->queryFilter_;
+
+    // Rebuilt tiles may have removed the polygon under the agent
+    if (!agent.polyRef_ || !navMesh->isValidPolyRef(agent.polyRef_))
+    {
+        Vector3F nearest;
+        agent.polyRef_ = 0;
+        query.query_->findNearestPoly(&agent.position_.x_, &extents_.x_, filter, &agent.polyRef_, &nearest.x_);
+        if (!agent.polyRef_)
+        {
+            agent.velocity_ = Vector3F();
+            return;
+        }
+
+        agent.position_ = nearest;
+        agent.corridor_.clear();
+        agent.pathPending_ = agent.state_ == CROWD_AGENT_MOVING;
+    }
+
+    if (agent.state_ != CROWD_AGENT_MOVING || agent.pathPending_)
+        return;
+
+    if (agent.corridor_.empty() || agent.corridor_.front() != agent.polyRef_)
+    {
+        agent.pathPending_ = true;
+        return;
+    }
+
+    const std::size_t lookahead = std::min(agent.corridor_.size(), CROWD_CHECK_LOOKAHEAD);
+    for (std::size_t i = 0; i < lookahead; ++i)
+    {
+        if (!navMesh->isValidPolyRef(agent.corridor_[i]))
+        {
+            agent.pathPending_ = true;
+            return;
+        }
+    }
+
+    if (agent.targetRef_ && !navMesh->isValidPolyRef(agent.targetRef_))
+    {
+        agent.targetRef_ = 0;
+        agent.pathPending_ = true;
+    }
+}
+
+void Crowd::UpdatePaths(NavigationQuery& query)
+{
+    const dtQueryFilter* filter = navigationMesh_->queryFilter_;
+
+    // Agents take turns so a crowd sent off at once does not stall the pulse
+    unsigned numPlanned = 0;
+    for (std::size_t i = 0; i < agents_.size() && numPlanned < CROWD_MAX_PATHS_PER_UPDATE; ++i)
+    {
+        CrowdAgent& agent = agents_[(nextPathAgent_ + i) % agents_.size()];
+        if (!agent.pathPending_ || !agent.polyRef_)
+            continue;
+
+        agent.pathPending_ = false;
+        agent.offMeshRef_ = 0;
+        agent.corridor_.clear();
+        ++numPlanned;
+
+        if (!agent.targetRef_)
+        {
+            Vector3F target;
+            query.query_->findNearestPoly(&agent.target_.x_, &extents_.x_, filter, &agent.targetRef_, &target.x_);
+            if (agent.targetRef_)
+                agent.target_ = target;
+        }
+
+        if (!agent.targetRef_ || !navigationMesh_->graph_->IsReachable(navigationMesh_->navMesh_, agent.polyRef_, agent.targetRef_))
+        {
+            agent.state_ = CROWD_AGENT_FAILED;
+            continue;
+        }
+
+        const dtPolyRef* corridor = nullptr;
+        const int numPolys = navigationMesh_->FindCorridor(query, agent.polyRef_, agent.targetRef_, agent.position_, agent.target_, filter, corridor);
+        if (!numPolys || corridor[0] != agent.polyRef_)
+        {
+            agent.state_ = CROWD_AGENT_FAILED;
+            continue;
+        }
+
+        agent.corridor_.assign(corridor, corridor + numPolys);
+
+        // A partial corridor ends at the polygon closest to the target, it is planned further once the agent gets there
+        agent.corridorEnd_ = agent.target_;
+        if (agent.corridor_.back() != agent.targetRef_)
+            query.query_->closestPointOnPoly(agent.corridor_.back(), &agent.target_.x_, &agent.corridorEnd_.x_, nullptr);
+
+        agent.state_ = CROWD_AGENT_MOVING;
+    }
+
+    nextPathAgent_ = agents_.empty() ? 0 : (nextPathAgent_ + 1) % agents_.size();
+}
+
+void Crowd::UpdateNeighbours()
+{
+    float maxRadius = 0.0f;
+    for (const auto& agent : agents_)
+        maxRadius = std::max(maxRadius, agent.params_.radius_);
+
+    // Neighbours are looked up within twice the sum of the radii, a cell covers that for the largest agents
+    const float cellSize = std::max(maxRadius * 4.0f, 1.0f);
+
+    for (auto& [key, cell] : grid_)
+        cell.clear();
+
+    for (unsigned i = 0; i < agents_.size(); ++i)
+    {
+        const Vector3F& position = agents_[i].position_;
+        grid_[MakeCellKey(static_cast<int>(std::floor(position.x_ / cellSize)), static_cast<int>(std::floor(position.z_ / cellSize)))].push_back(i);
+    }
+
+    for (unsigned i = 0; i < agents_.size(); ++i)
+    {
+        CrowdAgent& agent = agents_[i];
+        agent.numNeighbours_ = 0;
+
+        std::array<float, CROWD_MAX_NEIGHBOURS> distances;
+        const int cellX = static_cast<int>(std::floor(agent.position_.x_ / cellSize));
+        const int cellZ = static_cast<int>(std::floor(agent.position_.z_ / cellSize));
+
+        for (int z = cellZ - 1; z <= cellZ + 1; ++z)
+        {
+            for (int x = cellX - 1; x <= cellX + 1; ++x)
+            {
+                auto found = grid_.find(MakeCellKey(x, z));
+                if (found == grid_.end())
+                    continue;
+
+                for (unsigned j : found->second)
+                {
+                    if (j == i)
+                        continue;
+
+                    const CrowdAgent& other = agents_[j];
+                    if (std::abs(agent.position_.y_ - other.position_.y_) >= (agent.params_.height_ + other.params_.height_) * 0.5f)
+                        continue;
+
+                    const float distance = Distance2D(agent.position_, other.position_);
+                    if (distance > (agent.params_.radius_ + other.params_.radius_) * 2.0f)
+                        continue;
+
+                    // Keep the nearest ones sorted by distance
+                    unsigned slot = agent.numNeighbours_;
+                    while (slot > 0 && distances[slot - 1] > distance)
+                        --slot;
+
+                    if (slot >= CROWD_MAX_NEIGHBOURS)
+                        continue;
+
+                    const unsigned last = std::min(agent.numNeighbours_, CROWD_MAX_NEIGHBOURS - 1);
+                    for (unsigned k = last; k > slot; --k)
+                    {
+                        agent.neighbours_[k] = agent.neighbours_[k - 1];
+                        distances[k] = distances[k - 1];
+                    }
+
+                    agent.neighbours_[slot] = j;
+                    distances[slot] = distance;
+                    agent.numNeighbours_ = std::min(agent.numNeighbours_ + 1, CROWD_MAX_NEIGHBOURS);
+                }
+            }
+        }
+    }
+}
+
+void Crowd::UpdateSteering(NavigationQuery& query, CrowdAgent& agent, float timeStep)
+{
+    const CrowdAgentParams& params = agent.params_;
+    Vector3F desiredVelocity;
+    float desiredSpeed = 0.0f;
+
+    agent.offMeshRef_ = 0;
+
+    if (agent.state_ == CROWD_AGENT_MOVING && agent.polyRef_ && !agent.corridor_.empty())
+    {
+        Vector3F corners[CROWD_MAX_CORNERS];
+        unsigned char cornerFlags[CROWD_MAX_CORNERS];
+        dtPolyRef cornerRefs[CROWD_MAX_CORNERS];
+        int numCorners = 0;
+        query.query_->findStraightPath(&agent.position_.x_, &agent.corridorEnd_.x_, agent.corridor_.data(), static_cast<int>(agent.corridor_.size()),
+            &corners[0].x_, cornerFlags, cornerRefs, &numCorners, CROWD_MAX_CORNERS);
+
+        // The first corners may be the ones the agent stands on
+        int next = 0;
+        while (next < numCorners - 1 && !(cornerFlags[next] & DT_STRAIGHTPATH_OFFMESH_CONNECTION) &&
+            Distance2D(corners[next], agent.position_) < CROWD_MIN_CORNER_DISTANCE)
+        {
+            ++next;
+        }
+
+        const bool complete = agent.corridor_.back() == agent.targetRef_;
+        const float endDistance = Distance2D(agent.corridorEnd_, agent.position_);
+
+        if (complete && endDistance < params.radius_ * 0.5f)
+        {
+            agent.state_ = CROWD_AGENT_ARRIVED;
+            agent.corridor_.clear();
+        }
+        else if (!complete && endDistance < params.radius_ * 4.0f)
+        {
+            // Extend the partial corridor before the agent stops at its end
+            agent.pathPending_ = true;
+        }
+
+        if (agent.state_ == CROWD_AGENT_MOVING && numCorners > 0)
+        {
+            const Vector3F& corner = corners[next];
+            Vector3F direction(corner.x_ - agent.position_.x_, 0.0f, corner.z_ - agent.position_.z_);
+            const float distance = direction.Length();
+
+            if ((cornerFlags[next] & DT_STRAIGHTPATH_OFFMESH_CONNECTION) && distance < params.radius_ * 2.25f)
+                agent.offMeshRef_ = cornerRefs[next];
+
+            // Slow down when approaching the end of the corridor
+            desiredSpeed = params.maxSpeed_;
+            if (complete && next == numCorners - 1)
+                desiredSpeed *= std::min(endDistance / (params.radius_ * 2.0f), 1.0f);
+
+            if (distance > 0.0f)
+                desiredVelocity = direction * (desiredSpeed / distance);
+        }
+    }
+
+    // Neighbours push the agent away the more the closer they are
+    Vector3F separation;
+    for (unsigned i = 0; i < agent.numNeighbours_; ++i)
+    {
+        const CrowdAgent& other = agents_[agent.neighbours_[i]];
+        Vector3F difference(agent.position_.x_ - other.position_.x_, 0.0f, agent.position_.z_ - other.position_.z_);
+        const float distance = difference.Length();
+        const float range = (params.radius_ + other.params_.radius_) * 2.0f;
+        if (distance < 0.0001f || distance > range)
+            continue;
+
+        const float weight = params.separationWeight_ * (1.0f - (distance * distance) / (range * range));
+        separation += difference * (weight / distance);
+    }
+
+    desiredVelocity += separation * desiredSpeed;
+
+    // Separation must not make the agent faster than it wants to go
+    const float speed = desiredVelocity.Length();
+    if (speed > desiredSpeed && speed > 0.0f)
+        desiredVelocity = desiredVelocity * (desiredSpeed / speed);
+
+    Vector3F change = desiredVelocity - agent.velocity_;
+    const float maxChange = params.maxAcceleration_ * timeStep;
+    const float changeLength = change.Length();
+    if (changeLength > maxChange)
+        change = change * (maxChange / changeLength);
+
+    agent.velocity_ += change;
+    agent.nextPosition_ = agent.position_ + agent.velocity_ * timeStep;
+}
+
+void Crowd::ResolveCollisions()
+{
+    std::vector<Vector3F> displacements(agents_.size());
+
+    for (unsigned iteration = 0; iteration < CROWD_COLLISION_ITERATIONS; ++iteration)
+    {
+        for (std::size_t i = 0; i < agents_.size(); ++i)
+        {
+            const CrowdAgent& agent = agents_[i];
+            Vector3F displacement;
+            float weight = 0.0f;
+
+            for (unsigned j = 0; j < agent.numNeighbours_; ++j)
+            {
+                const CrowdAgent& other = agents_[agent.neighbours_[j]];
+                Vector3F difference(agent.nextPosition_.x_ - other.nextPosition_.x_, 0.0f, agent.nextPosition_.z_ - other.nextPosition_.z_);
+                const float distance = difference.Length();
+                const float overlap = agent.params_.radius_ + other.params_.radius_ - distance;
+                if (overlap <= 0.0f)
+                    continue;
+
+                // Agents on top of each other are split sideways to their movement, the one with the lower ID moves
+                if (distance < 0.0001f)
+                {
+                    if (agent.id_ > other.id_)
+                        continue;
+
+                    difference = Vector3F(-agent.velocity_.z_, 0.0f, agent.velocity_.x_);
+                    if (difference.LengthSquared() < 0.0001f)
+                        difference = Vector3F(1.0f, 0.0f, 0.0f);
+
+                    displacement += difference * (overlap * 0.5f * CROWD_COLLISION_RESOLVE_FACTOR / difference.Length());
+                }
+                else
+                    displacement += difference * (overlap * 0.5f * CROWD_COLLISION_RESOLVE_FACTOR / distance);
+
+                weight += 1.0f;
+            }
+
+            displacements[i] = weight > 0.0f ? displacement * (1.0f / weight) : Vector3F();
+        }
+
+        for (std::size_t i = 0; i < agents_.size(); ++i)
+            agents_[i].nextPosition_ += displacements[i];
+    }
+}
+
+void Crowd::UpdatePosition(NavigationQuery& query, CrowdAgent& agent)
+{
+    if (!agent.polyRef_)
+        return;
+
+    const dtNavMesh* navMesh = navigationMesh_->navMesh_;
+
+    // Off-mesh connections cannot be walked over, the agent is put to their other end
+    if (agent.offMeshRef_)
+    {
+        auto found = std::find(agent.corridor_.begin(), agent.corridor_.end(), agent.offMeshRef_);
+        if (found != agent.corridor_.end() && found != agent.corridor_.begin() && found + 1 != agent.corridor_.end())
+        {
+            Vector3F startPoint;
+            Vector3F endPoint;
+            if (dtStatusSucceed(navMesh->getOffMeshConnectionPolyEndPoints(*(found - 1), agent.offMeshRef_, &startPoint.x_, &endPoint.x_)))
+            {
+                agent.corridor_.erase(agent.corridor_.begin(), found + 1);
+                agent.polyRef_ = agent.corridor_.front();
+                agent.position_ = endPoint;
+                agent.nextPosition_ = endPoint;
+                agent.offMeshRef_ = 0;
+                return;
+            }
+        }
+
+        agent.offMeshRef_ = 0;
+    }
+
+    Vector3F result;
+    dtPolyRef visited[CROWD_MAX_VISITED];
+    int numVisited = 0;
+    const dtStatus status = query.query_->moveAlongSurface(agent.polyRef_, &agent.position_.x_, &agent.nextPosition_.x_, navigationMesh_->queryFilter_,
+        &result.x_, visited, &numVisited, CROWD_MAX_VISITED);
+
+    if (dtStatusFailed(status) || !numVisited)
+        return;
+
+    agent.polyRef_ = visited[numVisited - 1];
+    if (!agent.corridor_.empty())
+        MergeCorridorStart(agent.corridor_, visited, numVisited);
+
+    // The surface move keeps the height of the start, it is taken from the polygon instead
+    float height;
+    if (dtStatusSucceed(query.query_->getPolyHeight(agent.polyRef_, &result.x_, &height)))
+        result.y_ = height;
+
+    agent.position_ = result;
+    agent.nextPosition_ = result;
+}
+
+}
\ No newline at end of file
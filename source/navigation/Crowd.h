@@ -0,0 +1,150 @@
+#pragma once
+
+#include <array>
+#include <vector>
+#include <unordered_map>
+
+#include "../navigation/NavigationQuery.h"
+#include "../utils/MathUtils.h"
+
+class thread_pool;
+
+namespace WorldAssistant
+{
+
+class NavigationMesh;
+
+// Maximum number of neighbours an agent steers away from.
+static const unsigned CROWD_MAX_NEIGHBOURS = 6;
+
+enum CrowdAgentState
+{
+    // Standing without a target.
+    CROWD_AGENT_IDLE = 0,
+    // Walking toward the target.
+    CROWD_AGENT_MOVING,
+    // Reached the target.
+    CROWD_AGENT_ARRIVED,
+    // The target could not be reached.
+    CROWD_AGENT_FAILED
+};
+
+// Movement settings of an agent.
+struct CrowdAgentParams
+{
+    // Radius used for separation and collisions.
+    float radius_{0.6f};
+    // Height, agents further apart vertically do not interact.
+    float height_{2.0f};
+    // Maximum speed.
+    float maxSpeed_{2.0f};
+    // Maximum change of velocity per second.
+    float maxAcceleration_{8.0f};
+    // How strongly the agent keeps away from its neighbours.
+    float separationWeight_{2.0f};
+};
+
+// Agent walking over the navigation mesh along a polygon corridor.
+struct CrowdAgent
+{
+    // Agent ID, never zero.
+    unsigned id_{};
+    // Movement settings.
+    CrowdAgentParams params_;
+    // Current state.
+    CrowdAgentState state_{CROWD_AGENT_IDLE};
+    // Position on the navigation mesh.
+    Vector3F position_;
+    // Position the agent is moving to in this update.
+    Vector3F nextPosition_;
+    // Current velocity.
+    Vector3F velocity_;
+    // Polygon the agent stands on, zero if off the navigation mesh.
+    dtPolyRef polyRef_{};
+    // Requested target.
+    Vector3F target_;
+    // Polygon of the target.
+    dtPolyRef targetRef_{};
+    // Polygons from the current one toward the target.
+    std::vector<dtPolyRef> corridor_;
+    // Point on the last corridor polygon the agent walks to. Differs from the target if the corridor is partial.
+    Vector3F corridorEnd_;
+    // Off-mesh connection the agent is about to take, zero if none.
+    dtPolyRef offMeshRef_{};
+    // Whether the corridor must be planned again.
+    bool pathPending_{};
+    // Indices of the nearest agents.
+    std::array<unsigned, CROWD_MAX_NEIGHBOURS> neighbours_{};
+    // Number of neighbours.
+    unsigned numNeighbours_{};
+};
+
+// Agents steered over the navigation mesh. Corridors are planned a few at a time, agents keep apart from each other and slide along the mesh borders.
+// Not thread safe, it is updated once per pulse from the main thread.
+class Crowd
+{
+public:
+    // Construct for the navigation mesh.
+    explicit Crowd(NavigationMesh* navigationMesh);
+
+    // Add an agent at the position snapped to the navigation mesh. Return agent ID, zero if the position is off the navigation mesh.
+    unsigned AddAgent(const Vector3F& position, const CrowdAgentParams& params);
+    // Remove an agent. Return false if there is no such agent.
+    bool RemoveAgent(unsigned id);
+    // Send the agent toward the target. Return false if there is no such agent.
+    bool SetTarget(unsigned id, const Vector3F& target);
+    // Remove all agents.
+    void Clear();
+    // Snap the agents to the navigation mesh again and replan their corridors. Call once the navigation mesh is rebuilt or reloaded.
+    void ResetPaths();
+    // Move the agents over to another navigation mesh, e.g. one built in the background. Their paths are reset.
+    void SetNavigationMesh(NavigationMesh* navigationMesh);
+
+    // Move the agents by the time step in seconds. Steering and movement are spread over the workers if given.
+    void Update(float timeStep, thread_pool* workers = nullptr);
+
+    // Return agent by ID, null if there is no such agent.
+    const CrowdAgent* GetAgent(unsigned id) const;
+    // Return all agents.
+    const std::vector<CrowdAgent>& GetAgents() const { return agents_; }
+
+    // Set how far off the navigation mesh positions and targets are looked up.
+    void SetExtents(const Vector3F& extents) { extents_ = extents; }
+    // Return how far off the navigation mesh positions and targets are looked up.
+    const Vector3F& GetExtents() const { return extents_; }
+
+private:
+    // Return agent by ID, null if there is no such agent.
+    CrowdAgent* FindAgent(unsigned id);
+    // Snap agents left off the navigation mesh and flag broken corridors for replanning.
+    void CheckAgent(NavigationQuery& query, CrowdAgent& agent);
+    // Plan corridors of a few flagged agents.
+    void UpdatePaths(NavigationQuery& query);
+    // Find the nearest neighbours of every agent.
+    void UpdateNeighbours();
+    // Steer the agent along its corridor and away from its neighbours.
+    void UpdateSteering(NavigationQuery& query, CrowdAgent& agent, float timeStep);
+    // Push overlapping agents apart.
+    void ResolveCollisions();
+    // Move the agent along the navigation mesh surface and advance its corridor.
+    void UpdatePosition(NavigationQuery& query, CrowdAgent& agent);
+    // Run the callback for every agent, on the workers if the crowd is large enough.
+    template <class T> void ForEachAgent(NavigationQuery& query, thread_pool* workers, const T& callback);
+
+    // Navigation mesh the agents walk on.
+    NavigationMesh* navigationMesh_;
+    // Agents.
+    std::vector<CrowdAgent> agents_;
+    // Agent index by ID.
+    std::unordered_map<unsigned, std::size_t> lookup_;
+    // Agent indices by grid cell, rebuilt every update.
+    std::unordered_map<std::uint64_t, std::vector<unsigned>> grid_;
+    // Search extents.
+    Vector3F extents_{2.0f, 2.0f, 2.0f};
+    // Next agent ID, shared by all crowds so that an agent ID tells its crowd.
+    static unsigned nextAgentId_;
+    // Agent index the next corridor planning starts from.
+    std::size_t nextPathAgent_{};
+};
+
+}
\ No newline at end of file
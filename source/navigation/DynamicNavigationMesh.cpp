@@ -1,11 +1,20 @@
+#include <algorithm>
+#include <condition_variable>
 #include <fstream>
+#include <map>
+#include <mutex>
 
 #include "../navigation/DynamicNavigationMesh.h"
 #include "../navigation/NavBuildData.h"
+#include "../navigation/NavBuildReport.h"
 #include "../navigation/Obstacle.h"
+#include "../navigation/TileBuildCache.h"
+#include "../navigation/TileBuildScheduler.h"
+#include "../navigation/TileGeometryStore.h"
 #include "../scene/Scene.h"
 #include "../scene/World.h"
 #include "../utils/DebugMesh.h"
+#include "../utils/UtilsHash.h"
 
 #include <spdlog/spdlog.h>
 #include "LZ4/lz4.h"
@@ -22,6 +31,14 @@ namespace WorldAssistant
 
 static const std::size_t TILECACHE_MAXLAYERS = 255u;
 static const std::int32_t DEFAULT_MAX_LAYERS = 1;
+static const char* LANDMARK_FILE_ID = "LMRK";
+static const char* TILE_HASHES_FILE_ID = "TLHS";
+// Version of the tile build, part of every tile input hash. Bump it whenever BuildTile makes different layers from the same input.
+static const std::uint32_t TILE_BUILD_VERSION = 1u;
+// Estimated cost of building a tile without triangles, in triangles. Covers the heightfield passes every tile pays for.
+static const std::uint64_t BUILD_TILE_BASE_COST = 256u;
+// Number of tiles per worker the build may run ahead of the committer.
+static const std::uint32_t BUILD_WINDOW_TILES_PER_THREAD = 16u;
 
 struct TileCompressor : public dtTileCacheCompressor
 {
@@ -61,6 +78,9 @@ struct MeshProcess : public dtTileCacheMeshProcess
 
     void process(struct dtNavMeshCreateParams* params, unsigned char* polyAreas, unsigned short* polyFlags) override
     {
+        // Every navigation mesh tile build passes here, including obstacle updates
+        owner_->TileChanged(Int32Vector2(params->tileX, params->tileY));
+
         // Update poly flags from areas.
         for (int i = 0; i < params->polyCount; ++i)
         {
@@ -167,118 +187,292 @@ struct LinearAllocator : public dtTileCacheAlloc
 class NavigationMeshBuilder
 {
 public:
-    NavigationMeshBuilder(const std::shared_ptr<DynamicNavigationMesh>& navmesh) :
-        navmesh_(navmesh)
+    NavigationMeshBuilder(const std::vector<std::shared_ptr<DynamicNavigationMesh>>& navmeshes, NavigationBuildProgress* progress, bool changedOnly) :
+        navmeshes_(navmeshes),
+        progress_(progress),
+        changedOnly_(changedOnly)
     {
     }
 
     bool Build(uint32_t numTilesX, uint32_t numTilesZ)
     {
-        const std::filesystem::path tempDir = "navmesh/temp/";
+        const uint32_t numTiles = numTilesX * numTilesZ;
+        const uint32_t numWorkers = std::max<uint32_t>(pool_.get_thread_count(), 1u);
+
+        // Tiles built ahead of the committer by tile index, every profile of a tile together
+        std::map<uint32_t, std::vector<BuiltTile>> builtTiles;
+        std::mutex builtMutex;
+        std::condition_variable builtCondition;
+
+        if (progress_) {
+            progress_->tilesDone_ = 0;
+            progress_->tilesTotal_ = numTiles;
+        }
+
+        // Collisions are transformed once for the whole build, every tile then copies its triangles out of the store
+        const DynamicNavigationMesh* first = navmeshes_.front().get();
+        float border = 0.0f;
+        for (const auto& navmesh : navmeshes_) {
+            border = std::max(border, navmesh->GetTileBuildBorder());
+        }
+
+        geometryStore_.Build(first->world_, first->interior_, first->boundingBox_, (float)first->tileSize_ * first->cellSize_, numTilesX, numTilesZ, border);
+
+        // Dense areas take far longer than empty ones, so the heaviest tiles of the window are started first and the cheap ones fill the gaps
+        std::vector<std::uint64_t> costs(numTiles);
+        for (uint32_t tileIdx = 0; tileIdx < numTiles; ++tileIdx) {
+            costs[tileIdx] = BUILD_TILE_BASE_COST + geometryStore_.GetNumTriangles(tileIdx % numTilesX, tileIdx / numTilesX);
+        }
+
+        scheduler_.Reset(costs, numWorkers * BUILD_WINDOW_TILES_PER_THREAD);
 
-        std::vector<std::pair<uint32_t, uint32_t>> blocks;
-        std::mutex blocksMutex;
+        std::vector<std::string> profileNames;
+        for (const auto& navmesh : navmeshes_) {
+            profileNames.push_back(navmesh->profileName_);
+        }
 
-	    // Create temp directory if not exists
-	    if (!std::filesystem::exists(tempDir)) {
-            spdlog::info("Temp directory was created.");
-		    std::filesystem::create_directories(tempDir);
-	    }
+        NavBuildReport report(std::move(profileNames));
 
         spdlog::info("[MULTITHREADED] Start navigation mesh build! Running {} threads.", pool_.get_thread_count());
 
-        pool_.parallelize_loop(0, numTilesX * numTilesZ,
-            [this, &numTilesX, &tempDir, &blocks, &blocksMutex](const uint32_t &a, const uint32_t &b)
-            {
-                std::filesystem::path path = tempDir / fmt::format("temp{}_{}.bin", a, b);
-                std::ofstream output(path, std::ios::out | std::ios::binary);
-                if (!output.is_open()) {
-                    spdlog::error("Cannot open a temp file");
-                    return;
-                }
+        auto buildTiles = [this, numTilesX, &builtTiles, &builtMutex, &builtCondition]() {
+            TileCacheData tiles[TILECACHE_MAXLAYERS];
+
+            // Geometry buffers of a worker are reused by all the tiles it builds
+            thread_local NavBuildData geometry;
 
-                OutputFileStream stream(output);
+            uint32_t tileIdx;
+            while (scheduler_.Next(tileIdx)) {
+                const int32_t x = tileIdx % numTilesX;
+                const int32_t z = tileIdx / numTilesX;
 
-                TileCacheData tiles[TILECACHE_MAXLAYERS];
+                // Tile of every profile, in profile order
+                std::vector<BuiltTile> built;
+                try {
+                    built.reserve(navmeshes_.size());
 
-                for (uint32_t tileIdx = a; tileIdx < b; tileIdx++) {
-                    const int32_t x = tileIdx % numTilesX;
-                    const int32_t z = tileIdx / numTilesX;
-                    
-                    const int layerCt = navmesh_->BuildTile(x, z, tiles);
-                    stream.WriteInt(layerCt);
-
-                    for (int layerIdx = 0; layerIdx < layerCt; ++layerIdx) {
-                        auto& tileData = tiles[layerIdx];
-                        stream.WriteInt(tileData.dataSize);
-                        stream.Write(tileData.data, tileData.dataSize);
-
-                        dtFree(tileData.data);
-                        tileData.data = {};
-                        tileData.dataSize = {};
-                    }           
+                    // Geometry is gathered once for all profiles, wide enough for the largest agent
+                    BoundingBox buildBounds = navmeshes_.front()->GetTileBuildBounds(x, z);
+                    for (const auto& navmesh : navmeshes_) {
+                        buildBounds.Merge(navmesh->GetTileBuildBounds(x, z));
+                    }
+
+                    geometry.Clear();
+                    geometryStore_.GetTileGeometry(&geometry, x, z);
+                    navmeshes_.front()->GetTileAreas(&geometry, buildBounds);
+
+                    for (const auto& navmesh : navmeshes_) {
+                        BuiltTile& tile = built.emplace_back();
+                        tile.x_ = x;
+                        tile.z_ = z;
+                        tile.hash_ = navmesh->GetTileInputHash(x, z, geometry);
+
+                        // Gathering the geometry is cheap next to Recast, unchanged tiles keep their layers
+                        if (changedOnly_ && navmesh->tileHashes_[tileIdx] == tile.hash_) {
+                            tile.unchanged_ = true;
+                            continue;
+                        }
+
+                        const int layerCt = navmesh->BuildTileCached(x, z, geometry, tile.hash_, tiles, &tile.profile_);
+                        if (layerCt < 0) {
+                            // An unknown input hash makes the next changed-only build try the tile again. Meanwhile a changed-only build keeps the
+                            // current layers of the tile, a full build commits it without layers.
+                            tile.hash_ = 0u;
+                            tile.unchanged_ = changedOnly_;
+                            continue;
+                        }
+
+                        // Layers left in the scratch array are the ones the handler below frees
+                        tile.layers_.assign(tiles, tiles + layerCt);
+                        std::fill_n(tiles, layerCt, TileCacheData{});
+                    }
                 }
+                catch (const std::exception& e) {
+                    // The committer waits for every tile in order, a tile that threw is posted as failed so that it does not wait forever
+                    spdlog::error("Could not build tile {}, {}: {}", x, z, e.what());
+                    ++numFailedTiles_;
+
+                    for (auto& tile : built) {
+                        for (auto& layer : tile.layers_) {
+                            dtFree(layer.data);
+                        }
+                    }
 
-                const std::lock_guard<std::mutex> lock(blocksMutex);
-                blocks.push_back(std::make_pair(a, b));
-            }
-        );
+                    // Layers of the profile that threw, made before anything took them over
+                    for (auto& layer : tiles) {
+                        dtFree(layer.data);
+                        layer = TileCacheData{};
+                    }
 
-        spdlog::info("Start loading temp files...");
+                    built.assign(navmeshes_.size(), BuiltTile{});
+                    for (auto& tile : built) {
+                        tile.x_ = x;
+                        tile.z_ = z;
+                        tile.unchanged_ = changedOnly_;
+                    }
+                }
 
-        std::sort(blocks.begin(), blocks.end(), [](const std::pair<uint32_t, uint32_t>& lhs, const std::pair<uint32_t, uint32_t>& rhs) {
-            return lhs.first < rhs.first;
-        });
+                {
+                    const std::lock_guard<std::mutex> lock(builtMutex);
+                    builtTiles.emplace(tileIdx, std::move(built));
+                }
 
-        for (const auto& [a, b] : blocks) {
-            std::filesystem::path path = tempDir / fmt::format("temp{}_{}.bin", a, b);
-            std::ifstream input(path, std::ios::in | std::ios::binary);
-            if (!input.is_open()) {
-                spdlog::error("Cannot open a temp file");
-                return false;
+                builtCondition.notify_one();
             }
+        };
 
-            spdlog::info("Loading blocks {} {}", a, b);
+        for (uint32_t worker = 0; worker < numWorkers; ++worker) {
+            pool_.push_task(buildTiles);
+        }
 
-            InputFileStream stream(input);
+        // Tiles are committed in tile order whatever order the workers finish them in, so every build stores the tiles alike. Each wait takes the tiles
+        // finished in a row after the last committed one.
+        std::vector<std::vector<BuiltTile>> committing;
+        for (uint32_t numCommitted = 0; numCommitted < numTiles; numCommitted += static_cast<uint32_t>(committing.size())) {
+            committing.clear();
+            {
+                std::unique_lock<std::mutex> lock(builtMutex);
+                builtCondition.wait(lock, [&builtTiles, numCommitted] { return builtTiles.contains(numCommitted); });
 
-            for (uint32_t tileIdx = a; tileIdx < b; tileIdx++) {
-                const int32_t x = tileIdx % numTilesX;
-                const int32_t z = tileIdx / numTilesX; 
+                while (!builtTiles.empty() && builtTiles.begin()->first == numCommitted + committing.size()) {
+                    committing.push_back(std::move(builtTiles.begin()->second));
+                    builtTiles.erase(builtTiles.begin());
+                }
+            }
 
-                navmesh_->tileCache_->removeTile(navmesh_->navMesh_->getTileRefAt(x, z, 0), nullptr, nullptr);
+            // The workers move on while the tiles are committed, the window bounds the tiles waiting for the committer
+            scheduler_.Advance(numCommitted + static_cast<uint32_t>(committing.size()));
 
-                const int layerCt = stream.ReadInt();
-                for (int layerIdx = 0; layerIdx < layerCt; ++layerIdx) {
-                    const int dataSize = stream.ReadInt();
+            for (auto& built : committing) {
+                for (std::size_t profileIdx = 0; profileIdx < built.size(); ++profileIdx) {
+                    DynamicNavigationMesh* navmesh = navmeshes_[profileIdx].get();
+                    BuiltTile& tile = built[profileIdx];
+                    if (tile.unchanged_) {
+                        if (!tile.hash_) {
+                            navmesh->tileHashes_[tile.z_ * numTilesX + tile.x_] = 0u;
+                        }
 
-                    void* data = dtAlloc(dataSize, DT_ALLOC_PERM);
-                    stream.Read(data, dataSize);
+                        continue;
+                    }
 
-                    dtCompressedTileRef tileRef;
-                    int status = navmesh_->tileCache_->addTile(static_cast<unsigned char*>(data), dataSize, DT_COMPRESSEDTILE_FREE_DATA, &tileRef);
-                    if (dtStatusFailed((dtStatus)status))
-                    {
-                        dtFree(data);
-                        data = nullptr;
+                    if (changedOnly_) {
+                        RemoveTile(navmesh, tile);
+                        ++numChangedTiles_;
                     }
+
+                    report.Add(profileIdx, tile.profile_);
+                    CommitTile(navmesh, tile);
+                    navmesh->tileHashes_[tile.z_ * numTilesX + tile.x_] = tile.hash_;
                 }
+            }
 
-                navmesh_->tileCache_->buildNavMeshTilesAt(x, z, navmesh_->navMesh_);
-            }            
+            if (progress_) {
+                progress_->tilesDone_ += static_cast<unsigned>(committing.size());
+            }
         }
 
-        // For a full build it's necessary to update the nav mesh
-        // not doing so will cause dependent components to crash, like CrowdManager
-        navmesh_->tileCache_->update(0, navmesh_->navMesh_);
+        pool_.wait_for_tasks();
+        geometryStore_.Clear();
+
+        report.LogSummary();
+        if (!first->buildReport_.empty()) {
+            report.Write(first->buildReport_);
+        }
+
+        if (changedOnly_) {
+            spdlog::info("Rebuilt {} changed tiles out of {}", numChangedTiles_, numTiles * navmeshes_.size());
+        }
+
+        if (numFailedTiles_) {
+            spdlog::error("{} tiles could not be built, the next changed-only build tries them again", numFailedTiles_.load());
+        }
+
+        for (const auto& navmesh : navmeshes_) {
+            // For a full build it's necessary to update the nav mesh
+            // not doing so will cause dependent components to crash, like CrowdManager
+            navmesh->tileCache_->update(0, navmesh->navMesh_);
+        }
 
         return true;
     }   
 
 private:
+    // Compressed layers of one tile of one profile.
+    struct BuiltTile
+    {
+        int32_t x_{};
+        int32_t z_{};
+        // Input hash the layers are built from.
+        std::uint64_t hash_{};
+        // Whether the tile keeps its layers, as its input did not change or it failed to build in a changed-only build.
+        bool unchanged_{};
+        std::vector<TileCacheData> layers_;
+        // Time spent building the layers.
+        NavBuildTileProfile profile_;
+    };
+
+    // Remove the layers and navigation mesh tiles of a tile being rebuilt.
+    static void RemoveTile(DynamicNavigationMesh* navmesh, const BuiltTile& tile)
+    {
+        dtCompressedTileRef existing[TILECACHE_MAXLAYERS];
+        const int existingCt = navmesh->tileCache_->getTilesAt(tile.x_, tile.z_, existing, TILECACHE_MAXLAYERS);
+        for (int i = 0; i < existingCt; ++i) {
+            unsigned char* data = nullptr;
+            if (!dtStatusFailed(navmesh->tileCache_->removeTile(existing[i], &data, nullptr)) && data != nullptr) {
+                dtFree(data);
+            }
+        }
+
+        const dtMeshTile* meshTiles[TILECACHE_MAXLAYERS];
+        const int meshTileCt = navmesh->navMesh_->getTilesAt(tile.x_, tile.z_, meshTiles, TILECACHE_MAXLAYERS);
+        for (int i = 0; i < meshTileCt; ++i) {
+            navmesh->navMesh_->removeTile(navmesh->navMesh_->getTileRef(meshTiles[i]), nullptr, nullptr);
+        }
+
+        // The tile may end up without layers, in which case it is never processed
+        navmesh->TileChanged(Int32Vector2(tile.x_, tile.z_));
+    }
+
+    // Hand the layers of the tile over to the tile cache and build the navigation mesh tile.
+    static void CommitTile(DynamicNavigationMesh* navmesh, BuiltTile& tile)
+    {
+        navmesh->tileCache_->removeTile(navmesh->navMesh_->getTileRefAt(tile.x_, tile.z_, 0), nullptr, nullptr);
+
+        for (auto& layer : tile.layers_) {
+            dtCompressedTileRef tileRef;
+            int status = navmesh->tileCache_->addTile(layer.data, layer.dataSize, DT_COMPRESSEDTILE_FREE_DATA, &tileRef);
+            if (dtStatusFailed((dtStatus)status))
+            {
+                dtFree(layer.data);
+            }
+
+            layer.data = nullptr;
+            layer.dataSize = 0;
+        }
+
+        navmesh->tileCache_->buildNavMeshTilesAt(tile.x_, tile.z_, navmesh->navMesh_);
+    }
+
     thread_pool pool_;
 
-    std::shared_ptr<DynamicNavigationMesh> navmesh_;
+    std::vector<std::shared_ptr<DynamicNavigationMesh>> navmeshes_;
+
+    // World-space triangles of the interior binned by tile.
+    TileGeometryStore geometryStore_;
+
+    // Order the tiles are handed to the workers in.
+    TileBuildScheduler scheduler_;
+
+    NavigationBuildProgress* progress_;
+
+    // Whether only the tiles whose input hash changed are built.
+    bool changedOnly_;
+
+    // Number of tiles rebuilt because their input changed.
+    std::size_t numChangedTiles_{};
+
+    // Number of tiles whose build threw, counted by the workers.
+    std::atomic<unsigned> numFailedTiles_{};
 };
 
 DynamicNavigationMesh::DynamicNavigationMesh(World* world) :
@@ -385,100 +579,83 @@ bool DynamicNavigationMesh::Allocate(const BoundingBox& boundingBox, unsigned ma
 
 bool DynamicNavigationMesh::Build()
 {
-    Scene* scene = world_->GetScene();
-    assert(scene);   
+    return BuildProfiles({ shared_from_this() });
+}
 
-    // Release existing navigation data and zero the bounding box
-    ReleaseNavigationMesh();
+bool DynamicNavigationMesh::BuildProfiles(const std::vector<std::shared_ptr<DynamicNavigationMesh>>& navmeshes, NavigationBuildProgress* progress)
+{
+    if (navmeshes.empty())
+        return false;
 
-    boundingBox_.Merge(scene->GetBounds());
+    for (const auto& navmesh : navmeshes)
+    {
+        if (!navmesh->BeginBuild())
+            return false;
+    }
 
-    // Expand bounding box by padding
-    boundingBox_.min_ -= padding_;
-    boundingBox_.max_ += padding_;
+    if (!ShareTileGrid(navmeshes))
+        return false;
+
+    const DynamicNavigationMesh* first = navmeshes.front().get();
+    NavigationMeshBuilder builder(navmeshes, progress, false);
+    if (!builder.Build(first->numTilesX_, first->numTilesZ_))
+        return false;
+
+    spdlog::debug("Built {} navigation mesh profiles", navmeshes.size());
+
+    for (const auto& navmesh : navmeshes)
+        navmesh->EndBuild();
+
+    return true;
+}
 
+bool DynamicNavigationMesh::ShareTileGrid(const std::vector<std::shared_ptr<DynamicNavigationMesh>>& navmeshes)
+{
+    // Tile geometry is shared, so every profile must cut the same interior into the same tiles
+    const DynamicNavigationMesh* first = navmeshes.front().get();
+    for (const auto& navmesh : navmeshes)
     {
-        // Calculate number of tiles
-        int gridW = 0, gridH = 0;
-        float tileEdgeLength = (float)tileSize_ * cellSize_;
-        rcCalcGridSize(&boundingBox_.min_.x_, &boundingBox_.max_.x_, cellSize_, &gridW, &gridH);
-        numTilesX_ = (gridW + tileSize_ - 1) / tileSize_;
-        numTilesZ_ = (gridH + tileSize_ - 1) / tileSize_;
-
-        // Calculate max. number of tiles and polygons, 22 bits available to identify both tile & polygon within tile
-        unsigned maxTiles = NextPowerOfTwo((unsigned)(numTilesX_ * numTilesZ_)) * maxLayers_;
-        unsigned tileBits = LogBaseTwo(maxTiles);
-        unsigned maxPolys = 1u << (22 - tileBits);
-
-        spdlog::info("Max Tiles {}; Max Polys {}", maxTiles, maxPolys);
-        spdlog::info("Tiles {} x {}", numTilesX_, numTilesZ_);
-
-        dtNavMeshParams params;     // NOLINT(hicpp-member-init)
-        rcVcopy(params.orig, &boundingBox_.min_.x_);
-        params.tileWidth = tileEdgeLength;
-        params.tileHeight = tileEdgeLength;
-        params.maxTiles = maxTiles;
-        params.maxPolys = maxPolys;
-
-        navMesh_ = dtAllocNavMesh();
-        if (!navMesh_)
+        if (navmesh->world_ != first->world_ || navmesh->interior_ != first->interior_ || navmesh->numTilesX_ != first->numTilesX_ || navmesh->numTilesZ_ != first->numTilesZ_ ||
+            navmesh->tileSize_ != first->tileSize_ || navmesh->cellSize_ != first->cellSize_ || !navmesh->boundingBox_.min_.Equals(first->boundingBox_.min_))
         {
-            spdlog::error("Could not allocate navigation mesh");
+            spdlog::error("Navigation mesh profile {} does not share the tile grid of profile {}", navmesh->profileName_, first->profileName_);
             return false;
         }
+    }
 
-        if (dtStatusFailed(navMesh_->init(&params)))
-        {
-            spdlog::error("Could not initialize navigation mesh");
-            ReleaseNavigationMesh();
-            return false;
-        }
+    return true;
+}
 
-        dtTileCacheParams tileCacheParams;      // NOLINT(hicpp-member-init)
-        memset(&tileCacheParams, 0, sizeof(tileCacheParams));
-        rcVcopy(tileCacheParams.orig, &boundingBox_.min_.x_);
-        tileCacheParams.ch = cellHeight_;
-        tileCacheParams.cs = cellSize_;
-        tileCacheParams.width = tileSize_;
-        tileCacheParams.height = tileSize_;
-        tileCacheParams.maxSimplificationError = edgeMaxError_;
-        tileCacheParams.maxTiles = maxTiles;
-        tileCacheParams.maxObstacles = maxObstacles_;
-        // Settings from NavigationMesh
-        tileCacheParams.walkableClimb = agentMaxClimb_;
-        tileCacheParams.walkableHeight = agentHeight_;
-        tileCacheParams.walkableRadius = agentRadius_;
-
-        tileCache_ = dtAllocTileCache();
-        if (!tileCache_)
-        {
-            spdlog::error("Could not allocate tile cache");
-            ReleaseNavigationMesh();
-            return false;
-        }
+bool DynamicNavigationMesh::BuildChanged()
+{
+    return BuildChangedProfiles({ shared_from_this() });
+}
+
+bool DynamicNavigationMesh::BuildChangedProfiles(const std::vector<std::shared_ptr<DynamicNavigationMesh>>& navmeshes, NavigationBuildProgress* progress)
+{
+    if (navmeshes.empty())
+        return false;
 
-        if (dtStatusFailed(tileCache_->init(&tileCacheParams, allocator_.get(), compressor_.get(), meshProcessor_.get())))
+    for (const auto& navmesh : navmeshes)
+    {
+        if (!navmesh->CanBuildChanged())
         {
-            spdlog::error("Could not initialize tile cache");
-            ReleaseNavigationMesh();
-            return false;
+            spdlog::info("Tiles of navigation mesh profile {} can not be rebuilt selectively, building all of them", navmesh->profileName_);
+            return BuildProfiles(navmeshes, progress);
         }
-    
- 
-        NavigationMeshBuilder builder(shared_from_this());
-        builder.Build(numTilesX_, numTilesZ_); 
+    }
 
-        spdlog::debug("Built navigation mesh");
+    if (!ShareTileGrid(navmeshes))
+        return false;
 
-        // Scan for obstacles to insert into us
-        for (const auto& obstacle : scene->GetObstacles()) {
-            if (obstacle->IsEnabled()) {
-                AddObstacle(obstacle.get());
-            }
-        }  
+    // The tiles are replaced in place
+    for (const auto& navmesh : navmeshes)
+        navmesh->WaitLandmarks();
 
-        return true;
-    }
+    // Obstacles stay in the tile cache and are applied to the rebuilt tiles again
+    const DynamicNavigationMesh* first = navmeshes.front().get();
+    NavigationMeshBuilder builder(navmeshes, progress, true);
+    return builder.Build(first->numTilesX_, first->numTilesZ_);
 }
 
 bool DynamicNavigationMesh::Build(const BoundingBox& boundingBox)
@@ -529,6 +706,8 @@ std::vector<unsigned char> DynamicNavigationMesh::GetTileData(const Int32Vector2
 
 bool DynamicNavigationMesh::AddTile(const std::vector<unsigned char>& tileData)
 {
+    WaitLandmarks();
+
     InputMemoryStream stream(tileData);
     return ReadTiles(stream, false);
 }
@@ -658,6 +837,26 @@ bool DynamicNavigationMesh::Serialize(OutputStream& stream) const
 {
     if (navMesh_ && tileCache_)
     {
+        // Old files start straight with the bounding box, the landmarks are an optional section in front of it
+        const std::shared_ptr<const LandmarkTable> landmarks = GetLandmarks();
+        if (landmarks)
+        {
+            stream.WriteFileID(LANDMARK_FILE_ID);
+            if (!landmarks->Write(stream)) {
+                spdlog::error("Could not write landmark table");
+                return false;
+            }
+        }
+
+        // Tile input hashes let a later build skip unchanged tiles
+        if (!tileHashes_.empty())
+        {
+            stream.WriteFileID(TILE_HASHES_FILE_ID);
+            stream.WriteUInt(static_cast<std::uint32_t>(tileHashes_.size()));
+            for (std::uint64_t hash : tileHashes_)
+                stream.WriteUInt64(hash);
+        }
+
         stream.WriteBoundingBox(boundingBox_);
         stream.WriteInt(numTilesX_);
         stream.WriteInt(numTilesZ_);
@@ -687,10 +886,50 @@ bool DynamicNavigationMesh::Deserialize(InputStream& stream)
 {
     ReleaseNavigationMesh();
 
+    // Tiles added below would drop the landmarks, they are attached once all tiles are in place
+    auto landmarks = std::make_shared<LandmarkTable>();
+    std::size_t start = stream.Tell();
+    if (stream.ReadFileID() == LANDMARK_FILE_ID)
+    {
+        if (!landmarks->Read(stream))
+            return false;
+    }
+    else
+        stream.Seek(start);
+
+    std::vector<std::uint64_t> tileHashes;
+    std::uint32_t numTileHashes = 0;
+    bool hasTileHashes = false;
+    start = stream.Tell();
+    if (stream.ReadFileID() == TILE_HASHES_FILE_ID)
+    {
+        // The count is checked against the tile grid below, a damaged one must not allocate memory up front
+        numTileHashes = stream.ReadUInt();
+        for (std::uint32_t i = 0; i < numTileHashes && !stream.Eof(); ++i)
+            tileHashes.push_back(stream.ReadUInt64());
+
+        hasTileHashes = true;
+    }
+    else
+        stream.Seek(start);
+
     boundingBox_ = stream.ReadBoundingBox();
     numTilesX_ = stream.ReadInt();
     numTilesZ_ = stream.ReadInt();
 
+    // Files saved without the hashes leave them unknown, so the first selective rebuild builds every tile
+    if (hasTileHashes)
+    {
+        if (numTilesX_ <= 0 || numTilesZ_ <= 0 || tileHashes.size() != numTileHashes ||
+            tileHashes.size() != static_cast<std::size_t>(numTilesX_) * static_cast<std::size_t>(numTilesZ_))
+        {
+            spdlog::error("Tile hashes do not match the tile grid");
+            return false;
+        }
+
+        tileHashes_ = std::move(tileHashes);
+    }
+
     dtNavMeshParams params;     // NOLINT(hicpp-member-init)
     stream.Read(&params, sizeof(dtNavMeshParams));
 
@@ -725,7 +964,16 @@ bool DynamicNavigationMesh::Deserialize(InputStream& stream)
         return false;
     }
 
-    return ReadTiles(stream, true); 
+    if (!ReadTiles(stream, true))
+        return false;
+
+    // A stored table is only used while landmarks are enabled
+    if (numLandmarks_ && landmarks->GetNumLandmarks() && landmarks->Attach(navMesh_))
+        SetLandmarks(std::move(landmarks));
+    else if (numLandmarks_ && landmarks->GetNumLandmarks())
+        spdlog::warn("Landmark table does not match the navigation mesh, it will be recomputed");
+
+    return true;
 }
 
 void DynamicNavigationMesh::AddObstacle(Obstacle* obstacle)
@@ -779,13 +1027,191 @@ void DynamicNavigationMesh::RemoveObstacle(Obstacle* obstacle)
     }
 }
 
+BoundingBox DynamicNavigationMesh::GetInteriorBuildBounds() const
+{
+    Scene* scene = world_->GetScene();
+    assert(scene);
+
+    // Only the nodes of the interior are built, the others may lie far away
+    BoundingBox bounds = scene->GetInteriorBounds(interior_);
+    if (bounds.min_.x_ > bounds.max_.x_)
+        return bounds;
+
+    // Expand bounding box by padding
+    bounds.min_ -= padding_;
+    bounds.max_ += padding_;
+    return bounds;
+}
+
+bool DynamicNavigationMesh::CanBuildChanged() const
+{
+    if (!navMesh_ || !tileCache_ || tileHashes_.size() != static_cast<std::size_t>(numTilesX_ * numTilesZ_))
+        return false;
+
+    const BoundingBox bounds = GetInteriorBuildBounds();
+    if (bounds.min_.x_ > bounds.max_.x_)
+        return false;
+
+    int gridW = 0, gridH = 0;
+    rcCalcGridSize(&bounds.min_.x_, &bounds.max_.x_, cellSize_, &gridW, &gridH);
+
+    // Tiles keep their place only if the grid origin stays, and the height range of the tiles must still cover the geometry
+    if (bounds.min_.x_ != boundingBox_.min_.x_ || bounds.min_.z_ != boundingBox_.min_.z_ || bounds.min_.y_ < boundingBox_.min_.y_ ||
+        bounds.max_.y_ > boundingBox_.max_.y_ || (gridW + tileSize_ - 1) / tileSize_ != numTilesX_ || (gridH + tileSize_ - 1) / tileSize_ != numTilesZ_)
+        return false;
+
+    // A loaded file keeps the parameters it was built with, rebuilt tiles would be made with the current settings and turned into polygons with the
+    // stored ones
+    dtNavMeshParams params;     // NOLINT(hicpp-member-init)
+    dtTileCacheParams tileCacheParams;      // NOLINT(hicpp-member-init)
+    GetBuildParams(params, tileCacheParams);
+
+    const dtNavMeshParams* navMeshParams = navMesh_->getParams();
+    if (!std::equal(navMeshParams->orig, navMeshParams->orig + 3, params.orig) || navMeshParams->tileWidth != params.tileWidth ||
+        navMeshParams->tileHeight != params.tileHeight || navMeshParams->maxTiles != params.maxTiles || navMeshParams->maxPolys != params.maxPolys)
+        return false;
+
+    const dtTileCacheParams* storedParams = tileCache_->getParams();
+    return std::equal(storedParams->orig, storedParams->orig + 3, tileCacheParams.orig) && storedParams->cs == tileCacheParams.cs &&
+        storedParams->ch == tileCacheParams.ch && storedParams->width == tileCacheParams.width && storedParams->height == tileCacheParams.height &&
+        storedParams->walkableHeight == tileCacheParams.walkableHeight && storedParams->walkableRadius == tileCacheParams.walkableRadius &&
+        storedParams->walkableClimb == tileCacheParams.walkableClimb && storedParams->maxSimplificationError == tileCacheParams.maxSimplificationError &&
+        storedParams->maxTiles == tileCacheParams.maxTiles && storedParams->maxObstacles == tileCacheParams.maxObstacles;
+}
+
+void DynamicNavigationMesh::GetBuildParams(dtNavMeshParams& params, dtTileCacheParams& tileCacheParams) const
+{
+    // Calculate max. number of tiles and polygons, 22 bits available to identify both tile & polygon within tile
+    const float tileEdgeLength = (float)tileSize_ * cellSize_;
+    const unsigned maxTiles = NextPowerOfTwo((unsigned)(numTilesX_ * numTilesZ_)) * maxLayers_;
+    const unsigned tileBits = LogBaseTwo(maxTiles);
+    const unsigned maxPolys = 1u << (22 - tileBits);
+
+    rcVcopy(params.orig, &boundingBox_.min_.x_);
+    params.tileWidth = tileEdgeLength;
+    params.tileHeight = tileEdgeLength;
+    params.maxTiles = maxTiles;
+    params.maxPolys = maxPolys;
+
+    memset(&tileCacheParams, 0, sizeof(tileCacheParams));
+    rcVcopy(tileCacheParams.orig, &boundingBox_.min_.x_);
+    tileCacheParams.ch = cellHeight_;
+    tileCacheParams.cs = cellSize_;
+    tileCacheParams.width = tileSize_;
+    tileCacheParams.height = tileSize_;
+    tileCacheParams.maxSimplificationError = edgeMaxError_;
+    tileCacheParams.maxTiles = maxTiles;
+    tileCacheParams.maxObstacles = maxObstacles_;
+    // Settings from NavigationMesh
+    tileCacheParams.walkableClimb = agentMaxClimb_;
+    tileCacheParams.walkableHeight = agentHeight_;
+    tileCacheParams.walkableRadius = agentRadius_;
+}
+
+bool DynamicNavigationMesh::BeginBuild()
+{
+    // Release existing navigation data and zero the bounding box
+    ReleaseNavigationMesh();
+
+    const BoundingBox interiorBounds = GetInteriorBuildBounds();
+    if (interiorBounds.min_.x_ > interiorBounds.max_.x_)
+    {
+        spdlog::error("Could not find scene nodes in interior {}", interior_);
+        return false;
+    }
+
+    boundingBox_.Merge(interiorBounds);
+
+    // Calculate number of tiles
+    int gridW = 0, gridH = 0;
+    rcCalcGridSize(&boundingBox_.min_.x_, &boundingBox_.max_.x_, cellSize_, &gridW, &gridH);
+    numTilesX_ = (gridW + tileSize_ - 1) / tileSize_;
+    numTilesZ_ = (gridH + tileSize_ - 1) / tileSize_;
+
+    dtNavMeshParams params;     // NOLINT(hicpp-member-init)
+    dtTileCacheParams tileCacheParams;      // NOLINT(hicpp-member-init)
+    GetBuildParams(params, tileCacheParams);
+
+    spdlog::info("Max Tiles {}; Max Polys {}", params.maxTiles, params.maxPolys);
+    spdlog::info("Tiles {} x {}", numTilesX_, numTilesZ_);
+
+    tileHashes_.assign(static_cast<std::size_t>(numTilesX_ * numTilesZ_), 0u);
+
+    navMesh_ = dtAllocNavMesh();
+    if (!navMesh_)
+    {
+        spdlog::error("Could not allocate navigation mesh");
+        return false;
+    }
+
+    if (dtStatusFailed(navMesh_->init(&params)))
+    {
+        spdlog::error("Could not initialize navigation mesh");
+        ReleaseNavigationMesh();
+        return false;
+    }
+
+    tileCache_ = dtAllocTileCache();
+    if (!tileCache_)
+    {
+        spdlog::error("Could not allocate tile cache");
+        ReleaseNavigationMesh();
+        return false;
+    }
+
+    if (dtStatusFailed(tileCache_->init(&tileCacheParams, allocator_.get(), compressor_.get(), meshProcessor_.get())))
+    {
+        spdlog::error("Could not initialize tile cache");
+        ReleaseNavigationMesh();
+        return false;
+    }
+
+    return true;
+}
+
+void DynamicNavigationMesh::EndBuild()
+{
+    Scene* scene = world_->GetScene();
+    assert(scene);
+
+    // Scan for obstacles to insert into us
+    for (const auto& obstacle : scene->GetObstacles()) {
+        if (obstacle->IsEnabled()) {
+            AddObstacle(obstacle.get());
+        }
+    }
+}
+
 int DynamicNavigationMesh::BuildTile(int x, int z, TileCacheData* tiles)
 {
-    const auto tileBoundingBox = GetTileBoundingBox(Int32Vector2(x, z));
+    NavBuildData geometry;
+    BoundingBox buildBounds = GetTileBuildBounds(x, z);
+    GetTileGeometry(&geometry, buildBounds);
 
-    DynamicNavBuildData build(allocator_.get());
+    return BuildTile(x, z, geometry, tiles);
+}
+
+float DynamicNavigationMesh::GetTileBuildBorder() const
+{
+    const int borderSize = (int)ceilf(agentRadius_ / cellSize_) + 3;
+    return (float)borderSize * cellSize_;
+}
+
+BoundingBox DynamicNavigationMesh::GetTileBuildBounds(int x, int z) const
+{
+    const float borderSize = GetTileBuildBorder();
+    const Vector3F border(borderSize, 0.0f, borderSize);
+
+    BoundingBox bounds = GetTileBoundingBox(Int32Vector2(x, z));
+    bounds.min_ -= border;
+    bounds.max_ += border;
+    return bounds;
+}
+
+void DynamicNavigationMesh::GetTileConfig(int x, int z, rcConfig& cfg) const
+{
+    const auto tileBoundingBox = GetTileBoundingBox(Int32Vector2(x, z));
 
-    rcConfig cfg;   // NOLINT(hicpp-member-init)
     memset(&cfg, 0, sizeof cfg);
     cfg.cs = cellSize_;
     cfg.ch = cellHeight_;
@@ -811,35 +1237,118 @@ int DynamicNavigationMesh::BuildTile(int x, int z, TileCacheData* tiles)
     cfg.bmin[2] -= cfg.borderSize * cfg.cs;
     cfg.bmax[0] += cfg.borderSize * cfg.cs;
     cfg.bmax[2] += cfg.borderSize * cfg.cs;
+}
 
-    BoundingBox expandedBox(*reinterpret_cast<Vector3F*>(cfg.bmin), *reinterpret_cast<Vector3F*>(cfg.bmax));
-    GetTileGeometry(&build, expandedBox);
+std::uint64_t DynamicNavigationMesh::GetTileInputHash(int x, int z, const NavBuildData& geometry) const
+{
+    rcConfig cfg;   // NOLINT(hicpp-member-init)
+    GetTileConfig(x, z, cfg);
+
+    // Layers built by another version of the code or Detour are not reused
+    std::uint64_t hash = HASH_SEED;
+    HashValue(hash, TILE_BUILD_VERSION);
+    HashValue(hash, DT_TILECACHE_VERSION);
+    HashValue(hash, DT_NAVMESH_VERSION);
+    HashValue(hash, cfg);
+    HashValue(hash, partitionType_);
+    // The layers store the tile coordinates in their headers, equal input of another tile must not find them
+    HashValue(hash, x);
+    HashValue(hash, z);
+    HashVector(hash, geometry.vertices_);
+    HashVector(hash, geometry.indices_);
+
+    for (const NavAreaStub& area : geometry.navAreas_)
+    {
+        HashValue(hash, area.bounds_.min_);
+        HashValue(hash, area.bounds_.max_);
+        HashValue(hash, area.areaID_);
+    }
+
+    // Zero marks tiles of unknown input
+    return hash ? hash : 1u;
+}
+
+int DynamicNavigationMesh::BuildTileCached(int x, int z, const NavBuildData& geometry, std::uint64_t hash, TileCacheData* tiles, NavBuildTileProfile* profile)
+{
+    // Tiles without geometry are built at once, an entry would only cost a file
+    if (!buildCache_ || geometry.vertices_.empty() || geometry.indices_.empty())
+        return BuildTile(x, z, geometry, tiles, profile);
+
+    const int cachedCt = buildCache_->Read(hash, tiles, static_cast<int>(TILECACHE_MAXLAYERS));
+    if (cachedCt >= 0)
+    {
+        if (profile)
+        {
+            profile->x_ = x;
+            profile->z_ = z;
+            profile->numTriangles_ = static_cast<unsigned>(geometry.indices_.size() / 3);
+            profile->numLayers_ = static_cast<unsigned>(cachedCt);
+            profile->cached_ = true;
+        }
+
+        return cachedCt;
+    }
+
+    // Failed builds are not stored, the next build tries again
+    const int layerCt = BuildTile(x, z, geometry, tiles, profile);
+    if (layerCt >= 0)
+        buildCache_->Write(hash, tiles, layerCt);
+
+    return layerCt;
+}
+
+int DynamicNavigationMesh::BuildTile(int x, int z, const NavBuildData& geometry, TileCacheData* tiles, NavBuildTileProfile* profile)
+{
+    // Every thread keeps its Recast memory from tile to tile, the build data below is released into it before the scope resets it
+    thread_local NavBuildArena arena;
+    NavBuildArenaScope arenaScope(arena);
+
+    DynamicNavBuildData build(allocator_.get());
 
-    if (build.vertices_.empty() || build.indices_.empty())
+    rcConfig cfg;   // NOLINT(hicpp-member-init)
+    GetTileConfig(x, z, cfg);
+
+    if (profile)
+    {
+        profile->x_ = x;
+        profile->z_ = z;
+        profile->numTriangles_ = static_cast<unsigned>(geometry.indices_.size() / 3);
+    }
+
+    if (geometry.vertices_.empty() || geometry.indices_.empty())
         return 0; // Nothing to do
 
+    // Recast times its own stages, total and compression are timed here
+    build.ctx_->startTimer(RC_TIMER_TOTAL);
+
     build.heightField_ = rcAllocHeightfield();
     if (!build.heightField_)
     {
         spdlog::error("Could not allocate heightfield");
-        return 0;
+        return -1;
     }
 
     if (!rcCreateHeightfield(build.ctx_, *build.heightField_, cfg.width, cfg.height, cfg.bmin, cfg.bmax, cfg.cs,
         cfg.ch))
     {
         spdlog::error("Could not create heightfield");
-        return 0;
+        return -1;
     }
 
-    const std::int32_t numTriangles = static_cast<std::int32_t>(build.indices_.size()) / 3;
-    std::unique_ptr<unsigned char[]> triAreas(new unsigned char[numTriangles]);
-    memset(triAreas.get(), 0, numTriangles);
+    const std::int32_t numTriangles = static_cast<std::int32_t>(geometry.indices_.size()) / 3;
+    auto* triAreas = static_cast<unsigned char*>(arena.Allocate(numTriangles));
+    if (!triAreas)
+    {
+        spdlog::error("Could not allocate triangle areas");
+        return -1;
+    }
 
-    rcMarkWalkableTriangles(build.ctx_, cfg.walkableSlopeAngle, &build.vertices_[0].x_, static_cast<std::int32_t>(build.vertices_.size()),
-        &build.indices_[0], numTriangles, triAreas.get());
-    rcRasterizeTriangles(build.ctx_, &build.vertices_[0].x_, static_cast<std::int32_t>(build.vertices_.size()), &build.indices_[0],
-        triAreas.get(), numTriangles, *build.heightField_, cfg.walkableClimb);
+    memset(triAreas, 0, numTriangles);
+
+    rcMarkWalkableTriangles(build.ctx_, cfg.walkableSlopeAngle, &geometry.vertices_[0].x_, static_cast<std::int32_t>(geometry.vertices_.size()),
+        &geometry.indices_[0], numTriangles, triAreas);
+    rcRasterizeTriangles(build.ctx_, &geometry.vertices_[0].x_, static_cast<std::int32_t>(geometry.vertices_.size()), &geometry.indices_[0],
+        triAreas, numTriangles, *build.heightField_, cfg.walkableClimb);
     rcFilterLowHangingWalkableObstacles(build.ctx_, cfg.walkableClimb, *build.heightField_);
 
     rcFilterLedgeSpans(build.ctx_, cfg.walkableHeight, cfg.walkableClimb, *build.heightField_);
@@ -849,37 +1358,37 @@ int DynamicNavigationMesh::BuildTile(int x, int z, TileCacheData* tiles)
     if (!build.compactHeightField_)
     {
         spdlog::error("Could not allocate create compact heightfield");
-        return 0;
+        return -1;
     }
     if (!rcBuildCompactHeightfield(build.ctx_, cfg.walkableHeight, cfg.walkableClimb, *build.heightField_,
         *build.compactHeightField_))
     {
         spdlog::error("Could not build compact heightfield");
-        return 0;
+        return -1;
     }
     if (!rcErodeWalkableArea(build.ctx_, cfg.walkableRadius, *build.compactHeightField_))
     {
         spdlog::error("Could not erode compact heightfield");
-        return 0;
+        return -1;
     }
 
     // area volumes
-    for (unsigned i = 0; i < build.navAreas_.size(); ++i)
-        rcMarkBoxArea(build.ctx_, &build.navAreas_[i].bounds_.min_.x_, &build.navAreas_[i].bounds_.max_.x_,
-            build.navAreas_[i].areaID_, *build.compactHeightField_);
+    for (unsigned i = 0; i < geometry.navAreas_.size(); ++i)
+        rcMarkBoxArea(build.ctx_, &geometry.navAreas_[i].bounds_.min_.x_, &geometry.navAreas_[i].bounds_.max_.x_,
+            geometry.navAreas_[i].areaID_, *build.compactHeightField_);
 
     if (this->partitionType_ == NAVMESH_PARTITION_WATERSHED)
     {
         if (!rcBuildDistanceField(build.ctx_, *build.compactHeightField_))
         {
             spdlog::error("Could not build distance field");
-            return 0;
+            return -1;
         }
         if (!rcBuildRegions(build.ctx_, *build.compactHeightField_, cfg.borderSize, cfg.minRegionArea,
             cfg.mergeRegionArea))
         {
             spdlog::error("Could not build regions");
-            return 0;
+            return -1;
         }
     }
     else
@@ -887,7 +1396,7 @@ int DynamicNavigationMesh::BuildTile(int x, int z, TileCacheData* tiles)
         if (!rcBuildRegionsMonotone(build.ctx_, *build.compactHeightField_, cfg.borderSize, cfg.minRegionArea, cfg.mergeRegionArea))
         {
             spdlog::error("Could not build monotone regions");
-            return 0;
+            return -1;
         }
     }
 
@@ -895,16 +1404,18 @@ int DynamicNavigationMesh::BuildTile(int x, int z, TileCacheData* tiles)
     if (!build.heightFieldLayers_)
     {
         spdlog::error("Could not allocate height field layer set");
-        return 0;
+        return -1;
     }
 
     if (!rcBuildHeightfieldLayers(build.ctx_, *build.compactHeightField_, cfg.borderSize, cfg.walkableHeight,
         *build.heightFieldLayers_))
     {
         spdlog::error("Could not build height field layers. See {}:{}", x, z);
-        return 0;
+        return -1;
     }
 
+    build.ctx_->startTimer(RC_TIMER_TEMP);
+
     int retCt = 0;
     for (int i = 0; i < build.heightFieldLayers_->nlayers; ++i)
     {
@@ -934,17 +1445,34 @@ int DynamicNavigationMesh::BuildTile(int x, int z, TileCacheData* tiles)
                 &(tiles[retCt].data), &tiles[retCt].dataSize)))
         {
             spdlog::error("Failed to build tile cache layers");
-            return 0;
+            for (int j = 0; j < retCt; ++j)
+            {
+                dtFree(tiles[j].data);
+                tiles[j].data = nullptr;
+            }
+
+            return -1;
         }
         else
             ++retCt;
     }    
 
+    build.ctx_->stopTimer(RC_TIMER_TEMP);
+    build.ctx_->stopTimer(RC_TIMER_TOTAL);
+
+    if (profile)
+    {
+        build.ctx_->GetStageTimes(*profile);
+        profile->numLayers_ = static_cast<unsigned>(retCt);
+    }
+
     return retCt;
 }
 
 unsigned DynamicNavigationMesh::BuildTiles(const Int32Vector2& from, const Int32Vector2& to)
 {
+    WaitLandmarks();
+
     unsigned numTiles = 0;
 
     for (int z = from.y_; z <= to.y_; ++z)
@@ -961,6 +1489,12 @@ unsigned DynamicNavigationMesh::BuildTiles(const Int32Vector2& from, const Int32
             }
 
             tileCache_->removeTile(navMesh_->getTileRefAt(x, z, 0), nullptr, nullptr);
+            // The tile may end up without layers, in which case it is never processed
+            TileChanged(Int32Vector2(x, z));
+
+            // Geometry gathered for this profile alone differs from the one of a full build, the next selective rebuild builds the tile again
+            if (!tileHashes_.empty())
+                tileHashes_[z * numTilesX_ + x] = 0u;
 
             TileCacheData tiles[TILECACHE_MAXLAYERS];
             int layerCt = BuildTile(x, z, tiles);
@@ -1005,6 +1539,7 @@ void DynamicNavigationMesh::ReleaseNavigationMesh()
 {
     NavigationMesh::ReleaseNavigationMesh();
     ReleaseTileCache();
+    tileHashes_.clear();
 }
 
 bool DynamicNavigationMesh::WriteTiles(OutputStream& dest, int x, int z, dtCompressedTileRef* tiles) const
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <atomic>
 #include <memory>
 #include <vector>
 #include <filesystem>
@@ -14,12 +15,16 @@ struct dtTileCacheCompressor;
 struct dtTileCacheLayer;
 struct dtTileCacheContourSet;
 struct dtTileCachePolyMesh;
+struct dtNavMeshParams;
+struct rcConfig;
 
 namespace WorldAssistant
 {
 
 class OffMeshConnection;
 class Obstacle;
+class TileBuildCache;
+struct NavBuildTileProfile;
 
 class DebugMesh;
 
@@ -29,6 +34,15 @@ struct TileCacheData
     int dataSize{};
 };
 
+// Progress of a full build, updated by the building thread and readable from the others.
+struct NavigationBuildProgress
+{
+    // Number of tiles built, counted once for all profiles.
+    std::atomic<unsigned> tilesDone_{};
+    // Number of tiles to build, zero until the tile grid is allocated.
+    std::atomic<unsigned> tilesTotal_{};
+};
+
 class DynamicNavigationMesh : public NavigationMesh, public std::enable_shared_from_this<DynamicNavigationMesh>
 {
     friend class Obstacle;
@@ -45,6 +59,14 @@ public:
     bool Allocate(const BoundingBox& boundingBox, unsigned maxTiles) override;
     // Build/rebuild the entire navigation mesh.
     bool Build() override;
+    // Build the navigation meshes of several profiles over the same world in one pass. Tile geometry is gathered once and shared by all profiles, so
+    // they must share the interior and the tile grid. Built tiles are counted in the progress if given. Return true if successful.
+    static bool BuildProfiles(const std::vector<std::shared_ptr<DynamicNavigationMesh>>& navmeshes, NavigationBuildProgress* progress = nullptr);
+    // Rebuild only the tiles whose input geometry or build settings changed since they were built by BuildProfiles. Falls back to a full build if the tile
+    // grid changed or the input of the tiles is unknown, e.g. for navigation meshes saved without it. Return true if successful.
+    static bool BuildChangedProfiles(const std::vector<std::shared_ptr<DynamicNavigationMesh>>& navmeshes, NavigationBuildProgress* progress = nullptr);
+    // Rebuild the tiles whose input changed. Return true if successful.
+    bool BuildChanged();
     // Build/rebuild a portion of the navigation mesh.
     bool Build(const BoundingBox& boundingBox) override;
     // Rebuild part of the navigation mesh in the rectangular area. Return true if successful.
@@ -60,6 +82,15 @@ public:
     // Return actual number of tiles.
     std::size_t GetEffectiveTilesCount() const;
 
+    // Set cache of built tile layers consulted by full and selective builds, null disables it.
+    void SetBuildCache(std::shared_ptr<TileBuildCache> buildCache) { buildCache_ = std::move(buildCache); }
+    // Return cache of built tile layers.
+    const std::shared_ptr<TileBuildCache>& GetBuildCache() const { return buildCache_; }
+    // Set CSV file the time spent on every tile is written to at the end of a full or selective build, an empty path writes none.
+    void SetBuildReport(const std::filesystem::path& buildReport) { buildReport_ = buildReport; }
+    // Return CSV file of the build report.
+    const std::filesystem::path& GetBuildReport() const { return buildReport_; }
+
     bool Dump(DebugMesh& mesh, bool triangulated = false, const BoundingBox* bounds = {});
 
     bool Serialize(OutputStream& stream) const;
@@ -74,8 +105,33 @@ protected:
     // Used by Obstacle class to remove itself from the tile cache
     void RemoveObstacle(Obstacle* obstacle);
 
-    // Build one tile of the navigation mesh. Return true if successful.
+    // Release the navigation data and allocate an empty navigation mesh and tile cache over the bounds of the interior. Return true if successful.
+    bool BeginBuild();
+    // Return bounding box of the interior padded the way BeginBuild does, empty if the interior has no scene nodes.
+    BoundingBox GetInteriorBuildBounds() const;
+    // Return whether the tiles can be rebuilt selectively: their input is known, the interior still fits the tile grid and the navigation mesh and tile
+    // cache were allocated with the current settings.
+    bool CanBuildChanged() const;
+    // Return parameters BeginBuild allocates the navigation mesh and tile cache with for the current tile grid and settings.
+    void GetBuildParams(dtNavMeshParams& params, dtTileCacheParams& tileCacheParams) const;
+    // Insert the scene obstacles once the tiles are built.
+    void EndBuild();
+    // Return width of the border around a tile its build reads geometry from.
+    float GetTileBuildBorder() const;
+    // Return bounding box of the tile padded by the border its build reads geometry from.
+    BoundingBox GetTileBuildBounds(int x, int z) const;
+    // Fill the Recast configuration of the tile.
+    void GetTileConfig(int x, int z, rcConfig& cfg) const;
+    // Return hash of everything the tile is built from: the gathered geometry and area volumes and the build settings. Never zero.
+    std::uint64_t GetTileInputHash(int x, int z, const NavBuildData& geometry) const;
+    // Build one tile of the navigation mesh. Return number of layers, or -1 if the build failed.
     int BuildTile(int x, int z, TileCacheData* tiles);
+    // Build one tile of the navigation mesh from geometry gathered ahead of time, timing the stages into the profile if given. Return number of layers,
+    // or -1 if the build failed.
+    int BuildTile(int x, int z, const NavBuildData& geometry, TileCacheData* tiles, NavBuildTileProfile* profile = nullptr);
+    // Build one tile from geometry with the given input hash, reading its layers from the build cache or storing successful builds there.
+    // Return number of layers, or -1 if the build failed.
+    int BuildTileCached(int x, int z, const NavBuildData& geometry, std::uint64_t hash, TileCacheData* tiles, NavBuildTileProfile* profile = nullptr);
     // Build tiles in the rectangular area. Return number of built tiles.
     unsigned BuildTiles(const Int32Vector2& from, const Int32Vector2& to);
 
@@ -85,6 +141,8 @@ protected:
     void ReleaseNavigationMesh() override;
 
 private:
+    // Return whether the profiles share the interior and the tile grid, logging the first one that does not.
+    static bool ShareTileGrid(const std::vector<std::shared_ptr<DynamicNavigationMesh>>& navmeshes);
      // Write tiles data.
     bool WriteTiles(OutputStream& dest, int x, int z, dtCompressedTileRef* tiles) const;
     // Read tiles data to the navigation mesh.
@@ -107,6 +165,12 @@ private:
     unsigned maxLayers_{};
     // Queue of tiles to be built.
     std::vector<Int32Vector2> tileQueue_;
+    // Input hash of every tile by tile index, zero if unknown.
+    std::vector<std::uint64_t> tileHashes_;
+    // Built tile layers by input hash, shared with other navigation meshes.
+    std::shared_ptr<TileBuildCache> buildCache_;
+    // CSV file of the build report, empty if none is written.
+    std::filesystem::path buildReport_;
 
     bool multithreading_{ true };
 };
@@ -0,0 +1,152 @@
+#include "../navigation/FlowField.h"
+#include "../navigation/NavigationUtils.h"
+
+#include <DetourNavMesh.h>
+#include <DetourNavMeshQuery.h>
+
+#include <queue>
+
+namespace WorldAssistant
+{
+
+/*
+    FlowField
+*/
+bool FlowField::Build(const dtNavMesh* navMesh, const dtQueryFilter* filter, dtPolyRef goalRef, const Vector3F& goal, float maxDistance, unsigned maxNodes)
+{
+    nodes_.clear();
+    goalRef_ = goalRef;
+
+    if (!navMesh || !navMesh->isValidPolyRef(goalRef))
+        return false;
+
+    using OpenEntry = std::pair<float, dtPolyRef>;
+    std::priority_queue<OpenEntry, std::vector<OpenEntry>, std::greater<OpenEntry>> open;
+
+    nodes_[goalRef] = FlowFieldNode{ 0, goal, 0.0f };
+    open.emplace(0.0f, goalRef);
+
+    unsigned numSettled = 0;
+    while (!open.empty() && numSettled < maxNodes)
+    {
+        const auto [distance, ref] = open.top();
+        open.pop();
+
+        // Skip entries superseded by a shorter distance
+        if (distance > nodes_[ref].distance_)
+            continue;
+
+        ++numSettled;
+
+        const dtMeshTile* tile = nullptr;
+        const dtPoly* poly = nullptr;
+        navMesh->getTileAndPolyByRefUnsafe(ref, &tile, &poly);
+
+        const Vector3F anchor = ref == goalRef ? goal : GetPolyCenter(tile, poly);
+        const float anchorCost = filter ? filter->getAreaCost(poly->getArea()) : 1.0f;
+
+        for (unsigned k = poly->firstLink; k != DT_NULL_LINK; k = tile->links[k].next)
+        {
+            const dtLink& link = tile->links[k];
+            if (!link.ref)
+                continue;
+
+            const dtMeshTile* neighbourTile = nullptr;
+            const dtPoly* neighbourPoly = nullptr;
+            navMesh->getTileAndPolyByRefUnsafe(link.ref, &neighbourTile, &neighbourPoly);
+            if (filter && !filter->passFilter(link.ref, neighbourTile, neighbourPoly))
+                continue;
+
+            // The search runs backwards, the neighbour must be able to step into this polygon
+            bool linkedBack = false;
+            for (unsigned j = neighbourPoly->firstLink; j != DT_NULL_LINK && !linkedBack; j = neighbourTile->links[j].next)
+                linkedBack = neighbourTile->links[j].ref == ref;
+
+            if (!linkedBack)
+                continue;
+
+            const Vector3F portal = GetPortalPoint(tile, poly, link, neighbourTile, neighbourPoly, anchor);
+            const Vector3F center = GetPolyCenter(neighbourTile, neighbourPoly);
+            const float areaCost = filter ? filter->getAreaCost(neighbourPoly->getArea()) : 1.0f;
+            const float newDistance = distance + (portal - center).Length() * areaCost + (anchor - portal).Length() * anchorCost;
+            if (newDistance > maxDistance)
+                continue;
+
+            auto [found, inserted] = nodes_.try_emplace(link.ref, FlowFieldNode{ ref, portal, newDistance });
+            if (!inserted)
+            {
+                if (found->second.distance_ <= newDistance)
+                    continue;
+
+                found->second = FlowFieldNode{ ref, portal, newDistance };
+            }
+
+            open.emplace(newDistance, link.ref);
+        }
+    }
+
+    return true;
+}
+
+const FlowFieldNode* FlowField::Find(dtPolyRef ref) const
+{
+    auto it = nodes_.find(ref);
+    return it != nodes_.end() ? &it->second : nullptr;
+}
+
+/*
+    FlowFieldCache
+*/
+FlowFieldCache::FlowFieldCache(std::size_t capacity, std::chrono::milliseconds expiry) :
+    capacity_(capacity),
+    expiry_(expiry)
+{
+}
+
+std::shared_ptr<const FlowField> FlowFieldCache::Find(dtPolyRef goalRef, const dtQueryFilter* filter)
+{
+    const std::lock_guard<std::mutex> lock(mutex_);
+
+    const auto now = std::chrono::steady_clock::now();
+    std::erase_if(entries_, [this, now](const Entry& entry) { return now - entry.created_ > expiry_; });
+
+    for (const auto& entry : entries_)
+    {
+        if (entry.goalRef_ == goalRef && entry.filter_ == filter)
+            return entry.field_;
+    }
+
+    return {};
+}
+
+void FlowFieldCache::Insert(const dtQueryFilter* filter, std::shared_ptr<const FlowField> field)
+{
+    const std::lock_guard<std::mutex> lock(mutex_);
+
+    const dtPolyRef goalRef = field->GetGoalRef();
+    std::erase_if(entries_, [goalRef, filter](const Entry& entry) { return entry.goalRef_ == goalRef && entry.filter_ == filter; });
+
+    entries_.push_front(Entry{ goalRef, filter, std::chrono::steady_clock::now(), std::move(field) });
+    while (entries_.size() > capacity_)
+        entries_.pop_back();
+}
+
+void FlowFieldCache::Clear()
+{
+    const std::lock_guard<std::mutex> lock(mutex_);
+    entries_.clear();
+}
+
+void FlowFieldCache::SetExpiry(std::chrono::milliseconds expiry)
+{
+    const std::lock_guard<std::mutex> lock(mutex_);
+    expiry_ = expiry;
+}
+
+std::chrono::milliseconds FlowFieldCache::GetExpiry() const
+{
+    const std::lock_guard<std::mutex> lock(mutex_);
+    return expiry_;
+}
+
+}
\ No newline at end of file
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <chrono>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+#include "../navigation/NavigationQuery.h"
+#include "../utils/MathUtils.h"
+
+class dtNavMesh;
+class dtQueryFilter;
+
+namespace WorldAssistant
+{
+
+// Step toward the goal of a flow field.
+struct FlowFieldNode
+{
+    // Next polygon toward the goal.
+    dtPolyRef next_{};
+    // Point on the border with the next polygon.
+    Vector3F waypoint_;
+    // Travel cost from the polygon center to the goal.
+    float distance_{};
+};
+
+// Next steps of every polygon around a goal, found by a single reverse Dijkstra search from the goal.
+class FlowField
+{
+public:
+    // Build the field over polygons within maxDistance of the goal, settling at most maxNodes polygons. Return false if the goal is invalid.
+    bool Build(const dtNavMesh* navMesh, const dtQueryFilter* filter, dtPolyRef goalRef, const Vector3F& goal, float maxDistance, unsigned maxNodes);
+
+    // Return the step from the polygon, null if the polygon is out of the field.
+    const FlowFieldNode* Find(dtPolyRef ref) const;
+
+    // Return goal polygon.
+    dtPolyRef GetGoalRef() const { return goalRef_; }
+    // Return number of polygons in the field.
+    std::size_t GetNumPolys() const { return nodes_.size(); }
+
+private:
+    // Steps by polygon.
+    std::unordered_map<dtPolyRef, FlowFieldNode> nodes_;
+    // Goal polygon.
+    dtPolyRef goalRef_{};
+};
+
+// Recently built flow fields by goal polygon. Fields expire after a while so moving goals are picked up.
+class FlowFieldCache
+{
+public:
+    // Construct with the maximum number of fields and their lifetime.
+    explicit FlowFieldCache(std::size_t capacity = 32, std::chrono::milliseconds expiry = std::chrono::milliseconds(1000));
+
+    // Return a live field of the goal polygon and filter, null if there is none.
+    std::shared_ptr<const FlowField> Find(dtPolyRef goalRef, const dtQueryFilter* filter);
+    // Store a field.
+    void Insert(const dtQueryFilter* filter, std::shared_ptr<const FlowField> field);
+    // Remove all fields.
+    void Clear();
+
+    // Set the lifetime of fields.
+    void SetExpiry(std::chrono::milliseconds expiry);
+    // Return the lifetime of fields.
+    std::chrono::milliseconds GetExpiry() const;
+
+private:
+    struct Entry
+    {
+        // Goal polygon.
+        dtPolyRef goalRef_{};
+        // Query filter the field was built with.
+        const dtQueryFilter* filter_{};
+        // Build time.
+        std::chrono::steady_clock::time_point created_;
+        // Field.
+        std::shared_ptr<const FlowField> field_;
+    };
+
+    // Maximum number of fields.
+    std::size_t capacity_;
+    // Lifetime of fields.
+    std::chrono::milliseconds expiry_;
+    // Fields, newest first.
+    std::list<Entry> entries_;
+    // Guards everything above.
+    mutable std::mutex mutex_;
+};
+
+}
\ No newline at end of file
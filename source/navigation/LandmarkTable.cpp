@@ -0,0 +1,708 @@
+#include "../navigation/LandmarkTable.h"
+#include "../navigation/NavigationUtils.h"
+#include "../utils/UtilsStream.h"
+
+#include <DetourCommon.h>
+#include <DetourNavMesh.h>
+#include <DetourNavMeshQuery.h>
+#include <DetourNode.h>
+
+#include <cmath>
+#include <numeric>
+#include <queue>
+
+#include <spdlog/spdlog.h>
+#include "thread_pool/thread_pool.hpp"
+
+namespace WorldAssistant
+{
+
+// Version of the serialized table.
+static const unsigned LANDMARK_VERSION = 1;
+// Distance of polygons the landmark cannot reach.
+static const std::uint16_t LANDMARK_UNREACHABLE = 0xffff;
+// Largest stored distance, longer ones saturate. Saturated distances only weaken the bound.
+static const std::uint16_t LANDMARK_MAX_DISTANCE = 0xfffe;
+// Largest number of landmarks of a table, far more than the search gains from.
+static const unsigned LANDMARK_MAX_COUNT = 256u;
+// Largest number of polygons of a tile. Detour tiles index their vertices with 16 bits and never come close.
+static const unsigned LANDMARK_MAX_TILE_POLYS = 0xffffu;
+// Heuristic scale keeping the search close to the one of dtNavMeshQuery::findPath.
+static const float HEURISTIC_SCALE = 0.999f;
+// Relative and absolute length a verified path may exceed the Detour one by before it counts as longer. Both searches keep the first portal point a
+// polygon is reached by, so they may settle on slightly different corridors.
+static const float VERIFY_RELATIVE_TOLERANCE = 0.01f;
+static const float VERIFY_ABSOLUTE_TOLERANCE = 0.1f;
+
+/*
+    LandmarkTable
+*/
+bool LandmarkTable::Build(const dtNavMesh* navMesh, unsigned numLandmarks, thread_pool* workers)
+{
+    Clear();
+
+    if (!navMesh || !numLandmarks)
+        return false;
+
+    // Read rejects larger tables
+    numLandmarks = std::min(numLandmarks, LANDMARK_MAX_COUNT);
+
+    // Polygons are numbered across the tiles in tile index order
+    const int maxTiles = navMesh->getMaxTiles();
+    std::vector<unsigned> tileOffsets(maxTiles);
+    unsigned numPolys = 0;
+    for (int i = 0; i < maxTiles; ++i)
+    {
+        const dtMeshTile* tile = navMesh->getTile(i);
+        tileOffsets[i] = numPolys;
+        if (tile->header)
+            numPolys += static_cast<unsigned>(tile->header->polyCount);
+    }
+
+    if (!numPolys)
+        return false;
+
+    // The search walks between portal points: a polygon is entered at the portal point of the link it is reached by and left at the portal point of the
+    // link to the next one. Distances are measured over the same points, every link being a vertex and every pair of a link into a polygon and a link
+    // out of it an edge, so the bound never exceeds what the search charges
+    std::vector<Vector3F> centers(numPolys);
+    for (int i = 0; i < maxTiles; ++i)
+    {
+        const dtMeshTile* tile = navMesh->getTile(i);
+        if (!tile->header)
+            continue;
+
+        for (int j = 0; j < tile->header->polyCount; ++j)
+            centers[tileOffsets[i] + j] = GetPolyCenter(tile, &tile->polys[j]);
+    }
+
+    struct LandmarkPortal
+    {
+        unsigned from_;
+        unsigned to_;
+        Vector3F point_;
+    };
+
+    std::vector<LandmarkPortal> portals;
+    for (int i = 0; i < maxTiles; ++i)
+    {
+        const dtMeshTile* tile = navMesh->getTile(i);
+        if (!tile->header)
+            continue;
+
+        for (int j = 0; j < tile->header->polyCount; ++j)
+        {
+            const dtPoly* poly = &tile->polys[j];
+            const unsigned from = tileOffsets[i] + j;
+
+            for (unsigned k = poly->firstLink; k != DT_NULL_LINK; k = tile->links[k].next)
+            {
+                const dtLink& link = tile->links[k];
+                if (!link.ref)
+                    continue;
+
+                unsigned salt, it, ip;
+                navMesh->decodePolyId(link.ref, salt, it, ip);
+
+                const dtMeshTile* neighbourTile = nullptr;
+                const dtPoly* neighbourPoly = nullptr;
+                navMesh->getTileAndPolyByRefUnsafe(link.ref, &neighbourTile, &neighbourPoly);
+
+                portals.push_back(LandmarkPortal{ from, tileOffsets[it] + ip, GetPortalPoint(tile, poly, link, neighbourTile, neighbourPoly, centers[from]) });
+            }
+        }
+    }
+
+    const unsigned numPortals = static_cast<unsigned>(portals.size());
+
+    // Compressed rows of the links into and out of every polygon
+    std::vector<unsigned> firstIn(numPolys + 1);
+    std::vector<unsigned> firstOut(numPolys + 1);
+    for (const auto& portal : portals)
+    {
+        ++firstIn[portal.to_ + 1];
+        ++firstOut[portal.from_ + 1];
+    }
+
+    std::partial_sum(firstIn.begin(), firstIn.end(), firstIn.begin());
+    std::partial_sum(firstOut.begin(), firstOut.end(), firstOut.begin());
+
+    std::vector<unsigned> portalsIn(numPortals);
+    std::vector<unsigned> portalsOut(numPortals);
+    {
+        std::vector<unsigned> cursorIn(firstIn.begin(), firstIn.end() - 1);
+        std::vector<unsigned> cursorOut(firstOut.begin(), firstOut.end() - 1);
+        for (unsigned i = 0; i < numPortals; ++i)
+        {
+            portalsIn[cursorIn[portals[i].to_]++] = i;
+            portalsOut[cursorOut[portals[i].from_]++] = i;
+        }
+    }
+
+    // Edges are two-way, the bound must hold in both directions
+    std::vector<unsigned> firstEdge(numPortals + 1);
+    for (unsigned poly = 0; poly < numPolys; ++poly)
+    {
+        const unsigned numIn = firstIn[poly + 1] - firstIn[poly];
+        const unsigned numOut = firstOut[poly + 1] - firstOut[poly];
+        for (unsigned k = firstIn[poly]; k < firstIn[poly + 1]; ++k)
+            firstEdge[portalsIn[k] + 1] += numOut;
+        for (unsigned k = firstOut[poly]; k < firstOut[poly + 1]; ++k)
+            firstEdge[portalsOut[k] + 1] += numIn;
+    }
+
+    std::partial_sum(firstEdge.begin(), firstEdge.end(), firstEdge.begin());
+
+    std::vector<std::pair<unsigned, float>> adjacency(firstEdge[numPortals]);
+    {
+        std::vector<unsigned> cursor(firstEdge.begin(), firstEdge.end() - 1);
+        for (unsigned poly = 0; poly < numPolys; ++poly)
+        {
+            for (unsigned a = firstIn[poly]; a < firstIn[poly + 1]; ++a)
+            {
+                for (unsigned b = firstOut[poly]; b < firstOut[poly + 1]; ++b)
+                {
+                    const unsigned in = portalsIn[a];
+                    const unsigned out = portalsOut[b];
+                    const float cost = (portals[out].point_ - portals[in].point_).Length();
+                    adjacency[cursor[in]++] = { out, cost };
+                    adjacency[cursor[out]++] = { in, cost };
+                }
+            }
+        }
+    }
+
+    // Polygons are connected if a link joins them
+    std::vector<std::pair<unsigned, unsigned>> polyLinks(numPortals);
+    for (unsigned i = 0; i < numPortals; ++i)
+        polyLinks[i] = { portals[i].from_, portals[i].to_ };
+
+    portals = {};
+
+    // Landmarks are spread over the largest island, the others are left to the straight line heuristic
+    std::vector<unsigned> islands(numPolys);
+    std::iota(islands.begin(), islands.end(), 0u);
+
+    auto findIsland = [&islands](unsigned poly) {
+        while (islands[poly] != poly)
+            poly = islands[poly] = islands[islands[poly]];
+        return poly;
+    };
+
+    for (const auto& [from, to] : polyLinks)
+    {
+        const unsigned a = findIsland(from);
+        const unsigned b = findIsland(to);
+        if (a != b)
+            islands[b] = a;
+    }
+
+    polyLinks = {};
+
+    std::vector<unsigned> islandSizes(numPolys);
+    for (unsigned i = 0; i < numPolys; ++i)
+    {
+        islands[i] = findIsland(i);
+        ++islandSizes[islands[i]];
+    }
+
+    const unsigned mainIsland = static_cast<unsigned>(std::max_element(islandSizes.begin(), islandSizes.end()) - islandSizes.begin());
+
+    // Farthest point selection: every next landmark is the polygon farthest from the chosen ones
+    Vector3F islandCenter;
+    for (unsigned i = 0; i < numPolys; ++i)
+    {
+        if (islands[i] == mainIsland)
+            islandCenter += centers[i];
+    }
+
+    islandCenter = islandCenter * (1.0f / islandSizes[mainIsland]);
+
+    auto planarDistance = [](const Vector3F& a, const Vector3F& b) {
+        return (a.x_ - b.x_) * (a.x_ - b.x_) + (a.z_ - b.z_) * (a.z_ - b.z_);
+    };
+
+    std::vector<float> nearest(numPolys, M_INFINITY);
+    std::vector<unsigned> landmarks;
+    Vector3F reference = islandCenter;
+    while (landmarks.size() < numLandmarks)
+    {
+        unsigned farthest = 0;
+        float farthestDistance = -1.0f;
+        for (unsigned i = 0; i < numPolys; ++i)
+        {
+            if (islands[i] != mainIsland)
+                continue;
+
+            nearest[i] = std::min(nearest[i], planarDistance(centers[i], reference));
+            if (nearest[i] > farthestDistance)
+            {
+                farthest = i;
+                farthestDistance = nearest[i];
+            }
+        }
+
+        // Fewer polygons than landmarks
+        if (!landmarks.empty() && farthestDistance <= 0.0f)
+            break;
+
+        landmarks.push_back(farthest);
+        reference = centers[farthest];
+    }
+
+    numLandmarks_ = static_cast<unsigned>(landmarks.size());
+    quantum_ = 1.0f;
+
+    // Every landmark is an independent Dijkstra search over the whole mesh, starting from all links into the landmark polygon
+    std::vector<std::vector<std::uint16_t>> columns(numLandmarks_);
+    auto solveRange = [&](std::size_t from, std::size_t to) {
+        std::vector<float> distances;
+        for (std::size_t j = from; j < to; ++j)
+        {
+            distances.assign(numPortals, M_INFINITY);
+
+            using OpenEntry = std::pair<float, unsigned>;
+            std::priority_queue<OpenEntry, std::vector<OpenEntry>, std::greater<OpenEntry>> open;
+
+            for (unsigned k = firstIn[landmarks[j]]; k < firstIn[landmarks[j] + 1]; ++k)
+            {
+                distances[portalsIn[k]] = 0.0f;
+                open.emplace(0.0f, portalsIn[k]);
+            }
+
+            while (!open.empty())
+            {
+                const auto [distance, portal] = open.top();
+                open.pop();
+
+                if (distance > distances[portal])
+                    continue;
+
+                for (unsigned k = firstEdge[portal]; k < firstEdge[portal + 1]; ++k)
+                {
+                    const auto [neighbour, cost] = adjacency[k];
+                    const float newDistance = distance + cost;
+                    if (newDistance < distances[neighbour])
+                    {
+                        distances[neighbour] = newDistance;
+                        open.emplace(newDistance, neighbour);
+                    }
+                }
+            }
+
+            // A polygon keeps the range of the distances of the links it can be entered by, rounded outwards
+            auto& column = columns[j];
+            column.resize(numPolys * 2u);
+            for (unsigned i = 0; i < numPolys; ++i)
+            {
+                float minDistance = M_INFINITY;
+                float maxDistance = -M_INFINITY;
+                for (unsigned k = firstIn[i]; k < firstIn[i + 1]; ++k)
+                {
+                    minDistance = std::min(minDistance, distances[portalsIn[k]]);
+                    maxDistance = std::max(maxDistance, distances[portalsIn[k]]);
+                }
+
+                if (minDistance == M_INFINITY)
+                {
+                    column[i * 2u] = LANDMARK_UNREACHABLE;
+                    column[i * 2u + 1u] = LANDMARK_UNREACHABLE;
+                    continue;
+                }
+
+                column[i * 2u] = static_cast<std::uint16_t>(std::min(std::floor(minDistance / quantum_), static_cast<float>(LANDMARK_MAX_DISTANCE)));
+                column[i * 2u + 1u] = static_cast<std::uint16_t>(std::min(std::ceil(maxDistance / quantum_), static_cast<float>(LANDMARK_MAX_DISTANCE)));
+            }
+        }
+    };
+
+    if (workers && numLandmarks_ > 1)
+        workers->parallelize_loop(std::size_t(0), std::size_t(numLandmarks_), solveRange);
+    else
+        solveRange(0, numLandmarks_);
+
+    // Distances of a polygon are kept together, the heuristic reads all of them at once
+    for (int i = 0; i < maxTiles; ++i)
+    {
+        const dtMeshTile* tile = navMesh->getTile(i);
+        if (!tile->header)
+            continue;
+
+        LandmarkTile& landmarkTile = tiles_[MakeTileKey(tile->header->x, tile->header->y, tile->header->layer)];
+        landmarkTile.polyCount_ = static_cast<unsigned>(tile->header->polyCount);
+        landmarkTile.distances_.resize(landmarkTile.polyCount_ * numLandmarks_ * 2u);
+
+        for (unsigned j = 0; j < landmarkTile.polyCount_; ++j)
+        {
+            for (unsigned k = 0; k < numLandmarks_; ++k)
+            {
+                landmarkTile.distances_[(j * numLandmarks_ + k) * 2u] = columns[k][(tileOffsets[i] + j) * 2u];
+                landmarkTile.distances_[(j * numLandmarks_ + k) * 2u + 1u] = columns[k][(tileOffsets[i] + j) * 2u + 1u];
+            }
+        }
+    }
+
+    spdlog::info("Computed {} landmarks over {} polygons and {} portals", numLandmarks_, numPolys, numPortals);
+
+    return Attach(navMesh);
+}
+
+void LandmarkTable::Clear()
+{
+    tiles_.clear();
+    tileDistances_.clear();
+    numLandmarks_ = 0;
+}
+
+bool LandmarkTable::Write(OutputStream& dest) const
+{
+    dest.WriteUInt(LANDMARK_VERSION);
+    dest.WriteUInt(numLandmarks_);
+    dest.WriteFloat(quantum_);
+    dest.WriteUInt(static_cast<std::uint32_t>(tiles_.size()));
+
+    for (const auto& [key, tile] : tiles_)
+    {
+        dest.WriteUInt64(key);
+        dest.WriteUInt(tile.polyCount_);
+
+        if (!tile.distances_.empty() && !dest.Write(tile.distances_.data(), tile.distances_.size() * sizeof(std::uint16_t)))
+            return false;
+    }
+
+    return true;
+}
+
+bool LandmarkTable::Read(InputStream& source)
+{
+    Clear();
+
+    if (source.ReadUInt() != LANDMARK_VERSION)
+    {
+        spdlog::error("Unsupported landmark table version");
+        return false;
+    }
+
+    // Counts are checked before anything is allocated for them, a damaged section must not allocate any amount of memory
+    const unsigned numLandmarks = source.ReadUInt();
+    const float quantum = source.ReadFloat();
+    if (numLandmarks > LANDMARK_MAX_COUNT || !std::isfinite(quantum) || quantum <= 0.0f)
+    {
+        spdlog::error("Malformed landmark table header");
+        return false;
+    }
+
+    numLandmarks_ = numLandmarks;
+    quantum_ = quantum;
+
+    const unsigned numTiles = source.ReadUInt();
+    for (unsigned i = 0; i < numTiles; ++i)
+    {
+        if (source.Eof())
+        {
+            spdlog::error("Landmark table is truncated");
+            Clear();
+            return false;
+        }
+
+        const std::uint64_t key = source.ReadUInt64();
+        const unsigned polyCount = source.ReadUInt();
+        if (polyCount > LANDMARK_MAX_TILE_POLYS)
+        {
+            spdlog::error("Malformed landmark table tile");
+            Clear();
+            return false;
+        }
+
+        LandmarkTile& tile = tiles_[key];
+        tile.polyCount_ = polyCount;
+        tile.distances_.resize(static_cast<std::size_t>(polyCount) * numLandmarks_ * 2u);
+
+        const std::size_t size = tile.distances_.size() * sizeof(std::uint16_t);
+        if (size && (source.Eof() || source.Read(tile.distances_.data(), size) != size))
+        {
+            spdlog::error("Landmark table is truncated");
+            Clear();
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool LandmarkTable::Attach(const dtNavMesh* navMesh)
+{
+    tileDistances_.clear();
+
+    if (!navMesh || !numLandmarks_)
+        return false;
+
+    std::vector<const std::uint16_t*> tileDistances(navMesh->getMaxTiles());
+    std::size_t numAttached = 0;
+    for (int i = 0; i < navMesh->getMaxTiles(); ++i)
+    {
+        const dtMeshTile* tile = navMesh->getTile(i);
+        if (!tile->header)
+            continue;
+
+        auto found = tiles_.find(MakeTileKey(tile->header->x, tile->header->y, tile->header->layer));
+        if (found == tiles_.end() || found->second.polyCount_ != static_cast<unsigned>(tile->header->polyCount))
+            return false;
+
+        tileDistances[i] = found->second.distances_.data();
+        ++numAttached;
+    }
+
+    if (!numAttached || numAttached != tiles_.size())
+        return false;
+
+    tileDistances_ = std::move(tileDistances);
+    return true;
+}
+
+int LandmarkTable::FindPath(NavigationQuery& query, const dtNavMesh* navMesh, dtPolyRef startRef, dtPolyRef endRef, const Vector3F& start,
+    const Vector3F& end, const dtQueryFilter* filter, dtPolyRef* path, int maxPath) const
+{
+    if (!query.nodePool_)
+    {
+        query.nodePool_ = std::make_unique<dtNodePool>(MAX_POLYS, static_cast<int>(dtNextPow2(MAX_POLYS / 4)));
+        query.openList_ = std::make_unique<dtNodeQueue>(MAX_POLYS);
+    }
+
+    dtNodePool* nodePool = query.nodePool_.get();
+    dtNodeQueue* openList = query.openList_.get();
+    nodePool->clear();
+    openList->clear();
+
+    if (startRef == endRef)
+    {
+        path[0] = startRef;
+        return 1;
+    }
+
+    const std::uint16_t* endDistances = GetDistances(navMesh, endRef);
+
+    dtNode* startNode = nodePool->getNode(startRef);
+    dtVcopy(startNode->pos, &start.x_);
+    startNode->pidx = 0;
+    startNode->cost = 0.0f;
+    startNode->total = dtVdist(&start.x_, &end.x_) * HEURISTIC_SCALE;
+    startNode->id = startRef;
+    startNode->flags = DT_NODE_OPEN;
+    openList->push(startNode);
+
+    dtNode* lastBestNode = startNode;
+    float lastBestNodeCost = startNode->total;
+
+    while (!openList->empty())
+    {
+        dtNode* bestNode = openList->pop();
+        bestNode->flags &= ~DT_NODE_OPEN;
+        bestNode->flags |= DT_NODE_CLOSED;
+
+        if (bestNode->id == endRef)
+        {
+            lastBestNode = bestNode;
+            break;
+        }
+
+        const dtPolyRef bestRef = bestNode->id;
+        const dtMeshTile* bestTile = nullptr;
+        const dtPoly* bestPoly = nullptr;
+        navMesh->getTileAndPolyByRefUnsafe(bestRef, &bestTile, &bestPoly);
+
+        dtPolyRef parentRef = 0;
+        const dtMeshTile* parentTile = nullptr;
+        const dtPoly* parentPoly = nullptr;
+        if (bestNode->pidx)
+            parentRef = nodePool->getNodeAtIdx(bestNode->pidx)->id;
+        if (parentRef)
+            navMesh->getTileAndPolyByRefUnsafe(parentRef, &parentTile, &parentPoly);
+
+        for (unsigned k = bestPoly->firstLink; k != DT_NULL_LINK; k = bestTile->links[k].next)
+        {
+            const dtLink& link = bestTile->links[k];
+            const dtPolyRef neighbourRef = link.ref;
+            if (!neighbourRef || neighbourRef == parentRef)
+                continue;
+
+            const dtMeshTile* neighbourTile = nullptr;
+            const dtPoly* neighbourPoly = nullptr;
+            navMesh->getTileAndPolyByRefUnsafe(neighbourRef, &neighbourTile, &neighbourPoly);
+            if (!filter->passFilter(neighbourRef, neighbourTile, neighbourPoly))
+                continue;
+
+            // Tile border links are told apart by the side they are entered from, as in Detour
+            const unsigned char crossSide = link.side != 0xff ? link.side >> 1 : 0;
+            dtNode* neighbourNode = nodePool->getNode(neighbourRef, crossSide);
+            if (!neighbourNode)
+                continue;
+
+            if (neighbourNode->flags == 0)
+                GetPortalPoint(bestTile, bestPoly, link, neighbourTile, neighbourPoly, Vector3F(bestNode->pos)).ToArray(neighbourNode->pos);
+
+            float cost;
+            float heuristic;
+            const float curCost = filter->getCost(bestNode->pos, neighbourNode->pos, parentRef, parentTile, parentPoly, bestRef, bestTile, bestPoly,
+                neighbourRef, neighbourTile, neighbourPoly);
+
+            if (neighbourRef == endRef)
+            {
+                const float endCost = filter->getCost(neighbourNode->pos, &end.x_, bestRef, bestTile, bestPoly, neighbourRef, neighbourTile, neighbourPoly,
+                    0, nullptr, nullptr);
+
+                cost = bestNode->cost + curCost + endCost;
+                heuristic = 0.0f;
+            }
+            else
+            {
+                // The landmark bound sees around obstacles the straight line goes through
+                const std::uint16_t* distances = endDistances ? GetDistances(navMesh, neighbourRef) : nullptr;
+                const float bound = distances ? GetLowerBound(distances, endDistances) : 0.0f;
+
+                cost = bestNode->cost + curCost;
+                heuristic = std::max(dtVdist(neighbourNode->pos, &end.x_), bound) * HEURISTIC_SCALE;
+            }
+
+            const float total = cost + heuristic;
+            if ((neighbourNode->flags & (DT_NODE_OPEN | DT_NODE_CLOSED)) && total >= neighbourNode->total)
+                continue;
+
+            neighbourNode->pidx = nodePool->getNodeIdx(bestNode);
+            neighbourNode->id = neighbourRef;
+            neighbourNode->flags = (neighbourNode->flags & ~DT_NODE_CLOSED);
+            neighbourNode->cost = cost;
+            neighbourNode->total = total;
+
+            if (neighbourNode->flags & DT_NODE_OPEN)
+                openList->modify(neighbourNode);
+            else
+            {
+                neighbourNode->flags |= DT_NODE_OPEN;
+                openList->push(neighbourNode);
+            }
+
+            if (heuristic < lastBestNodeCost)
+            {
+                lastBestNodeCost = heuristic;
+                lastBestNode = neighbourNode;
+            }
+        }
+    }
+
+    // Walk back from the node reached, keeping the beginning of the path if it is too long
+    int length = 0;
+    for (const dtNode* node = lastBestNode; node; node = nodePool->getNodeAtIdx(node->pidx))
+        ++length;
+
+    const dtNode* node = lastBestNode;
+    for (int i = length - 1; i >= 0; --i, node = nodePool->getNodeAtIdx(node->pidx))
+    {
+        if (i < maxPath)
+            path[i] = node->id;
+    }
+
+    return std::min(length, maxPath);
+}
+
+float LandmarkTable::GetLowerBound(const dtNavMesh* navMesh, dtPolyRef from, dtPolyRef to) const
+{
+    const std::uint16_t* distances = GetDistances(navMesh, from);
+    const std::uint16_t* targetDistances = GetDistances(navMesh, to);
+    return distances && targetDistances ? GetLowerBound(distances, targetDistances) : 0.0f;
+}
+
+unsigned LandmarkTable::Verify(NavigationQuery& query, const dtNavMesh* navMesh, const dtQueryFilter* filter, float (*frand)(), unsigned numSamples) const
+{
+    dtNavMeshQuery* navMeshQuery = query.query_;
+    std::vector<dtPolyRef> detourPath(MAX_POLYS);
+    std::vector<dtPolyRef> landmarkPath(MAX_POLYS);
+    std::vector<Vector3F> points(MAX_POLYS);
+
+    auto getLength = [&](const dtPolyRef* path, int numPolys, const Vector3F& start, const Vector3F& end) {
+        int numPoints = 0;
+        navMeshQuery->findStraightPath(&start.x_, &end.x_, path, numPolys, &points[0].x_, nullptr, nullptr, &numPoints, MAX_POLYS);
+
+        float length = 0.0f;
+        for (int i = 1; i < numPoints; ++i)
+            length += (points[i] - points[i - 1]).Length();
+
+        return length;
+    };
+
+    unsigned numCompared = 0;
+    unsigned numLonger = 0;
+    float maxExcess = 0.0f;
+    for (unsigned i = 0; i < numSamples; ++i)
+    {
+        dtPolyRef startRef = 0;
+        dtPolyRef endRef = 0;
+        Vector3F start;
+        Vector3F end;
+        if (dtStatusFailed(navMeshQuery->findRandomPoint(filter, frand, &startRef, &start.x_)) ||
+            dtStatusFailed(navMeshQuery->findRandomPoint(filter, frand, &endRef, &end.x_)))
+            continue;
+
+        int numDetourPolys = 0;
+        navMeshQuery->findPath(startRef, endRef, &start.x_, &end.x_, filter, detourPath.data(), &numDetourPolys, MAX_POLYS);
+        const int numLandmarkPolys = FindPath(query, navMesh, startRef, endRef, start, end, filter, landmarkPath.data(), MAX_POLYS);
+
+        // Partial paths end wherever the search gave up, they are not comparable
+        if (!numDetourPolys || !numLandmarkPolys || detourPath[numDetourPolys - 1] != endRef || landmarkPath[numLandmarkPolys - 1] != endRef)
+            continue;
+
+        ++numCompared;
+        const float detourLength = getLength(detourPath.data(), numDetourPolys, start, end);
+        const float excess = getLength(landmarkPath.data(), numLandmarkPolys, start, end) - detourLength;
+        if (excess > detourLength * VERIFY_RELATIVE_TOLERANCE + VERIFY_ABSOLUTE_TOLERANCE)
+        {
+            ++numLonger;
+            maxExcess = std::max(maxExcess, excess);
+        }
+    }
+
+    if (numLonger)
+        spdlog::warn("{} of {} landmark paths are longer than the Detour ones, by up to {:.2f}", numLonger, numCompared, maxExcess);
+    else
+        spdlog::info("Verified {} landmark paths against Detour", numCompared);
+
+    return numLonger;
+}
+
+const std::uint16_t* LandmarkTable::GetDistances(const dtNavMesh* navMesh, dtPolyRef ref) const
+{
+    unsigned salt, it, ip;
+    navMesh->decodePolyId(ref, salt, it, ip);
+
+    if (it >= tileDistances_.size() || !tileDistances_[it])
+        return nullptr;
+
+    return tileDistances_[it] + ip * numLandmarks_ * 2u;
+}
+
+float LandmarkTable::GetLowerBound(const std::uint16_t* distances, const std::uint16_t* targetDistances) const
+{
+    int bound = 0;
+    for (unsigned i = 0; i < numLandmarks_; ++i)
+    {
+        const int minDistance = distances[i * 2u];
+        const int maxDistance = distances[i * 2u + 1u];
+        const int targetMinDistance = targetDistances[i * 2u];
+        const int targetMaxDistance = targetDistances[i * 2u + 1u];
+
+        // Polygons the landmark cannot reach say nothing about each other, neither do saturated distances
+        if (minDistance == LANDMARK_UNREACHABLE || targetMinDistance == LANDMARK_UNREACHABLE)
+            continue;
+
+        // The portals the polygons are entered by are not known, only the range of their distances
+        if (targetMaxDistance != LANDMARK_MAX_DISTANCE)
+            bound = std::max(bound, minDistance - targetMaxDistance);
+        if (maxDistance != LANDMARK_MAX_DISTANCE)
+            bound = std::max(bound, targetMinDistance - maxDistance);
+    }
+
+    // Ranges are rounded outwards, the bound is exact in steps
+    return bound * quantum_;
+}
+
+}
\ No newline at end of file
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <unordered_map>
+
+#include "../navigation/NavigationQuery.h"
+#include "../utils/MathUtils.h"
+
+class dtNavMesh;
+class dtQueryFilter;
+class thread_pool;
+
+namespace WorldAssistant
+{
+
+class InputStream;
+class OutputStream;
+
+// Travel distances from a few landmark polygons to every polygon, used as an A* heuristic (ALT). Distances are measured between the portal points the
+// search walks, and the difference of two polygons' distances to a landmark never exceeds the distance between them. The bound is admissible, while
+// seeing around obstacles the straight line goes through.
+class LandmarkTable
+{
+public:
+    // Pick up to 256 landmarks over the largest island and compute their distances to every polygon. Distances are computed on the workers if given. Return false if
+    // there are no polygons.
+    bool Build(const dtNavMesh* navMesh, unsigned numLandmarks, thread_pool* workers = nullptr);
+    // Remove everything.
+    void Clear();
+
+    // Write the distances.
+    bool Write(OutputStream& dest) const;
+    // Read the distances. The table must be attached to the navigation mesh afterwards. Return false if the data is malformed.
+    bool Read(InputStream& source);
+    // Bind the distances to the tiles of the navigation mesh. Return false if the tiles do not match the ones the distances were computed for.
+    bool Attach(const dtNavMesh* navMesh);
+
+    // Find a polygon corridor between the polygons into path like dtNavMeshQuery::findPath, guided by the landmark bound. Return number of polygons.
+    int FindPath(NavigationQuery& query, const dtNavMesh* navMesh, dtPolyRef startRef, dtPolyRef endRef, const Vector3F& start, const Vector3F& end,
+        const dtQueryFilter* filter, dtPolyRef* path, int maxPath) const;
+    // Return lower bound of the travel distance between the portals the polygons are entered by, zero if unknown.
+    float GetLowerBound(const dtNavMesh* navMesh, dtPolyRef from, dtPolyRef to) const;
+    // Compare the paths found between random points against dtNavMeshQuery::findPath and log the outcome. Return number of paths that are longer.
+    unsigned Verify(NavigationQuery& query, const dtNavMesh* navMesh, const dtQueryFilter* filter, float (*frand)(), unsigned numSamples) const;
+
+    // Return whether the table is attached to a navigation mesh.
+    bool IsReady() const { return !tileDistances_.empty(); }
+    // Return number of landmarks.
+    unsigned GetNumLandmarks() const { return numLandmarks_; }
+
+private:
+    struct LandmarkTile
+    {
+        // Number of polygons of the tile.
+        unsigned polyCount_{};
+        // Quantized range of the distances of the links into a polygon, numLandmarks_ minimum and maximum pairs per polygon. Unreachable polygons hold
+        // LANDMARK_UNREACHABLE.
+        std::vector<std::uint16_t> distances_;
+    };
+
+    // Return distances of the polygon, null if unknown.
+    const std::uint16_t* GetDistances(const dtNavMesh* navMesh, dtPolyRef ref) const;
+    // Return lower bound between the polygon and the distances of the target.
+    float GetLowerBound(const std::uint16_t* distances, const std::uint16_t* targetDistances) const;
+
+    // Distances by tile key.
+    std::unordered_map<std::uint64_t, LandmarkTile> tiles_;
+    // Distances of every tile by tile index of the attached navigation mesh.
+    std::vector<const std::uint16_t*> tileDistances_;
+    // Number of landmarks.
+    unsigned numLandmarks_{};
+    // Distance quantization step.
+    float quantum_{1.0f};
+};
+
+}
\ No newline at end of file
@@ -11,6 +11,7 @@ void NavArea::SetAreaID(unsigned newID)
 void NavArea::SetBoundingBox(const BoundingBox& bounds)
 {
 	bounds_ = bounds;
+	box_.Define(Vector2F(bounds.min_.x_, bounds.min_.z_), Vector2F(bounds.max_.x_, bounds.max_.z_));
 }
 
 }
\ No newline at end of file
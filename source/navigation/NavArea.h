@@ -1,15 +1,19 @@
 #pragma once
 
 #include "../utils/MathUtils.h"
+#include "../utils/Quadtree.h"
 
 namespace WorldAssistant
 {
 
-class NavArea
+class NavArea : public QuadtreeValue
 {
 public:
 	bool IsEnabled() const { return enabled_; }
 
+	// Enable or disable the area.
+	void SetEnabled(bool enable) { enabled_ = enable; }
+
 	// Get the area id for this volume.
     unsigned GetAreaID() const { return (unsigned)areaID_; }
 
@@ -19,7 +23,7 @@ public:
 	// Get the bounding box of this navigation area, in local space.
 	const BoundingBox& GetBoundingBox() const { return bounds_; }
 
-	 // Set the bounding box of this area, in local space.
+	 // Set the bounding box of this area, in local space. Must not be called while the area is added to a scene.
 	void SetBoundingBox(const BoundingBox& bounds);
 
 private:
@@ -1,20 +1,171 @@
+#include <algorithm>
 #include <cassert>
+#include <cstdint>
+#include <cstdlib>
 
 #include "../navigation/NavBuildData.h"
+#include "../navigation/NavBuildReport.h"
 
 #include "DetourTileCacheBuilder.h"
 #include "Recast.h"
+#include "RecastAlloc.h"
 
 namespace WorldAssistant
 {
 
+// Smallest chunk of a build arena.
+static const std::size_t NAV_BUILD_ARENA_CHUNK_SIZE = 4u * 1024u * 1024u;
+// Most memory a build arena keeps once a tile is done, the rest goes back to the system. Covers the peak of a typical tile; every thread that ever
+// built a tile keeps this much until it exits, long-lived worker and server threads included.
+static const std::size_t NAV_BUILD_ARENA_MAX_RETAINED = 8u * 1024u * 1024u;
+// Every Recast block starts with a header telling where it came from, sized to keep the block aligned like malloc.
+static const std::size_t NAV_BUILD_BLOCK_HEADER_SIZE = alignof(std::max_align_t);
+static const std::uint32_t NAV_BUILD_BLOCK_HEAP = 0x48454150u;
+static const std::uint32_t NAV_BUILD_BLOCK_ARENA = 0x4152454eu;
+
+static thread_local NavBuildArena* CURRENT_ARENA = nullptr;
+
+static std::size_t AlignBlockSize(std::size_t size)
+{
+    return (size + NAV_BUILD_BLOCK_HEADER_SIZE - 1) & ~(NAV_BUILD_BLOCK_HEADER_SIZE - 1);
+}
+
+static void* RecastAlloc(size_t size, rcAllocHint /*hint*/)
+{
+    unsigned char* block = nullptr;
+    std::uint32_t tag = NAV_BUILD_BLOCK_ARENA;
+
+    if (CURRENT_ARENA)
+        block = static_cast<unsigned char*>(CURRENT_ARENA->Allocate(NAV_BUILD_BLOCK_HEADER_SIZE + size));
+
+    if (!block)
+    {
+        block = static_cast<unsigned char*>(std::malloc(NAV_BUILD_BLOCK_HEADER_SIZE + size));
+        tag = NAV_BUILD_BLOCK_HEAP;
+    }
+
+    if (!block)
+        return nullptr;
+
+    *reinterpret_cast<std::uint32_t*>(block) = tag;
+    return block + NAV_BUILD_BLOCK_HEADER_SIZE;
+}
+
+static void RecastFree(void* ptr)
+{
+    if (!ptr)
+        return;
+
+    // Arena blocks are reclaimed by NavBuildArena::Reset
+    unsigned char* block = static_cast<unsigned char*>(ptr) - NAV_BUILD_BLOCK_HEADER_SIZE;
+    if (*reinterpret_cast<const std::uint32_t*>(block) == NAV_BUILD_BLOCK_HEAP)
+        std::free(block);
+    else
+        assert(*reinterpret_cast<const std::uint32_t*>(block) == NAV_BUILD_BLOCK_ARENA);
+}
+
+// Recast must use the hooks from its first allocation on, a heap block without the header could not be freed by them
+[[maybe_unused]] static const bool RECAST_ALLOC_INSTALLED = []() {
+    rcAllocSetCustom(RecastAlloc, RecastFree);
+    return true;
+}();
+
+/*
+    NavBuildArena
+*/
+NavBuildArena::~NavBuildArena()
+{
+    for (const Chunk& chunk : chunks_)
+        std::free(chunk.data_);
+}
+
+void* NavBuildArena::Allocate(std::size_t size)
+{
+    size = AlignBlockSize(size);
+
+    if (chunks_.empty() || chunks_.back().size_ - chunks_.back().used_ < size)
+    {
+        Chunk chunk;
+        chunk.size_ = std::max(size, NAV_BUILD_ARENA_CHUNK_SIZE);
+        chunk.data_ = static_cast<unsigned char*>(std::malloc(chunk.size_));
+        if (!chunk.data_)
+            return nullptr;
+
+        chunks_.push_back(chunk);
+    }
+
+    Chunk& chunk = chunks_.back();
+    void* block = chunk.data_ + chunk.used_;
+    chunk.used_ += size;
+    return block;
+}
+
+void NavBuildArena::Reset()
+{
+    std::size_t total = 0;
+    for (const Chunk& chunk : chunks_)
+        total += chunk.size_;
+
+    // One chunk holding everything the last tile needed serves the next ones without growing. The arena of a thread that builds a huge tile now and
+    // then, such as the server thread, must not hold on to all of its memory, so the chunk is capped.
+    const std::size_t retained = std::min(total, NAV_BUILD_ARENA_MAX_RETAINED);
+    if (chunks_.size() == 1 && retained == total)
+    {
+        chunks_.back().used_ = 0;
+        return;
+    }
+
+    for (const Chunk& chunk : chunks_)
+        std::free(chunk.data_);
+
+    chunks_.clear();
+
+    if (!retained)
+        return;
+
+    Chunk chunk;
+    chunk.size_ = retained;
+    chunk.data_ = static_cast<unsigned char*>(std::malloc(retained));
+    if (chunk.data_)
+        chunks_.push_back(chunk);
+}
+
+NavBuildArena* NavBuildArena::GetCurrent()
+{
+    return CURRENT_ARENA;
+}
+
+/*
+    NavBuildArenaScope
+*/
+NavBuildArenaScope::NavBuildArenaScope(NavBuildArena& arena) :
+    arena_(arena),
+    previous_(CURRENT_ARENA)
+{
+    assert(RECAST_ALLOC_INSTALLED);
+    CURRENT_ARENA = &arena_;
+}
+
+NavBuildArenaScope::~NavBuildArenaScope()
+{
+    CURRENT_ARENA = previous_;
+    arena_.Reset();
+}
+
 NavBuildData::NavBuildData() :
-	ctx_(new rcContext(true)),
+	ctx_(new NavBuildContext()),
     heightField_(nullptr),
     compactHeightField_(nullptr)
 {
 }
 
+void NavBuildData::Clear()
+{
+    vertices_.clear();
+    indices_.clear();
+    navAreas_.clear();
+}
+
 NavBuildData::~NavBuildData()
 {
     delete(ctx_);
@@ -1,11 +1,10 @@
 #pragma once
 
+#include <cstddef>
 #include <vector>
 
 #include "../utils/MathUtils.h"
 
-class rcContext;
-
 struct dtTileCacheContourSet;
 struct dtTileCachePolyMesh;
 struct dtTileCacheAlloc;
@@ -19,6 +18,8 @@ struct rcPolyMeshDetail;
 namespace WorldAssistant
 {
 
+class NavBuildContext;
+
 // Navigation area stub.
 struct NavAreaStub
 {
@@ -28,6 +29,65 @@ struct NavAreaStub
     unsigned char areaID_{};
 };
 
+// Bump allocator Recast allocates from while a tile is built on the owning thread. Nothing is freed until Reset, which keeps the memory for the next tile,
+// so building thousands of tiles does not go through malloc for every span pool and temporary buffer.
+class NavBuildArena
+{
+public:
+    // Construct empty.
+    NavBuildArena() = default;
+    // Free all chunks.
+    ~NavBuildArena();
+
+    // Non-copyable.
+    NavBuildArena(const NavBuildArena&) = delete;
+    // Non-assignable.
+    NavBuildArena& operator =(const NavBuildArena&) = delete;
+
+    // Allocate a block aligned like malloc. Return null if out of memory.
+    void* Allocate(std::size_t size);
+    // Reclaim all blocks at once. Chunks used by the last tile are merged into one big enough for it, up to a cap.
+    void Reset();
+
+    // Return the arena bound to the calling thread, null if Recast allocates from the heap.
+    static NavBuildArena* GetCurrent();
+
+private:
+    friend class NavBuildArenaScope;
+
+    struct Chunk
+    {
+        // Chunk memory.
+        unsigned char* data_{};
+        // Chunk size.
+        std::size_t size_{};
+        // Bytes handed out.
+        std::size_t used_{};
+    };
+
+    // Chunks in order of allocation, the last one is being filled.
+    std::vector<Chunk> chunks_;
+};
+
+// Binds the arena to the calling thread for the lifetime of the scope, Recast allocations made meanwhile come from it. The arena is reset on exit.
+class NavBuildArenaScope
+{
+public:
+    // Bind the arena.
+    explicit NavBuildArenaScope(NavBuildArena& arena);
+    // Restore the previous binding and reset the arena.
+    ~NavBuildArenaScope();
+
+    NavBuildArenaScope(const NavBuildArenaScope&) = delete;
+    NavBuildArenaScope& operator =(const NavBuildArenaScope&) = delete;
+
+private:
+    // Bound arena.
+    NavBuildArena& arena_;
+    // Arena bound before.
+    NavBuildArena* previous_;
+};
+
 struct NavBuildData
 {
     // Constructor.
@@ -35,12 +95,15 @@ struct NavBuildData
     // Destructor.
     virtual ~NavBuildData();
 
+    // Remove the gathered geometry and areas, keeping the capacity for the next tile.
+    void Clear();
+
     // Vertices from geometries.
     std::vector<Vector3F> vertices_;
     // Triangle indices from geometries.
     std::vector<std::int32_t> indices_;
-    // Recast context.
-    rcContext* ctx_;
+    // Recast context timing the build stages.
+    NavBuildContext* ctx_;
     // Recast heightfield.
     rcHeightfield* heightField_;
     // Recast compact heightfield.
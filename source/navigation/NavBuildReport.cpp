@@ -0,0 +1,178 @@
+#include <algorithm>
+#include <fstream>
+
+#include "../navigation/NavBuildReport.h"
+
+#include <spdlog/spdlog.h>
+
+namespace WorldAssistant
+{
+
+static const char* NAVBUILD_STAGE_NAMES[NAVBUILD_STAGE_COUNT] = { "rasterize", "filter", "compact", "erode", "regions", "layers", "compress" };
+
+// Stage of every Recast timer, NAVBUILD_STAGE_COUNT for timers nested in others or not part of a stage. Area marking counts as erosion.
+static NavBuildStage GetTimerStage(int label)
+{
+    switch (label)
+    {
+    case RC_TIMER_RASTERIZE_TRIANGLES:
+        return NAVBUILD_STAGE_RASTERIZE;
+    case RC_TIMER_FILTER_LOW_OBSTACLES:
+    case RC_TIMER_FILTER_BORDER:
+    case RC_TIMER_FILTER_WALKABLE:
+        return NAVBUILD_STAGE_FILTER;
+    case RC_TIMER_BUILD_COMPACTHEIGHTFIELD:
+        return NAVBUILD_STAGE_COMPACT;
+    case RC_TIMER_ERODE_AREA:
+    case RC_TIMER_MEDIAN_AREA:
+    case RC_TIMER_MARK_BOX_AREA:
+    case RC_TIMER_MARK_CYLINDER_AREA:
+    case RC_TIMER_MARK_CONVEXPOLY_AREA:
+        return NAVBUILD_STAGE_ERODE;
+    case RC_TIMER_BUILD_DISTANCEFIELD:
+    case RC_TIMER_BUILD_REGIONS:
+        return NAVBUILD_STAGE_REGIONS;
+    case RC_TIMER_BUILD_LAYERS:
+        return NAVBUILD_STAGE_LAYERS;
+    case RC_TIMER_TEMP:
+        return NAVBUILD_STAGE_COMPRESS;
+    default:
+        return NAVBUILD_STAGE_COUNT;
+    }
+}
+
+NavBuildContext::NavBuildContext() :
+    rcContext(true)
+{
+}
+
+void NavBuildContext::GetStageTimes(NavBuildTileProfile& profile) const
+{
+    std::fill(std::begin(profile.stageTimes_), std::end(profile.stageTimes_), 0);
+    for (int label = 0; label < RC_MAX_TIMERS; ++label)
+    {
+        const NavBuildStage stage = GetTimerStage(label);
+        if (stage != NAVBUILD_STAGE_COUNT)
+            profile.stageTimes_[stage] += accumulatedTimes_[label];
+    }
+
+    profile.totalTime_ = accumulatedTimes_[RC_TIMER_TOTAL];
+}
+
+void NavBuildContext::doLog(const rcLogCategory category, const char* msg, const int len)
+{
+    if (category == RC_LOG_ERROR)
+        spdlog::error("Recast: {}", std::string_view(msg, static_cast<std::size_t>(len)));
+    else if (category == RC_LOG_WARNING)
+        spdlog::warn("Recast: {}", std::string_view(msg, static_cast<std::size_t>(len)));
+}
+
+void NavBuildContext::doResetTimers()
+{
+    std::fill(std::begin(accumulatedTimes_), std::end(accumulatedTimes_), 0);
+}
+
+void NavBuildContext::doStartTimer(const rcTimerLabel label)
+{
+    startTimes_[label] = std::chrono::steady_clock::now();
+}
+
+void NavBuildContext::doStopTimer(const rcTimerLabel label)
+{
+    accumulatedTimes_[label] += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - startTimes_[label]).count();
+}
+
+int NavBuildContext::doGetAccumulatedTime(const rcTimerLabel label) const
+{
+    // Recast reports microseconds
+    return static_cast<int>(accumulatedTimes_[label] / 1000);
+}
+
+NavBuildReport::NavBuildReport(std::vector<std::string> profileNames) :
+    profileNames_(std::move(profileNames)),
+    tiles_(profileNames_.size())
+{
+}
+
+void NavBuildReport::Add(std::size_t profileIdx, const NavBuildTileProfile& tile)
+{
+    tiles_[profileIdx].push_back(tile);
+}
+
+void NavBuildReport::LogSummary() const
+{
+    for (std::size_t profileIdx = 0; profileIdx < profileNames_.size(); ++profileIdx)
+    {
+        const auto& tiles = tiles_[profileIdx];
+        if (tiles.empty())
+            continue;
+
+        std::int64_t stageTimes[NAVBUILD_STAGE_COUNT]{};
+        std::int64_t totalTime = 0;
+        std::size_t numCached = 0;
+        const NavBuildTileProfile* slowest = &tiles.front();
+
+        for (const auto& tile : tiles)
+        {
+            for (int stage = 0; stage < NAVBUILD_STAGE_COUNT; ++stage)
+                stageTimes[stage] += tile.stageTimes_[stage];
+
+            totalTime += tile.totalTime_;
+            numCached += tile.cached_ ? 1u : 0u;
+            if (tile.totalTime_ > slowest->totalTime_)
+                slowest = &tile;
+        }
+
+        spdlog::info("Build profile {}: {} tiles ({} from cache), {:.3f} s of tile builds summed over all threads", profileNames_[profileIdx], tiles.size(), numCached,
+            totalTime / 1e9);
+
+        // Share of every stage in the summed tile time, the rest goes to gathering areas and the work between the stages
+        for (int stage = 0; stage < NAVBUILD_STAGE_COUNT; ++stage)
+        {
+            spdlog::info("  {:<10} {:10.3f} s {:5.1f}%", NAVBUILD_STAGE_NAMES[stage], stageTimes[stage] / 1e9,
+                totalTime > 0 ? 100.0 * stageTimes[stage] / totalTime : 0.0);
+        }
+
+        spdlog::info("  Slowest tile {}:{} with {} triangles took {:.3f} ms", slowest->x_, slowest->z_, slowest->numTriangles_, slowest->totalTime_ / 1e6);
+    }
+}
+
+bool NavBuildReport::Write(const std::filesystem::path& path) const
+{
+    std::ofstream stream(path, std::ios::out | std::ios::trunc);
+    if (!stream.is_open())
+    {
+        spdlog::error("Could not write navigation build report {}", path.string());
+        return false;
+    }
+
+    stream << "profile,x,z,triangles,layers,cached";
+    for (const char* name : NAVBUILD_STAGE_NAMES)
+        stream << "," << name << "_us";
+    stream << ",total_us\n";
+
+    stream.setf(std::ios::fixed);
+    stream.precision(1);
+
+    for (std::size_t profileIdx = 0; profileIdx < profileNames_.size(); ++profileIdx)
+    {
+        for (const auto& tile : tiles_[profileIdx])
+        {
+            stream << profileNames_[profileIdx] << "," << tile.x_ << "," << tile.z_ << "," << tile.numTriangles_ << "," << tile.numLayers_ << "," << (tile.cached_ ? 1 : 0);
+            for (const std::int64_t time : tile.stageTimes_)
+                stream << "," << time / 1e3;
+            stream << "," << tile.totalTime_ / 1e3 << "\n";
+        }
+    }
+
+    if (!stream)
+    {
+        spdlog::error("Could not write navigation build report {}", path.string());
+        return false;
+    }
+
+    spdlog::info("Wrote navigation build report {}", path.string());
+    return true;
+}
+
+}
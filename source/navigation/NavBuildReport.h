@@ -0,0 +1,92 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include <Recast.h>
+
+namespace WorldAssistant
+{
+
+// Stages of a tile build timed by the build report.
+enum NavBuildStage
+{
+    NAVBUILD_STAGE_RASTERIZE = 0,
+    NAVBUILD_STAGE_FILTER,
+    NAVBUILD_STAGE_COMPACT,
+    NAVBUILD_STAGE_ERODE,
+    NAVBUILD_STAGE_REGIONS,
+    NAVBUILD_STAGE_LAYERS,
+    NAVBUILD_STAGE_COMPRESS,
+    NAVBUILD_STAGE_COUNT
+};
+
+// Time spent building one tile of one profile.
+struct NavBuildTileProfile
+{
+    // Tile X coordinate.
+    int x_{};
+    // Tile Z coordinate.
+    int z_{};
+    // Number of input triangles.
+    unsigned numTriangles_{};
+    // Number of layers built.
+    unsigned numLayers_{};
+    // Whether the layers were read from the tile build cache instead of built.
+    bool cached_{};
+    // Time of every stage in nanoseconds.
+    std::int64_t stageTimes_[NAVBUILD_STAGE_COUNT]{};
+    // Time of the whole tile build in nanoseconds, including the work between the stages.
+    std::int64_t totalTime_{};
+};
+
+// Recast context of a tile build. Times every Recast call and forwards Recast warnings and errors to the log.
+class NavBuildContext : public rcContext
+{
+public:
+    // Construct with logging and timers enabled.
+    NavBuildContext();
+
+    // Copy the accumulated time of the stages into the tile profile.
+    void GetStageTimes(NavBuildTileProfile& profile) const;
+
+protected:
+    void doLog(const rcLogCategory category, const char* msg, const int len) override;
+    void doResetTimers() override;
+    void doStartTimer(const rcTimerLabel label) override;
+    void doStopTimer(const rcTimerLabel label) override;
+    int doGetAccumulatedTime(const rcTimerLabel label) const override;
+
+private:
+    // Start of the running timer by label.
+    std::chrono::steady_clock::time_point startTimes_[RC_MAX_TIMERS];
+    // Accumulated time in nanoseconds by label.
+    std::int64_t accumulatedTimes_[RC_MAX_TIMERS]{};
+};
+
+// Tile profiles of a build, summarized in the log and optionally written to a CSV file with one row per tile and profile.
+class NavBuildReport
+{
+public:
+    // Construct over the names of the profiles built together.
+    explicit NavBuildReport(std::vector<std::string> profileNames);
+
+    // Add the profile of a built tile of the profile by index. Called from one thread.
+    void Add(std::size_t profileIdx, const NavBuildTileProfile& tile);
+
+    // Log where the build spent its time for every profile.
+    void LogSummary() const;
+    // Write every tile to a CSV file, times in microseconds. Return true if successful.
+    bool Write(const std::filesystem::path& path) const;
+
+private:
+    // Name of every profile by index.
+    std::vector<std::string> profileNames_;
+    // Built tiles of every profile by index.
+    std::vector<std::vector<NavBuildTileProfile>> tiles_;
+};
+
+}
@@ -0,0 +1,583 @@
+#include "../navigation/NavigationGraph.h"
+#include "../navigation/NavigationUtils.h"
+
+#include <DetourNavMesh.h>
+#include <DetourNavMeshQuery.h>
+
+#include <numeric>
+#include <queue>
+
+namespace WorldAssistant
+{
+
+// Minimum distance in tiles between the start and the end for a route to be planned over the graph.
+static const int HIERARCHICAL_MIN_TILES = 4;
+// Number of portals passed by one refinement search.
+static const std::size_t HIERARCHICAL_SEGMENT_PORTALS = 3;
+// Maximum number of clusters expanded by a route search.
+static const std::size_t HIERARCHICAL_MAX_NODES = 65536;
+// Number of trailing corridor polygons checked for loops when segments are joined.
+static const std::size_t CORRIDOR_LOOP_LOOKBACK = 8;
+
+namespace
+{
+
+int FindRoot(std::vector<int>& parents, int index)
+{
+    while (parents[index] != index)
+    {
+        parents[index] = parents[parents[index]];
+        index = parents[index];
+    }
+
+    return index;
+}
+
+// Return key of the layer of the tile, the tile part of a cluster key.
+std::uint64_t MakeLayerKey(std::uint64_t tileKey, std::size_t layer)
+{
+    const Int32Vector2 coords = GetTileKeyCoords(tileKey);
+    return MakeTileKey(coords.x_, coords.y_, static_cast<int>(layer));
+}
+
+}
+
+void NavigationGraph::MarkTileDirty(const Int32Vector2& tile)
+{
+    const std::unique_lock<std::shared_mutex> lock(mutex_);
+
+    // Links of the neighbours to the tile are rebuilt by Detour as well
+    for (int y = tile.y_ - 1; y <= tile.y_ + 1; ++y)
+    {
+        for (int x = tile.x_ - 1; x <= tile.x_ + 1; ++x)
+            dirtyTiles_.insert(MakeTileKey(x, y));
+    }
+
+    ++numMarks_;
+}
+
+void NavigationGraph::Update(const dtNavMesh* navMesh)
+{
+    UpdateTiles(navMesh, true);
+}
+
+bool NavigationGraph::UpdateTiles(const dtNavMesh* navMesh, bool wait)
+{
+    if (!navMesh)
+        return false;
+
+    // Every query comes through here, most find nothing to do and should not wait for each other
+    {
+        const std::shared_lock<std::shared_mutex> lock(mutex_);
+        if (dirtyTiles_.empty())
+            return true;
+    }
+
+    // Queries do not wait for a running update, they go on without the graph instead
+    std::unique_lock<std::mutex> updateLock(updateMutex_, std::defer_lock);
+    if (wait)
+        updateLock.lock();
+    else if (!updateLock.try_lock())
+        return false;
+
+    std::unordered_set<std::uint64_t> dirtyTiles;
+    std::uint64_t numMarks;
+    {
+        const std::shared_lock<std::shared_mutex> lock(mutex_);
+        dirtyTiles = dirtyTiles_;
+        numMarks = numMarks_;
+    }
+
+    if (dirtyTiles.empty())
+        return true;
+
+    // The graph is rebuilt into a copy while queries keep reading the current one
+    TileMap tiles = tiles_;
+    const dtMeshTile* layers[MAX_TILE_LAYERS];
+
+    // Clusters of all dirty tiles come first, edges refer to the clusters of neighbours
+    for (const std::uint64_t tileKey : dirtyTiles)
+    {
+        tiles.erase(tileKey);
+
+        const Int32Vector2 coords = GetTileKeyCoords(tileKey);
+        const int numLayers = navMesh->getTilesAt(coords.x_, coords.y_, layers, MAX_TILE_LAYERS);
+        for (int i = 0; i < numLayers; ++i)
+            BuildClusters(tiles, navMesh, layers[i]);
+    }
+
+    for (const std::uint64_t tileKey : dirtyTiles)
+    {
+        const Int32Vector2 coords = GetTileKeyCoords(tileKey);
+        const int numLayers = navMesh->getTilesAt(coords.x_, coords.y_, layers, MAX_TILE_LAYERS);
+        for (int i = 0; i < numLayers; ++i)
+            BuildEdges(tiles, navMesh, layers[i]);
+    }
+
+    // A tile change may join or split islands anywhere
+    const unsigned numIslands = BuildIslands(tiles);
+
+    const std::unique_lock<std::shared_mutex> lock(mutex_);
+    tiles_.swap(tiles);
+    numIslands_ = numIslands;
+
+    // Tiles marked while the update ran are rebuilt by the next one
+    if (numMarks_ == numMarks)
+        dirtyTiles_.clear();
+
+    return true;
+}
+
+void NavigationGraph::Clear()
+{
+    const std::lock_guard<std::mutex> updateLock(updateMutex_);
+    const std::unique_lock<std::shared_mutex> lock(mutex_);
+    tiles_.clear();
+    dirtyTiles_.clear();
+    numIslands_ = 0;
+}
+
+bool NavigationGraph::IsLongRoute(const dtNavMesh* navMesh, dtPolyRef startRef, dtPolyRef endRef) const
+{
+    const dtMeshTile* startTile = nullptr;
+    const dtMeshTile* endTile = nullptr;
+    const dtPoly* poly = nullptr;
+    navMesh->getTileAndPolyByRefUnsafe(startRef, &startTile, &poly);
+    navMesh->getTileAndPolyByRefUnsafe(endRef, &endTile, &poly);
+    if (!startTile || !startTile->header || !endTile || !endTile->header)
+        return false;
+
+    const int dx = std::abs(startTile->header->x - endTile->header->x);
+    const int dy = std::abs(startTile->header->y - endTile->header->y);
+    return std::max(dx, dy) >= HIERARCHICAL_MIN_TILES;
+}
+
+bool NavigationGraph::FindCorridor(NavigationQuery& query, dtPolyRef startRef, dtPolyRef endRef, const Vector3F& start, const Vector3F& end,
+    const dtQueryFilter* filter, std::vector<dtPolyRef>& dest)
+{
+    dtNavMeshQuery* navMeshQuery = query.query_;
+    const dtNavMesh* navMesh = navMeshQuery->getAttachedNavMesh();
+    FindPathData* pathData = &query.pathData_;
+
+    dest.clear();
+
+    // The graph of a running update is out of date, the regular search takes over
+    if (!UpdateTiles(navMesh, false))
+        return false;
+
+    // The route is copied out of the graph, the refinement below runs without holding up updates
+    std::vector<NavigationGraphEdge> route;
+    {
+        const std::shared_lock<std::shared_mutex> lock(mutex_);
+
+        std::uint64_t startCluster;
+        std::uint64_t endCluster;
+        if (!GetClusterKey(tiles_, navMesh, startRef, startCluster) || !GetClusterKey(tiles_, navMesh, endRef, endCluster) || startCluster == endCluster)
+            return false;
+
+        if (GetIsland(startCluster) != GetIsland(endCluster))
+            return false;
+
+        if (!FindRoute(startCluster, endCluster, route))
+            return false;
+    }
+
+    dtPolyRef segmentStartRef = startRef;
+    Vector3F segmentStart = start;
+
+    // Refine the route by short searches between every few portals
+    for (std::size_t i = 0; i <= route.size(); ++i)
+    {
+        const bool last = i == route.size();
+        if (!last && (i + 1) % HIERARCHICAL_SEGMENT_PORTALS != 0)
+            continue;
+
+        const dtPolyRef segmentEndRef = last ? endRef : route[i].toRef_;
+        const Vector3F segmentEnd = last ? end : route[i].portal_;
+
+        int numPolys = 0;
+        const dtStatus status = navMeshQuery->findPath(segmentStartRef, segmentEndRef, &segmentStart.x_, &segmentEnd.x_, filter,
+            pathData->polys_, &numPolys, MAX_POLYS);
+
+        // The graph ignores the filter, a blocked segment is left to the regular search
+        if (dtStatusFailed(status) || !numPolys || pathData->polys_[numPolys - 1] != segmentEndRef)
+        {
+            dest.clear();
+            return false;
+        }
+
+        for (int j = 0; j < numPolys; ++j)
+        {
+            const dtPolyRef ref = pathData->polys_[j];
+
+            // Consecutive segments may walk back over the last polygons, cut such loops
+            const std::size_t lookFrom = dest.size() > CORRIDOR_LOOP_LOOKBACK ? dest.size() - CORRIDOR_LOOP_LOOKBACK : 0;
+            const auto found = std::find(dest.begin() + lookFrom, dest.end(), ref);
+            if (found != dest.end())
+                dest.erase(found + 1, dest.end());
+            else
+                dest.push_back(ref);
+        }
+
+        segmentStartRef = segmentEndRef;
+        segmentStart = segmentEnd;
+    }
+
+    return !dest.empty();
+}
+
+bool NavigationGraph::IsReachable(const dtNavMesh* navMesh, dtPolyRef startRef, dtPolyRef endRef)
+{
+    if (!UpdateTiles(navMesh, false))
+        return true;
+
+    const std::shared_lock<std::shared_mutex> lock(mutex_);
+
+    std::uint64_t startCluster;
+    std::uint64_t endCluster;
+    if (!GetClusterKey(tiles_, navMesh, startRef, startCluster) || !GetClusterKey(tiles_, navMesh, endRef, endCluster))
+        return true;
+
+    return GetIsland(startCluster) == GetIsland(endCluster);
+}
+
+std::size_t NavigationGraph::GetNumClusters() const
+{
+    const std::shared_lock<std::shared_mutex> lock(mutex_);
+
+    std::size_t numClusters = 0;
+    for (const auto& tile : tiles_)
+    {
+        for (const auto& layer : tile.second)
+            numClusters += layer.clusters_.size();
+    }
+
+    return numClusters;
+}
+
+unsigned NavigationGraph::GetNumIslands() const
+{
+    const std::shared_lock<std::shared_mutex> lock(mutex_);
+    return numIslands_;
+}
+
+std::uint64_t NavigationGraph::MakeClusterKey(int x, int y, int layer, unsigned cluster)
+{
+    return (MakeTileKey(x, y, layer) << 16u) | (cluster & 0xffffu);
+}
+
+bool NavigationGraph::GetClusterKey(const TileMap& tiles, const dtNavMesh* navMesh, dtPolyRef ref, std::uint64_t& clusterKey)
+{
+    const dtMeshTile* tile = nullptr;
+    const dtPoly* poly = nullptr;
+    navMesh->getTileAndPolyByRefUnsafe(ref, &tile, &poly);
+    if (!tile || !tile->header)
+        return false;
+
+    const std::uint64_t tileKey = MakeTileKey(tile->header->x, tile->header->y);
+    auto it = tiles.find(tileKey);
+    if (it == tiles.end() || tile->header->layer >= static_cast<int>(it->second.size()))
+        return false;
+
+    const GraphTile& graphTile = it->second[tile->header->layer];
+    const unsigned polyIndex = navMesh->decodePolyIdPoly(ref);
+    if (polyIndex >= graphTile.polyClusters_.size())
+        return false;
+
+    clusterKey = MakeClusterKey(tile->header->x, tile->header->y, tile->header->layer, graphTile.polyClusters_[polyIndex]);
+    return true;
+}
+
+const NavigationGraphCluster* NavigationGraph::GetCluster(const TileMap& tiles, std::uint64_t clusterKey)
+{
+    const std::uint64_t layerKey = clusterKey >> 16u;
+    const Int32Vector2 coords = GetTileKeyCoords(layerKey);
+    auto it = tiles.find(MakeTileKey(coords.x_, coords.y_));
+    if (it == tiles.end())
+        return nullptr;
+
+    const unsigned layer = static_cast<unsigned>(GetTileKeyLayer(layerKey));
+    const unsigned cluster = static_cast<unsigned>(clusterKey & 0xffffu);
+    if (layer >= it->second.size() || cluster >= it->second[layer].clusters_.size())
+        return nullptr;
+
+    return &it->second[layer].clusters_[cluster];
+}
+
+unsigned NavigationGraph::GetIsland(std::uint64_t clusterKey) const
+{
+    const std::uint64_t layerKey = clusterKey >> 16u;
+    const Int32Vector2 coords = GetTileKeyCoords(layerKey);
+    auto it = tiles_.find(MakeTileKey(coords.x_, coords.y_));
+    if (it == tiles_.end())
+        return M_MAX_INT;
+
+    const unsigned layer = static_cast<unsigned>(GetTileKeyLayer(layerKey));
+    const unsigned cluster = static_cast<unsigned>(clusterKey & 0xffffu);
+    if (layer >= it->second.size() || cluster >= it->second[layer].clusterIslands_.size())
+        return M_MAX_INT;
+
+    return it->second[layer].clusterIslands_[cluster];
+}
+
+void NavigationGraph::BuildClusters(TileMap& tiles, const dtNavMesh* navMesh, const dtMeshTile* tile)
+{
+    const dtMeshHeader* header = tile->header;
+    if (!header)
+        return;
+
+    auto& layers = tiles[MakeTileKey(header->x, header->y)];
+    if (static_cast<int>(layers.size()) <= header->layer)
+        layers.resize(header->layer + 1);
+
+    GraphTile& graphTile = layers[header->layer];
+    graphTile.clusters_.clear();
+
+    const int numPolys = header->polyCount;
+    const unsigned tileIndex = navMesh->decodePolyIdTile(navMesh->getPolyRefBase(tile));
+
+    // Polygons linked inside the tile fall into the same cluster
+    std::vector<int> parents(numPolys);
+    std::iota(parents.begin(), parents.end(), 0);
+
+    for (int i = 0; i < numPolys; ++i)
+    {
+        const dtPoly* poly = &tile->polys[i];
+        for (unsigned k = poly->firstLink; k != DT_NULL_LINK; k = tile->links[k].next)
+        {
+            const dtPolyRef ref = tile->links[k].ref;
+            if (!ref || navMesh->decodePolyIdTile(ref) != tileIndex)
+                continue;
+
+            const int a = FindRoot(parents, i);
+            const int b = FindRoot(parents, static_cast<int>(navMesh->decodePolyIdPoly(ref)));
+            if (a != b)
+                parents[b] = a;
+        }
+    }
+
+    std::vector<int> rootClusters(numPolys, -1);
+    std::vector<unsigned> clusterSizes;
+    graphTile.polyClusters_.resize(numPolys);
+
+    for (int i = 0; i < numPolys; ++i)
+    {
+        const int root = FindRoot(parents, i);
+        if (rootClusters[root] < 0)
+        {
+            rootClusters[root] = static_cast<int>(graphTile.clusters_.size());
+            graphTile.clusters_.emplace_back();
+            clusterSizes.push_back(0);
+        }
+
+        const int cluster = rootClusters[root];
+        graphTile.polyClusters_[i] = static_cast<unsigned short>(cluster);
+
+        graphTile.clusters_[cluster].center_ += GetPolyCenter(tile, &tile->polys[i]);
+        ++clusterSizes[cluster];
+    }
+
+    for (std::size_t i = 0; i < graphTile.clusters_.size(); ++i)
+        graphTile.clusters_[i].center_ = graphTile.clusters_[i].center_ * (1.0f / clusterSizes[i]);
+}
+
+void NavigationGraph::BuildEdges(TileMap& tiles, const dtNavMesh* navMesh, const dtMeshTile* tile)
+{
+    const dtMeshHeader* header = tile->header;
+    if (!header)
+        return;
+
+    auto it = tiles.find(MakeTileKey(header->x, header->y));
+    if (it == tiles.end() || header->layer >= static_cast<int>(it->second.size()))
+        return;
+
+    GraphTile& graphTile = it->second[header->layer];
+    for (auto& cluster : graphTile.clusters_)
+        cluster.edges_.clear();
+
+    const dtPolyRef base = navMesh->getPolyRefBase(tile);
+    const unsigned tileIndex = navMesh->decodePolyIdTile(base);
+
+    for (int i = 0; i < header->polyCount; ++i)
+    {
+        const dtPoly* poly = &tile->polys[i];
+        NavigationGraphCluster& cluster = graphTile.clusters_[graphTile.polyClusters_[i]];
+
+        for (unsigned k = poly->firstLink; k != DT_NULL_LINK; k = tile->links[k].next)
+        {
+            const dtLink& link = tile->links[k];
+            if (!link.ref || navMesh->decodePolyIdTile(link.ref) == tileIndex)
+                continue;
+
+            std::uint64_t target;
+            if (!GetClusterKey(tiles, navMesh, link.ref, target))
+                continue;
+
+            const NavigationGraphCluster* targetCluster = GetCluster(tiles, target);
+            if (!targetCluster)
+                continue;
+
+            const dtMeshTile* neighbourTile = nullptr;
+            const dtPoly* neighbourPoly = nullptr;
+            navMesh->getTileAndPolyByRefUnsafe(link.ref, &neighbourTile, &neighbourPoly);
+
+            NavigationGraphEdge edge;
+            edge.target_ = target;
+            edge.fromRef_ = base | static_cast<dtPolyRef>(i);
+            edge.toRef_ = link.ref;
+            edge.portal_ = GetPortalPoint(tile, poly, link, neighbourTile, neighbourPoly, cluster.center_);
+            edge.cost_ = (edge.portal_ - cluster.center_).Length() + (targetCluster->center_ - edge.portal_).Length();
+
+            // Keep the cheapest portal between a pair of clusters
+            auto existing = std::find_if(cluster.edges_.begin(), cluster.edges_.end(), [target](const auto& rhs) { return rhs.target_ == target; });
+            if (existing == cluster.edges_.end())
+                cluster.edges_.push_back(edge);
+            else if (edge.cost_ < existing->cost_)
+                *existing = edge;
+        }
+    }
+}
+
+unsigned NavigationGraph::BuildIslands(TileMap& tiles)
+{
+    // Clusters are numbered consecutively, every tile layer starts at its own base
+    std::unordered_map<std::uint64_t, unsigned> layerBases;
+    unsigned numClusters = 0;
+    for (const auto& tile : tiles)
+    {
+        for (std::size_t layer = 0; layer < tile.second.size(); ++layer)
+        {
+            layerBases[MakeLayerKey(tile.first, layer)] = numClusters;
+            numClusters += static_cast<unsigned>(tile.second[layer].clusters_.size());
+        }
+    }
+
+    std::vector<int> parents(numClusters);
+    std::iota(parents.begin(), parents.end(), 0);
+
+    for (const auto& tile : tiles)
+    {
+        for (std::size_t layer = 0; layer < tile.second.size(); ++layer)
+        {
+            const unsigned base = layerBases[MakeLayerKey(tile.first, layer)];
+            const auto& clusters = tile.second[layer].clusters_;
+            for (std::size_t i = 0; i < clusters.size(); ++i)
+            {
+                for (const auto& edge : clusters[i].edges_)
+                {
+                    auto target = layerBases.find(edge.target_ >> 16u);
+                    if (target == layerBases.end())
+                        continue;
+
+                    const int a = FindRoot(parents, static_cast<int>(base + i));
+                    const int b = FindRoot(parents, static_cast<int>(target->second + (edge.target_ & 0xffffu)));
+                    if (a != b)
+                        parents[b] = a;
+                }
+            }
+        }
+    }
+
+    std::vector<int> rootIslands(numClusters, -1);
+    unsigned numIslands = 0;
+
+    for (auto& tile : tiles)
+    {
+        for (std::size_t layer = 0; layer < tile.second.size(); ++layer)
+        {
+            const unsigned base = layerBases[MakeLayerKey(tile.first, layer)];
+            GraphTile& graphTile = tile.second[layer];
+            graphTile.clusterIslands_.resize(graphTile.clusters_.size());
+
+            for (std::size_t i = 0; i < graphTile.clusters_.size(); ++i)
+            {
+                const int root = FindRoot(parents, static_cast<int>(base + i));
+                if (rootIslands[root] < 0)
+                    rootIslands[root] = static_cast<int>(numIslands++);
+
+                graphTile.clusterIslands_[i] = static_cast<unsigned>(rootIslands[root]);
+            }
+        }
+    }
+
+    return numIslands;
+}
+
+bool NavigationGraph::FindRoute(std::uint64_t startCluster, std::uint64_t endCluster, std::vector<NavigationGraphEdge>& route) const
+{
+    struct SearchNode
+    {
+        // Cost from the start.
+        float cost_;
+        // Previous cluster.
+        std::uint64_t parent_;
+        // Edge from the previous cluster.
+        const NavigationGraphEdge* edge_;
+        // Whether the node is expanded.
+        bool closed_;
+    };
+
+    const NavigationGraphCluster* goal = GetCluster(tiles_, endCluster);
+    const NavigationGraphCluster* origin = GetCluster(tiles_, startCluster);
+    if (!goal || !origin)
+        return false;
+
+    using OpenEntry = std::pair<float, std::uint64_t>;
+    std::priority_queue<OpenEntry, std::vector<OpenEntry>, std::greater<OpenEntry>> open;
+    std::unordered_map<std::uint64_t, SearchNode> nodes;
+
+    nodes[startCluster] = SearchNode{ 0.0f, startCluster, nullptr, false };
+    open.emplace((goal->center_ - origin->center_).Length(), startCluster);
+
+    std::size_t numExpanded = 0;
+    while (!open.empty() && numExpanded < HIERARCHICAL_MAX_NODES)
+    {
+        const std::uint64_t key = open.top().second;
+        open.pop();
+
+        SearchNode& node = nodes[key];
+        if (node.closed_)
+            continue;
+
+        node.closed_ = true;
+        ++numExpanded;
+
+        if (key == endCluster)
+        {
+            route.clear();
+            for (std::uint64_t current = endCluster; current != startCluster; current = nodes[current].parent_)
+                route.push_back(*nodes[current].edge_);
+
+            std::reverse(route.begin(), route.end());
+            return true;
+        }
+
+        const NavigationGraphCluster* cluster = GetCluster(tiles_, key);
+        if (!cluster)
+            continue;
+
+        const float cost = node.cost_;
+        for (const auto& edge : cluster->edges_)
+        {
+            const NavigationGraphCluster* target = GetCluster(tiles_, edge.target_);
+            if (!target)
+                continue;
+
+            const float newCost = cost + edge.cost_;
+            auto [found, inserted] = nodes.try_emplace(edge.target_, SearchNode{ newCost, key, &edge, false });
+            if (!inserted)
+            {
+                if (found->second.closed_ || found->second.cost_ <= newCost)
+                    continue;
+
+                found->second = SearchNode{ newCost, key, &edge, false };
+            }
+
+            open.emplace(newCost + (goal->center_ - target->center_).Length(), edge.target_);
+        }
+    }
+
+    return false;
+}
+
+}
\ No newline at end of file
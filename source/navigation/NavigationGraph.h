@@ -0,0 +1,119 @@
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <shared_mutex>
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "../navigation/NavigationQuery.h"
+#include "../utils/MathUtils.h"
+
+class dtNavMesh;
+class dtQueryFilter;
+struct dtMeshTile;
+
+namespace WorldAssistant
+{
+
+// Connection between clusters of neighbouring tiles.
+struct NavigationGraphEdge
+{
+    // Target cluster.
+    std::uint64_t target_{};
+    // Polygon on this side of the portal.
+    dtPolyRef fromRef_{};
+    // Polygon on the other side of the portal.
+    dtPolyRef toRef_{};
+    // Portal position.
+    Vector3F portal_;
+    // Travel cost through the portal.
+    float cost_{};
+};
+
+// Polygons of a tile layer reachable from each other without leaving the tile.
+struct NavigationGraphCluster
+{
+    // Average position of the polygons.
+    Vector3F center_;
+    // Connections to other tiles.
+    std::vector<NavigationGraphEdge> edges_;
+};
+
+// Abstract graph over tile border portals. Long paths are planned over clusters first and then refined by short polygon searches between portals.
+class NavigationGraph
+{
+public:
+    // Mark the tile and its neighbours for update.
+    void MarkTileDirty(const Int32Vector2& tile);
+    // Rebuild the clusters of dirty tiles. Queries call it on their own, so it is only needed to prepare the graph ahead of time. Safe to call while
+    // other threads query the graph, which keep reading the current graph until the rebuilt one is swapped in.
+    void Update(const dtNavMesh* navMesh);
+    // Remove everything.
+    void Clear();
+
+    // Return whether a path between the polygons is long enough to be planned over the graph.
+    bool IsLongRoute(const dtNavMesh* navMesh, dtPolyRef startRef, dtPolyRef endRef) const;
+    // Find a polygon corridor between the positions over the graph into dest. Return false if the graph could not connect them.
+    bool FindCorridor(NavigationQuery& query, dtPolyRef startRef, dtPolyRef endRef, const Vector3F& start, const Vector3F& end,
+        const dtQueryFilter* filter, std::vector<dtPolyRef>& dest);
+
+    // Return whether the polygons may be connected. Polygons on different islands never are, one-way links are treated as two-way. Unknown polygons, and
+    // any polygons while another thread updates the graph, are reported as connected.
+    bool IsReachable(const dtNavMesh* navMesh, dtPolyRef startRef, dtPolyRef endRef);
+
+    // Return number of clusters.
+    std::size_t GetNumClusters() const;
+    // Return number of islands.
+    unsigned GetNumIslands() const;
+
+private:
+    struct GraphTile
+    {
+        // Clusters of the tile layer.
+        std::vector<NavigationGraphCluster> clusters_;
+        // Cluster of every polygon of the tile layer. Empty if the layer does not exist.
+        std::vector<unsigned short> polyClusters_;
+        // Island of every cluster.
+        std::vector<unsigned> clusterIslands_;
+    };
+
+    // Layers of every tile by tile key.
+    using TileMap = std::unordered_map<std::uint64_t, std::vector<GraphTile>>;
+
+    // Pack tile coordinates, layer and cluster index into a cluster key: the tile key of the layer above 16 bits of cluster index.
+    static std::uint64_t MakeClusterKey(int x, int y, int layer, unsigned cluster);
+    // Find cluster key of the polygon in the tiles. Return false if it is not there.
+    static bool GetClusterKey(const TileMap& tiles, const dtNavMesh* navMesh, dtPolyRef ref, std::uint64_t& clusterKey);
+    // Return cluster of the tiles by its key.
+    static const NavigationGraphCluster* GetCluster(const TileMap& tiles, std::uint64_t clusterKey);
+    // Return island of the cluster. Requires the lock.
+    unsigned GetIsland(std::uint64_t clusterKey) const;
+    // Rebuild the dirty tiles if no other thread is updating the graph, waiting for it if wait is set. Return false if the graph is out of date.
+    bool UpdateTiles(const dtNavMesh* navMesh, bool wait);
+    // Split the tile layer polygons into clusters of the tiles.
+    static void BuildClusters(TileMap& tiles, const dtNavMesh* navMesh, const dtMeshTile* tile);
+    // Connect the tile layer clusters to neighbour tiles.
+    static void BuildEdges(TileMap& tiles, const dtNavMesh* navMesh, const dtMeshTile* tile);
+    // Assign an island to every cluster of the tiles. Return number of islands.
+    static unsigned BuildIslands(TileMap& tiles);
+    // Find a sequence of edges between clusters, copied so they can be used after the lock is released. Return false if there is no route. Requires
+    // the lock.
+    bool FindRoute(std::uint64_t startCluster, std::uint64_t endCluster, std::vector<NavigationGraphEdge>& route) const;
+
+    // Layers of every tile by tile key.
+    TileMap tiles_;
+    // Tiles to rebuild by tile key.
+    std::unordered_set<std::uint64_t> dirtyTiles_;
+    // Number of tile marks, tells an update whether tiles were marked while it ran.
+    std::uint64_t numMarks_{};
+    // Number of islands.
+    unsigned numIslands_{};
+    // Guards the graph and the dirty set. Queries share it, updates hold it exclusively only to swap in the rebuilt graph.
+    mutable std::shared_mutex mutex_;
+    // Lets one update run at a time. Only its holder changes the graph, so it reads the graph without the lock above.
+    std::mutex updateMutex_;
+};
+
+}
\ No newline at end of file
@@ -9,31 +9,49 @@
 #include <DetourNavMeshQuery.h>
 #include <Recast.h>
 
+#include <chrono>
+#include <random>
+
 #include <spdlog/spdlog.h>
+#include "thread_pool/thread_pool.hpp"
 
 namespace WorldAssistant
 {
 
-static const int MAX_POLYS = 2048;
+// Maximum number of sliced requests searched at the same time, each holds a query context.
+static const std::size_t MAX_SLICED_QUERIES = 4;
+// Search iterations given to a sliced request in one turn.
+static const int SLICED_PATH_STEP = 64;
+// Maximum number of polygons settled by a flow field search.
+static const unsigned FLOW_FIELD_MAX_NODES = 65536;
+// Smallest batch of point lookups, raycasts or random samples worth spreading over the workers.
+static const std::size_t QUERY_PARALLEL_BATCH = 64;
+// Number of random paths the landmarks are checked on in debug builds.
+static const unsigned LANDMARK_VERIFY_SAMPLES = 256;
+// Time the tiles must stay unchanged before a dropped landmark table is recomputed.
+static const std::chrono::seconds LANDMARK_REBUILD_DELAY(5);
+
+namespace
+{
 
-// Temporary data for finding a path.
-struct FindPathData
+// Return a random number in [0, 1) for the Detour samplers. Every thread has its own generator.
+float RandomUnit()
 {
-    // Polygons.
-    dtPolyRef polys_[MAX_POLYS]{};
-    // Polygons on the path.
-    dtPolyRef pathPolys_[MAX_POLYS]{};
-    // Points on the path.
-    Vector3F pathPoints_[MAX_POLYS];
-    // Flags on the path.
-    unsigned char pathFlags_[MAX_POLYS]{};
-};
+    thread_local std::minstd_rand generator{ std::random_device{}() };
+    return std::min(std::uniform_real_distribution<float>(0.0f, 1.0f)(generator), 0.99999994f);
+}
+
+}
 
 NavigationMesh::NavigationMesh(World* world) noexcept :
     world_(world),
-    padding_(1.0f, 1.0f, 1.0f),
+    queryPool_(std::make_unique<NavigationQueryPool>(MAX_POLYS)),
+    pathCache_(std::make_unique<PathCache>()),
+    flowFields_(std::make_unique<FlowFieldCache>()),
+    graph_(std::make_unique<NavigationGraph>()),
+    sampler_(std::make_unique<RandomPointSampler>()),
     queryFilter_(new dtQueryFilter()),
-    pathData_(new FindPathData())
+    padding_(1.0f, 1.0f, 1.0f)
 {
 }
 
@@ -43,9 +61,6 @@ NavigationMesh::~NavigationMesh()
 
     delete queryFilter_;
     queryFilter_ = {};
-
-    delete pathData_;
-    pathData_ = {};
 }
 
 bool NavigationMesh::Allocate(const BoundingBox& boundingBox, unsigned maxTiles)
@@ -93,11 +108,15 @@ void NavigationMesh::RemoveTile(const Int32Vector2& tile)
     if (!tileRef)
         return;
 
+    WaitLandmarks();
     navMesh_->removeTile(tileRef, nullptr, nullptr);
+    TileChanged(tile);
 }
 
 void NavigationMesh::RemoveAllTiles()
 {
+    WaitLandmarks();
+
     const dtNavMesh* navMesh = navMesh_;
     for (int i = 0; i < navMesh_->getMaxTiles(); ++i)
     {
@@ -106,6 +125,12 @@ void NavigationMesh::RemoveAllTiles()
         if (tile->header)
             navMesh_->removeTile(navMesh_->getTileRef(tile), nullptr, nullptr);
     }
+
+    pathCache_->Clear();
+    graph_->Clear();
+    flowFields_->Clear();
+    SetLandmarks(nullptr);
+    sampler_->Clear();
 }
 
 bool NavigationMesh::HasTile(const Int32Vector2& tile) const
@@ -117,7 +142,8 @@ bool NavigationMesh::HasTile(const Int32Vector2& tile) const
 
 Vector3F NavigationMesh::FindNearestPoint(const Vector3F& point, const Vector3F& extents, const dtQueryFilter* filter, dtPolyRef* nearestRef)
 {
-    if (!InitializeQuery())
+    NavigationQueryLease query = AcquireQuery();
+    if (!query)
         return point;
 
     Vector3F localPoint = point;
@@ -126,18 +152,51 @@ Vector3F NavigationMesh::FindNearestPoint(const Vector3F& point, const Vector3F&
     dtPolyRef pointRef;
     if (!nearestRef)
         nearestRef = &pointRef;
-    navMeshQuery_->findNearestPoly(&localPoint.x_, &extents.x_, filter ? filter : queryFilter_, nearestRef, &nearestPoint.x_);
+    query->query_->findNearestPoly(&localPoint.x_, &extents.x_, filter ? filter : queryFilter_, nearestRef, &nearestPoint.x_);
     return *nearestRef ? nearestPoint : point;
 }
 
-void NavigationMesh::FindPath(std::vector<Vector3F>& dest, const Vector3F& start, const Vector3F& end, const Vector3F& extents, const dtQueryFilter* filter)
+void NavigationMesh::FindNearestPoints(std::vector<Vector3F>& dest, std::vector<dtPolyRef>& destRefs, const std::vector<Vector3F>& points,
+    const Vector3F& extents, thread_pool* workers, const dtQueryFilter* filter)
 {
-    std::vector<NavigationPathPoint> navPathPoints;
-    FindPath(navPathPoints, start, end, extents, filter);
+    dest.resize(points.size());
+    destRefs.resize(points.size());
 
+    const dtQueryFilter* queryFilter = filter ? filter : queryFilter_;
+    const auto solveRange = [this, &dest, &destRefs, &points, &extents, queryFilter](std::size_t first, std::size_t last) {
+        NavigationQueryLease query = AcquireQuery();
+
+        for (std::size_t i = first; i < last; ++i)
+        {
+            dest[i] = points[i];
+            destRefs[i] = 0;
+            if (!query)
+                continue;
+
+            Vector3F nearestPoint;
+            query->query_->findNearestPoly(&points[i].x_, &extents.x_, queryFilter, &destRefs[i], &nearestPoint.x_);
+            if (destRefs[i])
+                dest[i] = nearestPoint;
+        }
+    };
+
+    // A nearest polygon lookup is cheap, small batches stay on the calling thread
+    if (workers && points.size() >= QUERY_PARALLEL_BATCH)
+        workers->parallelize_loop(std::size_t(0), points.size(), solveRange);
+    else
+        solveRange(0, points.size());
+}
+
+void NavigationMesh::FindPath(std::vector<Vector3F>& dest, const Vector3F& start, const Vector3F& end, const Vector3F& extents, const dtQueryFilter* filter)
+{
     dest.clear();
-    for (unsigned i = 0; i < navPathPoints.size(); ++i)
-        dest.push_back(navPathPoints[i].position_);
+
+    NavigationQueryLease query = AcquireQuery();
+    if (!query)
+        return;
+
+    const int numPathPoints = FindStraightPath(*query, start, end, extents, filter);
+    dest.assign(query->pathData_.pathPoints_, query->pathData_.pathPoints_ + numPathPoints);
 }
 
 void NavigationMesh::FindPath(std::vector<NavigationPathPoint>& dest, const Vector3F& start, const Vector3F& end, const Vector3F& extents, const dtQueryFilter* filter)
@@ -147,53 +206,53 @@ void NavigationMesh::FindPath(std::vector<NavigationPathPoint>& dest, const Vect
 
     dest.clear();
 
-    if (!InitializeQuery())
+    NavigationQueryLease query = AcquireQuery();
+    if (!query)
         return;
 
-    Vector3F localStart = start;
-    Vector3F localEnd = end;
-
-    const dtQueryFilter* queryFilter = filter ? filter : queryFilter_;
-    dtPolyRef startRef;
-    dtPolyRef endRef;
-    navMeshQuery_->findNearestPoly(&localStart.x_, &extents.x_, queryFilter, &startRef, nullptr);
-    navMeshQuery_->findNearestPoly(&localEnd.x_, &extents.x_, queryFilter, &endRef, nullptr);
-
-    if (!startRef || !endRef)
+    FindPathData* pathData = &query->pathData_;
+    const int numPathPoints = FindStraightPath(*query, start, end, extents, filter);
+    if (!numPathPoints)
         return;
 
-    int numPolys = 0;
-    int numPathPoints = 0;
-
-    navMeshQuery_->findPath(startRef, endRef, &localStart.x_, &localEnd.x_, queryFilter, pathData_->polys_, &numPolys,
-        MAX_POLYS);
-    if (!numPolys)
-        return;
+    // Volumes added after the build are not marked on the polygons, they are looked up around the path
+    BoundingBox pathBounds;
+    for (int i = 0; i < numPathPoints; ++i)
+        pathBounds.Merge(pathData->pathPoints_[i]);
 
-    Vector3F actualLocalEnd = localEnd;
+    std::vector<const NavArea*> areas;
+    scene->QueryNavAreas(pathBounds, areas);
 
-    // If full path was not found, clamp end point to the end polygon
-    if (pathData_->polys_[numPolys - 1] != endRef)
-        navMeshQuery_->closestPointOnPoly(pathData_->polys_[numPolys - 1], &localEnd.x_, &actualLocalEnd.x_, nullptr);
-
-    navMeshQuery_->findStraightPath(&localStart.x_, &actualLocalEnd.x_, pathData_->polys_, numPolys,
-        &pathData_->pathPoints_[0].x_, pathData_->pathFlags_, pathData_->pathPolys_, &numPathPoints, MAX_POLYS);
+    dest.reserve(numPathPoints);
 
     // Transform path result back to world space
     for (int i = 0; i < numPathPoints; ++i)
     {
         NavigationPathPoint pt;
-        pt.position_ = pathData_->pathPoints_[i];
-        pt.flag_ = (NavigationPathPointFlag)pathData_->pathFlags_[i];
+        pt.position_ = pathData->pathPoints_[i];
+        pt.flag_ = (NavigationPathPointFlag)pathData->pathFlags_[i];
+
+        // The end point carries no polygon, it lies on the previous one
+        dtPolyRef polyRef = pathData->pathPolys_[i];
+        if (!polyRef && i > 0)
+            polyRef = pathData->pathPolys_[i - 1];
+
+        unsigned char polyArea = RC_WALKABLE_AREA;
+        if (polyRef)
+            navMesh_->getPolyArea(polyRef, &polyArea);
 
-        // Walk through all NavAreas and find nearest
         unsigned nearestNavAreaID = 0;       // 0 is the default nav area ID
-        float nearestDistance = M_LARGE_VALUE;
 
-        for (const auto& area : scene->GetNavAreas()) {
-            if (area && area->IsEnabled())
+        if (polyArea != RC_WALKABLE_AREA)
+            nearestNavAreaID = polyArea;
+        else
+        {
+            // Walk through nearby NavAreas and find nearest
+            float nearestDistance = M_LARGE_VALUE;
+
+            for (const NavArea* area : areas)
             {
-                BoundingBox bb = area->GetBoundingBox();
+                const BoundingBox& bb = area->GetBoundingBox();
                 if (bb.IsInside(pt.position_) == INSIDE)
                 {
                     Vector3F areaWorldCenter = bb.Center();
@@ -212,6 +271,366 @@ void NavigationMesh::FindPath(std::vector<NavigationPathPoint>& dest, const Vect
     }
 }
 
+bool NavigationMesh::FindFlowFieldStep(const Vector3F& goal, const Vector3F& position, const Vector3F& extents, Vector3F& waypoint, float* distance,
+    const dtQueryFilter* filter)
+{
+    NavigationQueryLease query = AcquireQuery();
+    if (!query)
+        return false;
+
+    const dtQueryFilter* queryFilter = filter ? filter : queryFilter_;
+    dtPolyRef goalRef;
+    dtPolyRef positionRef;
+    Vector3F nearestGoal;
+    query->query_->findNearestPoly(&goal.x_, &extents.x_, queryFilter, &goalRef, &nearestGoal.x_);
+    query->query_->findNearestPoly(&position.x_, &extents.x_, queryFilter, &positionRef, nullptr);
+
+    if (!goalRef || !positionRef)
+        return false;
+
+    std::shared_ptr<const FlowField> field = flowFields_->Find(goalRef, queryFilter);
+    if (!field)
+    {
+        auto newField = std::make_shared<FlowField>();
+        if (!newField->Build(navMesh_, queryFilter, goalRef, nearestGoal, flowFieldDistance_, FLOW_FIELD_MAX_NODES))
+            return false;
+
+        field = newField;
+        flowFields_->Insert(queryFilter, std::move(newField));
+    }
+
+    const FlowFieldNode* node = field->Find(positionRef);
+    if (!node)
+        return false;
+
+    // Within the goal polygon the goal itself is next, it may have moved since the field was built
+    waypoint = positionRef == goalRef ? nearestGoal : node->waypoint_;
+    if (distance)
+        *distance = positionRef == goalRef ? (nearestGoal - position).Length() : node->distance_;
+
+    return true;
+}
+
+bool NavigationMesh::FindRandomPoints(std::vector<Vector3F>& dest, std::vector<dtPolyRef>& destRefs, unsigned count, thread_pool* workers)
+{
+    dest.clear();
+    destRefs.clear();
+    if (!navMesh_)
+        return false;
+
+    sampler_->Update(navMesh_, queryFilter_);
+    if (sampler_->GetTotalArea() <= 0.0f)
+        return false;
+
+    dest.resize(count);
+    destRefs.resize(count);
+
+    const auto sampleRange = [this, &dest, &destRefs](std::size_t first, std::size_t last) {
+        NavigationQueryLease query = AcquireQuery();
+        if (!query)
+            return;
+
+        for (std::size_t i = first; i < last; ++i)
+            sampler_->Sample(*query, RandomUnit, destRefs[i], dest[i]);
+    };
+
+    if (workers && count >= QUERY_PARALLEL_BATCH)
+        workers->parallelize_loop(std::size_t(0), std::size_t(count), sampleRange);
+    else
+        sampleRange(0, count);
+
+    return true;
+}
+
+void NavigationMesh::FindRandomPointsAroundCircle(std::vector<Vector3F>& dest, std::vector<dtPolyRef>& destRefs, const std::vector<Vector3F>& centers,
+    float radius, const Vector3F& extents, thread_pool* workers, const dtQueryFilter* filter)
+{
+    dest = centers;
+    destRefs.assign(centers.size(), 0);
+
+    const dtQueryFilter* queryFilter = filter ? filter : queryFilter_;
+    const auto sampleRange = [this, &dest, &destRefs, &centers, radius, &extents, queryFilter](std::size_t first, std::size_t last) {
+        NavigationQueryLease query = AcquireQuery();
+        if (!query)
+            return;
+
+        for (std::size_t i = first; i < last; ++i)
+        {
+            dtPolyRef centerRef;
+            Vector3F center;
+            query->query_->findNearestPoly(&centers[i].x_, &extents.x_, queryFilter, &centerRef, &center.x_);
+            if (!centerRef)
+                continue;
+
+            Vector3F point;
+            dtPolyRef pointRef;
+            if (dtStatusSucceed(query->query_->findRandomPointAroundCircle(centerRef, &center.x_, radius, queryFilter, RandomUnit, &pointRef, &point.x_)))
+            {
+                dest[i] = point;
+                destRefs[i] = pointRef;
+            }
+        }
+    };
+
+    if (workers && centers.size() >= QUERY_PARALLEL_BATCH)
+        workers->parallelize_loop(std::size_t(0), centers.size(), sampleRange);
+    else
+        sampleRange(0, centers.size());
+}
+
+bool NavigationMesh::IsReachable(const Vector3F& start, const Vector3F& end, const Vector3F& extents, const dtQueryFilter* filter)
+{
+    NavigationQueryLease query = AcquireQuery();
+    if (!query)
+        return false;
+
+    const dtQueryFilter* queryFilter = filter ? filter : queryFilter_;
+    dtPolyRef startRef;
+    dtPolyRef endRef;
+    query->query_->findNearestPoly(&start.x_, &extents.x_, queryFilter, &startRef, nullptr);
+    query->query_->findNearestPoly(&end.x_, &extents.x_, queryFilter, &endRef, nullptr);
+
+    if (!startRef || !endRef)
+        return false;
+
+    return graph_->IsReachable(navMesh_, startRef, endRef);
+}
+
+bool NavigationMesh::Raycast(NavigationRaycastResult& dest, const Vector3F& start, const Vector3F& end, const Vector3F& extents, const dtQueryFilter* filter)
+{
+    dest = NavigationRaycastResult{ false, 0.0f, start, {} };
+
+    NavigationQueryLease query = AcquireQuery();
+    if (!query)
+        return false;
+
+    return Raycast(*query, dest, start, end, extents, filter);
+}
+
+void NavigationMesh::Raycasts(std::vector<NavigationRaycastResult>& dest, const std::vector<NavigationPathRequest>& requests, const Vector3F& extents,
+    thread_pool* workers, const dtQueryFilter* filter)
+{
+    dest.resize(requests.size());
+
+    const auto solveRange = [this, &dest, &requests, &extents, filter](std::size_t first, std::size_t last) {
+        NavigationQueryLease query = AcquireQuery();
+
+        for (std::size_t i = first; i < last; ++i)
+        {
+            dest[i] = NavigationRaycastResult{ false, 0.0f, requests[i].start_, {} };
+            if (query)
+                Raycast(*query, dest[i], requests[i].start_, requests[i].end_, extents, filter);
+        }
+    };
+
+    // A raycast is cheap, small batches stay on the calling thread
+    if (workers && requests.size() >= QUERY_PARALLEL_BATCH)
+        workers->parallelize_loop(std::size_t(0), requests.size(), solveRange);
+    else
+        solveRange(0, requests.size());
+}
+
+void NavigationMesh::FindPaths(std::vector<std::vector<Vector3F>>& dest, const std::vector<NavigationPathRequest>& requests, const Vector3F& extents,
+    thread_pool* workers, const dtQueryFilter* filter)
+{
+    // Keep the inner vectors, their capacity is reused by the next batch
+    dest.resize(requests.size());
+
+    const auto solveRange = [this, &dest, &requests, &extents, filter](std::size_t first, std::size_t last) {
+        NavigationQueryLease query = AcquireQuery();
+
+        for (std::size_t i = first; i < last; ++i)
+        {
+            dest[i].clear();
+            if (!query)
+                continue;
+
+            const FindPathData& pathData = query->pathData_;
+            const int numPathPoints = FindStraightPath(*query, requests[i].start_, requests[i].end_, extents, filter);
+            dest[i].insert(dest[i].end(), pathData.pathPoints_, pathData.pathPoints_ + numPathPoints);
+        }
+    };
+
+    // Small batches are not worth the scheduling
+    if (workers && requests.size() > 1)
+        workers->parallelize_loop(std::size_t(0), requests.size(), solveRange);
+    else
+        solveRange(0, requests.size());
+}
+
+void NavigationMesh::FindPathSliced(unsigned id, const Vector3F& start, const Vector3F& end, const Vector3F& extents, const dtQueryFilter* filter)
+{
+    SlicedPathRequest request;
+    request.id_ = id;
+    request.start_ = start;
+    request.end_ = end;
+    request.extents_ = extents;
+    request.filter_ = filter;
+    slicedPaths_.push_back(std::move(request));
+}
+
+void NavigationMesh::UpdateSlicedPaths(std::vector<PathResult>& dest, unsigned maxIterations, unsigned maxMicroseconds)
+{
+    for (auto& result : slicedResults_)
+        dest.push_back(std::move(result));
+
+    slicedResults_.clear();
+
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::microseconds(maxMicroseconds);
+    int iterationsLeft = maxIterations ? static_cast<int>(std::min(maxIterations, static_cast<unsigned>(M_MAX_INT))) : M_MAX_INT;
+
+    // Active requests take turns so a long search does not hold back the short ones
+    while (!slicedPaths_.empty() && iterationsLeft > 0)
+    {
+        std::size_t index = 0;
+        while (index < std::min(slicedPaths_.size(), MAX_SLICED_QUERIES) && iterationsLeft > 0)
+        {
+            SlicedPathRequest& request = slicedPaths_[index];
+
+            bool finished;
+            if (!request.query_ && request.numPathPoints_ < 0)
+            {
+                finished = BeginSlicedPath(request);
+                --iterationsLeft;
+            }
+            else
+            {
+                int doneIterations = 0;
+                const dtStatus status = request.query_->query_->updateSlicedFindPath(std::min(iterationsLeft, SLICED_PATH_STEP), &doneIterations);
+                finished = !dtStatusInProgress(status);
+                iterationsLeft -= std::max(doneIterations, 1);
+            }
+
+            if (finished)
+            {
+                dest.push_back(EndSlicedPath(request));
+                slicedPaths_.erase(slicedPaths_.begin() + index);
+            }
+            else
+                ++index;
+
+            if (maxMicroseconds && std::chrono::steady_clock::now() >= deadline)
+                return;
+        }
+    }
+}
+
+void NavigationMesh::TileChanged(const Int32Vector2& tile)
+{
+    pathCache_->InvalidateTile(tile);
+    graph_->MarkTileDirty(tile);
+    sampler_->MarkTileDirty(tile);
+    flowFields_->Clear();
+
+    // A rebuilt tile may open a shortcut the distances do not know of, and its polygons no longer match the stored ones
+    if (GetLandmarks())
+        SetLandmarks(nullptr);
+
+    ++tileVersion_;
+    landmarksChanged_ = std::chrono::steady_clock::now();
+}
+
+void NavigationMesh::UpdateGraph()
+{
+    graph_->Update(navMesh_);
+}
+
+void NavigationMesh::UpdateLandmarks(thread_pool* workers, bool settle)
+{
+    // A table computed over tiles that changed meanwhile may miss their shortcuts and no longer matches their polygons
+    if (landmarksJob_.valid())
+    {
+        if (settle && landmarksJob_.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+            return;
+
+        std::shared_ptr<LandmarkTable> landmarks = landmarksJob_.get();
+        if (landmarks && landmarksJobVersion_ == tileVersion_ && navMesh_ && numLandmarks_ && !GetLandmarks())
+            AcceptLandmarks(std::move(landmarks));
+    }
+
+    if (!navMesh_ || !numLandmarks_ || GetLandmarks())
+    {
+        landmarksChanged_ = {};
+        return;
+    }
+
+    // Tiles changing one after another, e.g. under moving obstacles, would recompute the table over and over
+    if (settle && (landmarksChanged_ == std::chrono::steady_clock::time_point() ||
+        std::chrono::steady_clock::now() - landmarksChanged_ < LANDMARK_REBUILD_DELAY))
+        return;
+
+    landmarksChanged_ = {};
+
+    // Searches keep using the straight line heuristic until the new table is swapped in. The server thread must not wait for the landmark searches
+    // over the whole navigation mesh, nor take the workers from the queries
+    if (settle)
+    {
+        const dtNavMesh* navMesh = navMesh_;
+        const unsigned numLandmarks = numLandmarks_;
+        landmarksJobVersion_ = tileVersion_;
+        landmarksJob_ = std::async(std::launch::async, [navMesh, numLandmarks]() -> std::shared_ptr<LandmarkTable> {
+            auto landmarks = std::make_shared<LandmarkTable>();
+            if (!landmarks->Build(navMesh, numLandmarks))
+                return nullptr;
+
+            return landmarks;
+        });
+        return;
+    }
+
+    auto landmarks = std::make_shared<LandmarkTable>();
+    if (!landmarks->Build(navMesh_, numLandmarks_, workers))
+        return;
+
+    AcceptLandmarks(std::move(landmarks));
+}
+
+void NavigationMesh::WaitLandmarks()
+{
+    if (landmarksJob_.valid())
+        landmarksJob_.wait();
+}
+
+void NavigationMesh::AcceptLandmarks(std::shared_ptr<LandmarkTable> landmarks)
+{
+#ifdef DEBUG
+    // Landmark paths must be as short as the Detour ones
+    {
+        NavigationQueryLease query = AcquireQuery();
+        if (query)
+            landmarks->Verify(*query, navMesh_, queryFilter_, RandomUnit, LANDMARK_VERIFY_SAMPLES);
+    }
+#endif
+
+    SetLandmarks(std::move(landmarks));
+}
+
+std::shared_ptr<const LandmarkTable> NavigationMesh::GetLandmarks() const
+{
+    std::lock_guard<std::mutex> lock(landmarksMutex_);
+    return landmarks_;
+}
+
+void NavigationMesh::SetLandmarks(std::shared_ptr<const LandmarkTable> landmarks)
+{
+    std::lock_guard<std::mutex> lock(landmarksMutex_);
+    landmarks_ = std::move(landmarks);
+}
+
+void NavigationMesh::SetProfile(const NavigationProfile& profile)
+{
+    profileName_ = profile.name_;
+    agentRadius_ = profile.agentRadius_;
+    agentHeight_ = profile.agentHeight_;
+    agentMaxClimb_ = profile.agentMaxClimb_;
+    agentMaxSlope_ = profile.agentMaxSlope_;
+}
+
+NavigationProfile NavigationMesh::GetProfile() const
+{
+    return NavigationProfile{ profileName_, agentRadius_, agentHeight_, agentMaxClimb_, agentMaxSlope_ };
+}
+
 BoundingBox NavigationMesh::GetTileBoundingBox(const Int32Vector2& tile) const
 {
     const float tileEdgeLength = (float)tileSize_ * cellSize_;
@@ -243,6 +662,9 @@ void NavigationMesh::GetTileGeometry(NavBuildData* build, BoundingBox& box)
 	scene->Query(&box.min_.x_, result);
 
     for (const auto& node : result) {
+        if (node->GetInterior() != interior_)
+            continue;
+
         auto* collision = world_->GetModelCollision(node->GetModel());
 		if (!collision || collision->Empty()) {
 			spdlog::warn("Could not find a collision for model {}", node->GetModel());
@@ -251,40 +673,238 @@ void NavigationMesh::GetTileGeometry(NavBuildData* build, BoundingBox& box)
 
 		collision->Unpack(build->vertices_, build->indices_, node->GetTransform(), static_cast<std::int32_t>(build->vertices_.size()));
     }
+
+    GetTileAreas(build, box);
 }
 
-bool NavigationMesh::InitializeQuery()
+void NavigationMesh::GetTileAreas(NavBuildData* build, const BoundingBox& box) const
 {
-    if (!navMesh_)
+    Scene* scene = world_->GetScene();
+    assert(scene);
+
+    // Area volumes are marked on the polygons, so path queries can read the area straight from them
+    std::vector<const NavArea*> areas;
+    scene->QueryNavAreas(box, areas);
+
+    for (const NavArea* area : areas)
+        build->navAreas_.push_back(NavAreaStub{ area->GetBoundingBox(), static_cast<unsigned char>(area->GetAreaID()) });
+}
+
+int NavigationMesh::FindStraightPath(NavigationQuery& query, const Vector3F& start, const Vector3F& end, const Vector3F& extents, const dtQueryFilter* filter) const
+{
+    dtNavMeshQuery* navMeshQuery = query.query_;
+
+    Vector3F localStart = start;
+    Vector3F localEnd = end;
+
+    // Tiles rebuilt from here on keep the corridor out of the cache
+    const std::uint64_t cacheGeneration = pathCache_->GetGeneration();
+
+    const dtQueryFilter* queryFilter = filter ? filter : queryFilter_;
+    dtPolyRef startRef;
+    dtPolyRef endRef;
+    navMeshQuery->findNearestPoly(&localStart.x_, &extents.x_, queryFilter, &startRef, nullptr);
+    navMeshQuery->findNearestPoly(&localEnd.x_, &extents.x_, queryFilter, &endRef, nullptr);
+
+    // Disconnected points would make the search exhaust the whole island of the start
+    if (!startRef || !endRef || !graph_->IsReachable(navMesh_, startRef, endRef))
+        return 0;
+
+    // Cached corridors are shared by nearby positions, the path is straightened between the exact ones
+    const PathCacheKey cacheKey = pathCache_->MakeKey(startRef, endRef, localStart, localEnd, queryFilter);
+    const int numCachedPolys = pathCache_->Find(cacheKey, navMesh_, query.corridor_);
+    if (numCachedPolys > 0)
+        return FinishStraightPath(query, localStart, localEnd, endRef, query.corridor_.data(), numCachedPolys);
+
+    const dtPolyRef* corridor = nullptr;
+    const int numPolys = FindCorridor(query, startRef, endRef, localStart, localEnd, queryFilter, corridor);
+    pathCache_->Insert(cacheKey, cacheGeneration, navMesh_, corridor, numPolys);
+
+    return FinishStraightPath(query, localStart, localEnd, endRef, corridor, numPolys);
+}
+
+int NavigationMesh::FindCorridor(NavigationQuery& query, dtPolyRef startRef, dtPolyRef endRef, const Vector3F& start, const Vector3F& end,
+    const dtQueryFilter* filter, const dtPolyRef*& corridor) const
+{
+    // Long paths are planned over the navigation graph and refined between its portals
+    if (hierarchicalPaths_ && graph_->IsLongRoute(navMesh_, startRef, endRef) &&
+        graph_->FindCorridor(query, startRef, endRef, start, end, filter, query.corridor_))
+    {
+        corridor = query.corridor_.data();
+        return static_cast<int>(query.corridor_.size());
+    }
+
+    FindPathData* pathData = &query.pathData_;
+    int numPolys = 0;
+
+    const std::shared_ptr<const LandmarkTable> landmarks = GetLandmarks();
+    if (landmarks)
+        numPolys = landmarks->FindPath(query, navMesh_, startRef, endRef, start, end, filter, pathData->polys_, MAX_POLYS);
+    else
+        query.query_->findPath(startRef, endRef, &start.x_, &end.x_, filter, pathData->polys_, &numPolys, MAX_POLYS);
+
+    corridor = pathData->polys_;
+    return numPolys;
+}
+
+int NavigationMesh::FinishStraightPath(NavigationQuery& query, const Vector3F& start, const Vector3F& end, dtPolyRef endRef, const dtPolyRef* corridor,
+    int numPolys) const
+{
+    dtNavMeshQuery* navMeshQuery = query.query_;
+    FindPathData* pathData = &query.pathData_;
+
+    if (!numPolys)
+        return 0;
+
+    Vector3F localStart = start;
+    Vector3F localEnd = end;
+    Vector3F actualLocalEnd = localEnd;
+
+    // If full path was not found, clamp end point to the end polygon
+    if (corridor[numPolys - 1] != endRef)
+        navMeshQuery->closestPointOnPoly(corridor[numPolys - 1], &localEnd.x_, &actualLocalEnd.x_, nullptr);
+
+    int numPathPoints = 0;
+    navMeshQuery->findStraightPath(&localStart.x_, &actualLocalEnd.x_, corridor, numPolys,
+        &pathData->pathPoints_[0].x_, pathData->pathFlags_, pathData->pathPolys_, &numPathPoints, MAX_POLYS);
+
+    return numPathPoints;
+}
+
+bool NavigationMesh::Raycast(NavigationQuery& query, NavigationRaycastResult& dest, const Vector3F& start, const Vector3F& end, const Vector3F& extents,
+    const dtQueryFilter* filter) const
+{
+    dtNavMeshQuery* navMeshQuery = query.query_;
+    FindPathData* pathData = &query.pathData_;
+
+    const dtQueryFilter* queryFilter = filter ? filter : queryFilter_;
+    dtPolyRef startRef;
+    Vector3F localStart;
+    navMeshQuery->findNearestPoly(&start.x_, &extents.x_, queryFilter, &startRef, &localStart.x_);
+    if (!startRef)
+        return false;
+
+    float fraction;
+    Vector3F normal;
+    int numPolys = 0;
+    if (dtStatusFailed(navMeshQuery->raycast(startRef, &localStart.x_, &end.x_, queryFilter, &fraction, &normal.x_, pathData->polys_, &numPolys, MAX_POLYS)) ||
+        !numPolys)
+    {
+        dest.position_ = localStart;
         return false;
+    }
+
+    const bool reachedEnd = fraction == FLT_MAX;
+    dest.fraction_ = reachedEnd ? 1.0f : fraction;
+    dest.position_ = localStart + (end - localStart) * dest.fraction_;
+    dest.normal_ = reachedEnd ? Vector3F() : normal;
+
+    // The line is traced in the horizontal plane, the end must also lie on the floor the line arrives at
+    float height;
+    const bool onSurface = dtStatusSucceed(navMeshQuery->getPolyHeight(pathData->polys_[numPolys - 1], &dest.position_.x_, &height));
+    if (onSurface)
+        dest.position_.y_ = height;
 
-    if (navMeshQuery_)
+    dest.walkable_ = reachedEnd && onSurface && std::abs(height - end.y_) <= extents.y_;
+    return dest.walkable_;
+}
+
+bool NavigationMesh::BeginSlicedPath(SlicedPathRequest& request)
+{
+    request.query_ = AcquireQuery();
+    if (!request.query_)
+    {
+        request.numPathPoints_ = 0;
         return true;
+    }
 
-    navMeshQuery_ = dtAllocNavMeshQuery();
-    if (!navMeshQuery_)
+    dtNavMeshQuery* navMeshQuery = request.query_->query_;
+    const dtQueryFilter* queryFilter = request.filter_ ? request.filter_ : queryFilter_;
+    request.cacheGeneration_ = pathCache_->GetGeneration();
+
+    dtPolyRef startRef;
+    navMeshQuery->findNearestPoly(&request.start_.x_, &request.extents_.x_, queryFilter, &startRef, nullptr);
+    navMeshQuery->findNearestPoly(&request.end_.x_, &request.extents_.x_, queryFilter, &request.endRef_, nullptr);
+
+    if (!startRef || !request.endRef_ || !graph_->IsReachable(navMesh_, startRef, request.endRef_))
     {
-        spdlog::error("Could not create navigation mesh query");
-        return false;
+        request.numPathPoints_ = 0;
+        return true;
     }
 
-    if (dtStatusFailed(navMeshQuery_->init(navMesh_, MAX_POLYS)))
+    request.cacheKey_ = pathCache_->MakeKey(startRef, request.endRef_, request.start_, request.end_, queryFilter);
+    std::vector<dtPolyRef>& corridor = request.query_->corridor_;
+    const int numCachedPolys = pathCache_->Find(request.cacheKey_, navMesh_, corridor);
+    if (numCachedPolys > 0)
     {
-        spdlog::error("Could not init navigation mesh query");
-        return false;
+        request.numPathPoints_ = FinishStraightPath(*request.query_, request.start_, request.end_, request.endRef_, corridor.data(), numCachedPolys);
+        return true;
     }
 
-    return true;
+    const dtStatus status = navMeshQuery->initSlicedFindPath(startRef, request.endRef_, &request.start_.x_, &request.end_.x_, queryFilter);
+    if (dtStatusFailed(status))
+    {
+        request.numPathPoints_ = 0;
+        return true;
+    }
+
+    return !dtStatusInProgress(status);
+}
+
+PathResult NavigationMesh::EndSlicedPath(SlicedPathRequest& request)
+{
+    PathResult result{ request.id_, {} };
+    if (!request.query_)
+        return result;
+
+    int numPathPoints = request.numPathPoints_;
+    if (numPathPoints < 0)
+    {
+        int numPolys = 0;
+        const dtPolyRef* corridor = request.query_->pathData_.polys_;
+        request.query_->query_->finalizeSlicedFindPath(request.query_->pathData_.polys_, &numPolys, MAX_POLYS);
+        pathCache_->Insert(request.cacheKey_, request.cacheGeneration_, navMesh_, corridor, numPolys);
+        numPathPoints = FinishStraightPath(*request.query_, request.start_, request.end_, request.endRef_, corridor, numPolys);
+    }
+
+    const FindPathData& pathData = request.query_->pathData_;
+    result.path_.assign(pathData.pathPoints_, pathData.pathPoints_ + numPathPoints);
+
+    // Give the context back for the next request
+    request.query_ = {};
+    return result;
+}
+
+NavigationQueryLease NavigationMesh::AcquireQuery() const
+{
+    return queryPool_->Acquire(navMesh_);
 }
 
 void NavigationMesh::ReleaseNavigationMesh()
 {
+    // The background landmark table refers to the old navigation mesh
+    if (landmarksJob_.valid())
+        landmarksJob_.get();
+
+    // Contexts still leased by other threads are dropped when they come back
+    queryPool_->Invalidate();
+
+    // Sliced searches refer to the old navigation mesh, they are reported as failed
+    for (auto& request : slicedPaths_)
+        slicedResults_.push_back(PathResult{ request.id_, {} });
+
+    slicedPaths_.clear();
+
+    // Polygon references of the next navigation mesh may repeat the current ones
+    pathCache_->Clear();
+    graph_->Clear();
+    flowFields_->Clear();
+    SetLandmarks(nullptr);
+    sampler_->Clear();
+
     dtFreeNavMesh(navMesh_);
     navMesh_ = nullptr;
 
-    dtFreeNavMeshQuery(navMeshQuery_);
-    navMeshQuery_ = nullptr;
-
     numTilesX_ = 0;
     numTilesZ_ = 0;
     boundingBox_.Clear();
@@ -1,18 +1,24 @@
 #pragma once
 
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <deque>
+#include <future>
+#include <string>
 #include <vector>
 
+#include "../navigation/FlowField.h"
+#include "../navigation/LandmarkTable.h"
+#include "../navigation/NavigationGraph.h"
+#include "../navigation/NavigationQuery.h"
+#include "../navigation/PathCache.h"
+#include "../navigation/RandomPointSampler.h"
 #include "../utils/MathUtils.h"
 
-#ifdef DT_POLYREF64
-using dtPolyRef = uint64_t;
-#else
-using dtPolyRef = unsigned int;
-#endif
-
 class dtNavMesh;
-class dtNavMeshQuery;
 class dtQueryFilter;
+class thread_pool;
 
 namespace WorldAssistant
 {
@@ -20,7 +26,6 @@ namespace WorldAssistant
 class World;
 class Scene;
 struct NavBuildData;
-struct FindPathData;
 
 enum NavmeshPartitionType
 {
@@ -37,6 +42,77 @@ enum NavigationPathPointFlag
     NAVPATHFLAG_OFF_MESH = 0x04
 };
 
+// Agent dimensions a navigation mesh is built for.
+struct NavigationProfile
+{
+    // Profile name.
+    std::string name_;
+    // Agent radius, the walkable area keeps this far from walls.
+    float agentRadius_{0.6f};
+    // Agent height, lower openings are not walkable.
+    float agentHeight_{2.0f};
+    // Highest ledge the agent steps over.
+    float agentMaxClimb_{0.4f};
+    // Steepest walkable slope in degrees.
+    float agentMaxSlope_{45.0f};
+};
+
+// Start and end of a path in a batch.
+struct NavigationPathRequest
+{
+    // World-space start position.
+    Vector3F start_;
+    // World-space end position.
+    Vector3F end_;
+};
+
+// Result of a walkability test along a straight line.
+struct NavigationRaycastResult
+{
+    // Whether the end can be walked to in a straight line.
+    bool walkable_{};
+    // Fraction of the line walked before hitting the navigation mesh border, 1 if the end was reached.
+    float fraction_{};
+    // Furthest point reached.
+    Vector3F position_;
+    // Normal of the border hit, zero if the end was reached.
+    Vector3F normal_;
+};
+
+// Solved path request.
+struct PathResult
+{
+    // Request ID given by the caller.
+    unsigned id_{};
+    // Path points, empty if no path was found.
+    std::vector<Vector3F> path_;
+};
+
+// Path request advanced a few search iterations at a time.
+struct SlicedPathRequest
+{
+    // Request ID given by the caller.
+    unsigned id_{};
+    // World-space start position.
+    Vector3F start_;
+    // World-space end position.
+    Vector3F end_;
+    // Search extents.
+    Vector3F extents_;
+    // Query filter.
+    const dtQueryFilter* filter_{};
+    // Query context holding the search state, leased when the search starts.
+    NavigationQueryLease query_;
+    // End polygon.
+    dtPolyRef endRef_{};
+    // Path cache key.
+    PathCacheKey cacheKey_;
+    // Path cache generation the search started at.
+    std::uint64_t cacheGeneration_{};
+    // Number of path points in the scratch buffers once known without finalizing the search, otherwise -1.
+    int numPathPoints_{-1};
+};
+
 struct NavigationPathPoint
 {
     // World-space position of the path point.
@@ -47,8 +123,11 @@ struct NavigationPathPoint
     unsigned char areaID_;
 };
 
+// Queries (FindNearestPoint, FindPath) lease their own query context and may run on several threads at once, provided no thread modifies the navigation mesh meanwhile.
 class NavigationMesh
 {
+    friend class Crowd;
+
 public:
     explicit NavigationMesh(World* world) noexcept;
 
@@ -75,10 +154,86 @@ public:
 
     // Find the nearest point on the navigation mesh to a given point. Extents specifies how far out from the specified point to check along each axis.
     Vector3F FindNearestPoint(const Vector3F& point,const Vector3F& extents, const dtQueryFilter* filter = nullptr, dtPolyRef* nearestRef = nullptr);
+    // Find the nearest points on the navigation mesh for a batch of points. dest and destRefs receive one entry per point; points off the navigation mesh are
+    // copied as they are with a zero polygon. Points are spread over the workers if given.
+    void FindNearestPoints(std::vector<Vector3F>& dest, std::vector<dtPolyRef>& destRefs, const std::vector<Vector3F>& points, const Vector3F& extents,
+        thread_pool* workers = nullptr, const dtQueryFilter* filter = nullptr);
     // Find a path between world space points. Return non-empty list of points if successful. Extents specifies how far off the navigation mesh the points can be.
     void FindPath(std::vector<Vector3F>& dest, const Vector3F& start, const Vector3F& end, const Vector3F& extents, const dtQueryFilter* filter = nullptr);
     // Find a path between world space points. Return non-empty list of navigation path points if successful. Extents specifies how far off the navigation mesh the points can be.
     void FindPath(std::vector<NavigationPathPoint>& dest, const Vector3F& start, const Vector3F& end, const Vector3F& extents, const dtQueryFilter* filter = nullptr);
+    // Find the next waypoint from position toward goal using a flow field shared by all callers chasing the same goal. distance receives the remaining travel cost. Return false if the position is out of the field.
+    bool FindFlowFieldStep(const Vector3F& goal, const Vector3F& position, const Vector3F& extents, Vector3F& waypoint, float* distance = nullptr,
+        const dtQueryFilter* filter = nullptr);
+    // Return the flow field cache.
+    FlowFieldCache* GetFlowFields() const { return flowFields_.get(); }
+    // Set maximum travel cost from the goal covered by new flow fields.
+    void SetFlowFieldDistance(float distance) { flowFieldDistance_ = distance; }
+    // Return maximum travel cost from the goal covered by flow fields.
+    float GetFlowFieldDistance() const { return flowFieldDistance_; }
+    // Test whether the end can be walked to from the start in a straight line over the navigation mesh. Much cheaper than a path search. Return whether the
+    // end is walkable.
+    bool Raycast(NavigationRaycastResult& dest, const Vector3F& start, const Vector3F& end, const Vector3F& extents, const dtQueryFilter* filter = nullptr);
+    // Test a batch of start/end pairs for straight walkability. dest receives one result per request. Requests are spread over the workers if given.
+    void Raycasts(std::vector<NavigationRaycastResult>& dest, const std::vector<NavigationPathRequest>& requests, const Vector3F& extents,
+        thread_pool* workers = nullptr, const dtQueryFilter* filter = nullptr);
+    // Pick random points over the navigation mesh with uniform density. dest and destRefs receive count entries. Only polygons passing the navigation mesh
+    // filter are sampled. Return false if there are no polygons.
+    bool FindRandomPoints(std::vector<Vector3F>& dest, std::vector<dtPolyRef>& destRefs, unsigned count, thread_pool* workers = nullptr);
+    // Pick a random point reachable from every center within the radius. dest and destRefs receive one entry per center; centers off the navigation mesh
+    // are copied as they are with a zero polygon. Centers are spread over the workers if given.
+    void FindRandomPointsAroundCircle(std::vector<Vector3F>& dest, std::vector<dtPolyRef>& destRefs, const std::vector<Vector3F>& centers, float radius,
+        const Vector3F& extents, thread_pool* workers = nullptr, const dtQueryFilter* filter = nullptr);
+    // Return whether a path between world space points may exist. Points off the navigation mesh or on disconnected islands are unreachable.
+    bool IsReachable(const Vector3F& start, const Vector3F& end, const Vector3F& extents, const dtQueryFilter* filter = nullptr);
+    // Find paths for a batch of start/end pairs. dest receives one list of points per request, empty if not found. Requests are spread over the workers if given.
+    void FindPaths(std::vector<std::vector<Vector3F>>& dest, const std::vector<NavigationPathRequest>& requests, const Vector3F& extents,
+        thread_pool* workers = nullptr, const dtQueryFilter* filter = nullptr);
+
+    // Queue a path request solved incrementally by UpdateSlicedPaths.
+    void FindPathSliced(unsigned id, const Vector3F& start, const Vector3F& end, const Vector3F& extents, const dtQueryFilter* filter = nullptr);
+    // Advance queued sliced requests until the iteration or time budget is spent and append finished ones to dest. Zero means no limit; with both zero all requests are solved.
+    void UpdateSlicedPaths(std::vector<PathResult>& dest, unsigned maxIterations, unsigned maxMicroseconds);
+    // Return number of sliced requests not finished yet.
+    unsigned GetSlicedPathCount() const { return static_cast<unsigned>(slicedPaths_.size()); }
+
+    // Notify that the tile was rebuilt or removed. Invalidates cached paths crossing it, the navigation graph around it and the landmark table.
+    void TileChanged(const Int32Vector2& tile);
+    // Bring the navigation graph up to date with rebuilt tiles ahead of the next query.
+    void UpdateGraph();
+    // Compute the landmark table if it is enabled and missing. The landmark searches are spread over the workers if given. With settle set only a table
+    // dropped by tile changes is recomputed, once no tile has changed for a while, on a background thread; a later call swaps it in unless tiles
+    // changed meanwhile.
+    void UpdateLandmarks(thread_pool* workers = nullptr, bool settle = false);
+    // Wait for the background landmark computation to finish. Must be called before tiles are changed, as it reads the navigation mesh.
+    void WaitLandmarks();
+
+    // Set whether long paths are planned over the navigation graph.
+    void SetHierarchicalPaths(bool enable) { hierarchicalPaths_ = enable; }
+    // Return whether long paths are planned over the navigation graph.
+    bool GetHierarchicalPaths() const { return hierarchicalPaths_; }
+
+    // Set number of landmarks guiding the path search, zero disables them. Takes effect on the next UpdateLandmarks.
+    void SetNumLandmarks(unsigned numLandmarks) { numLandmarks_ = numLandmarks; }
+    // Return number of landmarks guiding the path search.
+    unsigned GetNumLandmarks() const { return numLandmarks_; }
+    // Return the landmark table, null if there is none. Searches keep the table they started with while it is replaced.
+    std::shared_ptr<const LandmarkTable> GetLandmarks() const;
+    // Replace the landmark table.
+    void SetLandmarks(std::shared_ptr<const LandmarkTable> landmarks);
+
+    // Return the path cache.
+    PathCache* GetPathCache() const { return pathCache_.get(); }
+
+    // Set agent dimensions and profile name. Takes effect on the next full build.
+    void SetProfile(const NavigationProfile& profile);
+    // Return agent dimensions and profile name.
+    NavigationProfile GetProfile() const;
+
+    // Set interior the navigation mesh is built from, nodes of other interiors are left out. Takes effect on the next full build.
+    void SetInterior(std::int32_t interior) { interior_ = interior; }
+    // Return interior the navigation mesh is built from.
+    std::int32_t GetInterior() const { return interior_; }
 
     // Return bounding box of the tile in the node space.
     BoundingBox GetTileBoundingBox(const Int32Vector2& tile) const;
@@ -92,9 +247,29 @@ protected:
 
      // Get geometry data within a bounding box.
     void GetTileGeometry(NavBuildData* build, BoundingBox& box);
+    // Get the area volumes intersecting a bounding box.
+    void GetTileAreas(NavBuildData* build, const BoundingBox& box) const;
 
-     // Ensure that the navigation mesh query is initialized. Return true if successful.
-    bool InitializeQuery();
+    // Find a straight path into the scratch buffers of the query context, consulting the path cache first. Return number of path points.
+    int FindStraightPath(NavigationQuery& query, const Vector3F& start, const Vector3F& end, const Vector3F& extents, const dtQueryFilter* filter) const;
+    // Find a polygon corridor between the polygons, over the navigation graph for long routes. corridor receives the polygons held by the query context.
+    // Return number of polygons.
+    int FindCorridor(NavigationQuery& query, dtPolyRef startRef, dtPolyRef endRef, const Vector3F& start, const Vector3F& end, const dtQueryFilter* filter,
+        const dtPolyRef*& corridor) const;
+    // Turn the polygon corridor into a straight path in the scratch buffers. Return number of path points.
+    int FinishStraightPath(NavigationQuery& query, const Vector3F& start, const Vector3F& end, dtPolyRef endRef, const dtPolyRef* corridor,
+        int numPolys) const;
+    // Test straight walkability between world space points with the query context. Return whether the end is walkable.
+    bool Raycast(NavigationQuery& query, NavigationRaycastResult& dest, const Vector3F& start, const Vector3F& end, const Vector3F& extents,
+        const dtQueryFilter* filter) const;
+    // Start the search of a sliced request. Return true if the request is already finished.
+    bool BeginSlicedPath(SlicedPathRequest& request);
+    // Make the result of a finished sliced request.
+    PathResult EndSlicedPath(SlicedPathRequest& request);
+    // Check the landmark table in debug builds and swap it in.
+    void AcceptLandmarks(std::shared_ptr<LandmarkTable> landmarks);
+    // Lease a query context for the current navigation mesh. Return an empty lease if the navigation mesh is not allocated.
+    NavigationQueryLease AcquireQuery() const;
      // Release the navigation mesh and the query.
     virtual void ReleaseNavigationMesh();
 
@@ -102,13 +277,45 @@ protected:
 
 	// Detour navigation mesh.
     dtNavMesh* navMesh_{};
-    // Detour navigation mesh query.
-    dtNavMeshQuery* navMeshQuery_{};
+    // Pool of query contexts, one is leased per query.
+    std::unique_ptr<NavigationQueryPool> queryPool_;
+    // Recently found paths.
+    std::unique_ptr<PathCache> pathCache_;
+    // Flow fields of recent goals.
+    std::unique_ptr<FlowFieldCache> flowFields_;
+    // Maximum travel cost from the goal covered by a flow field.
+    float flowFieldDistance_{500.0f};
+    // Graph of tile border portals for long paths.
+    std::unique_ptr<NavigationGraph> graph_;
+    // Whether long paths are planned over the navigation graph.
+    bool hierarchicalPaths_{true};
+    // Landmark distances for the path search heuristic. Dropped whenever a tile changes and recomputed by UpdateLandmarks.
+    std::shared_ptr<const LandmarkTable> landmarks_;
+    // Guards the landmark table pointer against searches on the worker threads.
+    mutable std::mutex landmarksMutex_;
+    // Time of the last tile change the landmark table was dropped for, zero once it is recomputed.
+    std::chrono::steady_clock::time_point landmarksChanged_;
+    // Background computation of the next landmark table, invalid if none is running.
+    std::future<std::shared_ptr<LandmarkTable>> landmarksJob_;
+    // Number of tile changes, the background table is discarded if it changes while the table is computed.
+    unsigned tileVersion_{};
+    // Number of tile changes the background table was started at.
+    unsigned landmarksJobVersion_{};
+    // Number of landmarks of the table. Off unless enabled, the landmark search may settle on longer corridors than Detour's.
+    unsigned numLandmarks_{};
+    // Polygon areas for random point sampling, summed again for changed tiles.
+    std::unique_ptr<RandomPointSampler> sampler_;
+    // Sliced requests in order of arrival. Only the first few hold a query context.
+    std::deque<SlicedPathRequest> slicedPaths_;
+    // Sliced requests finished outside UpdateSlicedPaths.
+    std::vector<PathResult> slicedResults_;
      // Detour navigation mesh query filter.
     dtQueryFilter* queryFilter_{};
-    // Temporary data for finding a path.
-    FindPathData* pathData_{};
 
+    // Profile name.
+    std::string profileName_;
+    // Interior of the scene nodes the navigation mesh is built from.
+    std::int32_t interior_{};
     // Tile size.
     int tileSize_{128};
     // Cell size.
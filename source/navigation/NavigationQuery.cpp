@@ -0,0 +1,129 @@
+#include "../navigation/NavigationQuery.h"
+
+#include <DetourNavMesh.h>
+#include <DetourNavMeshQuery.h>
+#include <DetourNode.h>
+
+#include <spdlog/spdlog.h>
+
+namespace WorldAssistant
+{
+
+/*
+    NavigationQuery
+*/
+NavigationQuery::~NavigationQuery()
+{
+    dtFreeNavMeshQuery(query_);
+    query_ = nullptr;
+}
+
+/*
+    NavigationQueryLease
+*/
+NavigationQueryLease::NavigationQueryLease(NavigationQueryPool* pool, std::unique_ptr<NavigationQuery> query) :
+    pool_(pool),
+    query_(std::move(query))
+{
+}
+
+NavigationQueryLease& NavigationQueryLease::operator =(NavigationQueryLease&& rhs) noexcept
+{
+    if (this != &rhs)
+    {
+        Return();
+        pool_ = rhs.pool_;
+        query_ = std::move(rhs.query_);
+    }
+
+    return *this;
+}
+
+NavigationQueryLease::~NavigationQueryLease()
+{
+    Return();
+}
+
+void NavigationQueryLease::Return()
+{
+    if (pool_ && query_)
+        pool_->Release(std::move(query_));
+
+    query_.reset();
+}
+
+/*
+    NavigationQueryPool
+*/
+NavigationQueryPool::NavigationQueryPool(int maxNodes) :
+    maxNodes_(maxNodes)
+{
+}
+
+NavigationQueryLease NavigationQueryPool::Acquire(const dtNavMesh* navMesh)
+{
+    if (!navMesh)
+        return {};
+
+    std::unique_ptr<NavigationQuery> query;
+    unsigned generation;
+    {
+        const std::lock_guard<std::mutex> lock(mutex_);
+        generation = generation_;
+
+        if (!idle_.empty())
+        {
+            query = std::move(idle_.back());
+            idle_.pop_back();
+        }
+    }
+
+    if (!query)
+        query = std::make_unique<NavigationQuery>();
+
+    if (!query->query_)
+    {
+        query->query_ = dtAllocNavMeshQuery();
+        if (!query->query_)
+        {
+            spdlog::error("Could not create navigation mesh query");
+            return {};
+        }
+    }
+
+    // Initialization is skipped for a context that already belongs to the current mesh
+    if (query->generation_ != generation)
+    {
+        if (dtStatusFailed(query->query_->init(navMesh, maxNodes_)))
+        {
+            spdlog::error("Could not init navigation mesh query");
+            return {};
+        }
+
+        query->generation_ = generation;
+    }
+
+    return NavigationQueryLease(this, std::move(query));
+}
+
+void NavigationQueryPool::Release(std::unique_ptr<NavigationQuery> query)
+{
+    const std::lock_guard<std::mutex> lock(mutex_);
+    if (query->generation_ == generation_)
+        idle_.push_back(std::move(query));
+}
+
+void NavigationQueryPool::Invalidate()
+{
+    const std::lock_guard<std::mutex> lock(mutex_);
+    ++generation_;
+    idle_.clear();
+}
+
+std::size_t NavigationQueryPool::GetIdleCount() const
+{
+    const std::lock_guard<std::mutex> lock(mutex_);
+    return idle_.size();
+}
+
+}
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "../utils/MathUtils.h"
+
+#ifdef DT_POLYREF64
+using dtPolyRef = uint64_t;
+#else
+using dtPolyRef = unsigned int;
+#endif
+
+class dtNavMesh;
+class dtNavMeshQuery;
+class dtNodePool;
+class dtNodeQueue;
+
+namespace WorldAssistant
+{
+
+static const int MAX_POLYS = 2048;
+
+// Temporary data for finding a path.
+struct FindPathData
+{
+    // Polygons.
+    dtPolyRef polys_[MAX_POLYS]{};
+    // Polygons on the path.
+    dtPolyRef pathPolys_[MAX_POLYS]{};
+    // Points on the path.
+    Vector3F pathPoints_[MAX_POLYS];
+    // Flags on the path.
+    unsigned char pathFlags_[MAX_POLYS]{};
+};
+
+// Query context owned by a single thread at a time: Detour query object (with its node pool) and path scratch buffers.
+struct NavigationQuery
+{
+    // Destructor.
+    ~NavigationQuery();
+
+    // Detour navigation mesh query.
+    dtNavMeshQuery* query_{};
+    // Temporary data for finding a path.
+    FindPathData pathData_;
+    // Corridor of a path planned over the navigation graph, may exceed MAX_POLYS.
+    std::vector<dtPolyRef> corridor_;
+    // Node pool of searches run outside the Detour query, allocated on first use.
+    std::unique_ptr<dtNodePool> nodePool_;
+    // Open list of searches run outside the Detour query, allocated on first use.
+    std::unique_ptr<dtNodeQueue> openList_;
+    // Pool generation the query was initialized for.
+    unsigned generation_{};
+};
+
+class NavigationQueryPool;
+
+// Exclusive lease of a query context. Returns the context to the pool on destruction.
+class NavigationQueryLease
+{
+public:
+    // Construct empty.
+    NavigationQueryLease() = default;
+    // Construct from an acquired context.
+    NavigationQueryLease(NavigationQueryPool* pool, std::unique_ptr<NavigationQuery> query);
+    // Move constructor.
+    NavigationQueryLease(NavigationQueryLease&& rhs) noexcept = default;
+    // Move assignment.
+    NavigationQueryLease& operator =(NavigationQueryLease&& rhs) noexcept;
+    // Destructor.
+    ~NavigationQueryLease();
+
+    // Return whether the lease holds a context.
+    explicit operator bool() const { return static_cast<bool>(query_); }
+
+    NavigationQuery* operator ->() const { return query_.get(); }
+
+    NavigationQuery& operator *() const { return *query_; }
+
+private:
+    // Give the context back to the pool.
+    void Return();
+
+    NavigationQueryPool* pool_{};
+
+    std::unique_ptr<NavigationQuery> query_;
+};
+
+// Pool of query contexts so several threads can query a read-only navigation mesh at the same time.
+class NavigationQueryPool
+{
+public:
+    // Construct with the node pool size of every query.
+    explicit NavigationQueryPool(int maxNodes);
+
+    // Lease a context initialized for the navigation mesh. Return an empty lease on failure.
+    NavigationQueryLease Acquire(const dtNavMesh* navMesh);
+    // Give a context back. Contexts of a stale generation are destroyed.
+    void Release(std::unique_ptr<NavigationQuery> query);
+    // Invalidate all contexts, must be called whenever the navigation mesh is reallocated or freed.
+    void Invalidate();
+
+    // Return number of idle contexts.
+    std::size_t GetIdleCount() const;
+
+private:
+    // Maximum number of search nodes of each query.
+    int maxNodes_;
+    // Current generation, contexts of other generations must be reinitialized.
+    unsigned generation_{1};
+    // Idle contexts.
+    std::vector<std::unique_ptr<NavigationQuery>> idle_;
+    // Guards the idle list and the generation.
+    mutable std::mutex mutex_;
+};
+
+}
@@ -0,0 +1,82 @@
+#include "../navigation/NavigationUtils.h"
+
+#include <DetourNavMesh.h>
+
+namespace WorldAssistant
+{
+
+// Bits of a tile coordinate in a tile key.
+static const unsigned TILE_KEY_COORD_BITS = 20u;
+static const std::uint64_t TILE_KEY_COORD_MASK = (1u << TILE_KEY_COORD_BITS) - 1u;
+// Bits of the layer in a tile key.
+static const unsigned TILE_KEY_LAYER_BITS = 8u;
+static const std::uint64_t TILE_KEY_LAYER_MASK = (1u << TILE_KEY_LAYER_BITS) - 1u;
+
+// Sign-extend a coordinate stored in the low bits.
+static int UnpackTileKeyCoord(std::uint64_t bits)
+{
+    const std::uint32_t value = static_cast<std::uint32_t>(bits & TILE_KEY_COORD_MASK);
+    return static_cast<std::int32_t>(value << (32u - TILE_KEY_COORD_BITS)) >> (32u - TILE_KEY_COORD_BITS);
+}
+
+std::uint64_t MakeTileKey(int x, int y, int layer)
+{
+    return ((static_cast<std::uint64_t>(static_cast<std::uint32_t>(x)) & TILE_KEY_COORD_MASK) << (TILE_KEY_COORD_BITS + TILE_KEY_LAYER_BITS)) |
+        ((static_cast<std::uint64_t>(static_cast<std::uint32_t>(y)) & TILE_KEY_COORD_MASK) << TILE_KEY_LAYER_BITS) |
+        (static_cast<std::uint64_t>(static_cast<std::uint32_t>(layer)) & TILE_KEY_LAYER_MASK);
+}
+
+Int32Vector2 GetTileKeyCoords(std::uint64_t key)
+{
+    return Int32Vector2(UnpackTileKeyCoord(key >> (TILE_KEY_COORD_BITS + TILE_KEY_LAYER_BITS)), UnpackTileKeyCoord(key >> TILE_KEY_LAYER_BITS));
+}
+
+int GetTileKeyLayer(std::uint64_t key)
+{
+    return static_cast<int>(key & TILE_KEY_LAYER_MASK);
+}
+
+Vector3F GetPolyVertex(const dtMeshTile* tile, unsigned short index)
+{
+    return Vector3F(&tile->verts[index * 3]);
+}
+
+Vector3F GetPolyCenter(const dtMeshTile* tile, const dtPoly* poly)
+{
+    Vector3F center;
+    for (unsigned char i = 0; i < poly->vertCount; ++i)
+        center += GetPolyVertex(tile, poly->verts[i]);
+
+    return center * (1.0f / poly->vertCount);
+}
+
+Vector3F GetPortalPoint(const dtMeshTile* tile, const dtPoly* poly, const dtLink& link, const dtMeshTile* neighbourTile, const dtPoly* neighbourPoly,
+    const Vector3F& reference)
+{
+    // Off-mesh connections are entered at their end points
+    if (poly->getType() == DT_POLYTYPE_OFFMESH_CONNECTION)
+        return GetPolyVertex(tile, poly->verts[link.edge]);
+
+    if (neighbourPoly->getType() == DT_POLYTYPE_OFFMESH_CONNECTION)
+    {
+        const Vector3F a = GetPolyVertex(neighbourTile, neighbourPoly->verts[0]);
+        const Vector3F b = GetPolyVertex(neighbourTile, neighbourPoly->verts[1]);
+        return (a - reference).LengthSquared() <= (b - reference).LengthSquared() ? a : b;
+    }
+
+    const Vector3F a = GetPolyVertex(tile, poly->verts[link.edge]);
+    const Vector3F b = GetPolyVertex(tile, poly->verts[(link.edge + 1) % poly->vertCount]);
+
+    // Border links may cover only a part of the edge
+    float tmin = 0.0f;
+    float tmax = 1.0f;
+    if (link.side != 0xff && (link.bmin != 0 || link.bmax != 255))
+    {
+        tmin = link.bmin / 255.0f;
+        tmax = link.bmax / 255.0f;
+    }
+
+    return a + (b - a) * ((tmin + tmax) * 0.5f);
+}
+
+}
\ No newline at end of file
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstdint>
+
+#include "../utils/MathUtils.h"
+
+struct dtMeshTile;
+struct dtPoly;
+struct dtLink;
+
+namespace WorldAssistant
+{
+
+// Maximum number of layers of a tile location, every layer index fits the layer bits of a tile key.
+static const int MAX_TILE_LAYERS = 255;
+
+// Pack tile coordinates and layer into a 48-bit key. Coordinates keep 20 bits each, sign included, and the layer 8 bits. Keys of tiles without a layer
+// use layer zero.
+std::uint64_t MakeTileKey(int x, int y, int layer = 0);
+// Return tile coordinates of a tile key.
+Int32Vector2 GetTileKeyCoords(std::uint64_t key);
+// Return layer of a tile key.
+int GetTileKeyLayer(std::uint64_t key);
+
+// Return position of the polygon vertex.
+Vector3F GetPolyVertex(const dtMeshTile* tile, unsigned short index);
+// Return average position of the polygon vertices.
+Vector3F GetPolyCenter(const dtMeshTile* tile, const dtPoly* poly);
+// Return a point on the border crossed by the link. Off-mesh connections are crossed at the end point nearest to the reference position.
+Vector3F GetPortalPoint(const dtMeshTile* tile, const dtPoly* poly, const dtLink& link, const dtMeshTile* neighbourTile, const dtPoly* neighbourPoly,
+    const Vector3F& reference);
+
+}
\ No newline at end of file
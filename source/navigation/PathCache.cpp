@@ -0,0 +1,232 @@
+#include "../navigation/PathCache.h"
+#include "../navigation/NavigationUtils.h"
+
+#include <DetourNavMesh.h>
+#include <DetourNavMeshQuery.h>
+
+#include <algorithm>
+
+namespace WorldAssistant
+{
+
+namespace
+{
+
+inline void HashCombine(std::size_t& seed, std::size_t value)
+{
+    seed ^= value + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+}
+
+inline int Quantize(float value, float quantum)
+{
+    return static_cast<int>(std::floor(value / quantum));
+}
+
+}
+
+/*
+    PathCacheKeyHasher
+*/
+std::size_t PathCacheKeyHasher::operator ()(const PathCacheKey& key) const
+{
+    std::size_t seed = std::hash<dtPolyRef>()(key.startRef_);
+    HashCombine(seed, std::hash<dtPolyRef>()(key.endRef_));
+    HashCombine(seed, std::hash<int>()(key.start_.x_));
+    HashCombine(seed, std::hash<int>()(key.start_.y_));
+    HashCombine(seed, std::hash<int>()(key.start_.z_));
+    HashCombine(seed, std::hash<int>()(key.end_.x_));
+    HashCombine(seed, std::hash<int>()(key.end_.y_));
+    HashCombine(seed, std::hash<int>()(key.end_.z_));
+    HashCombine(seed, key.filter_);
+    return seed;
+}
+
+/*
+    PathCache
+*/
+PathCache::PathCache(std::size_t capacity, float quantum) :
+    capacity_(capacity),
+    quantum_(quantum)
+{
+}
+
+PathCacheKey PathCache::MakeKey(dtPolyRef startRef, dtPolyRef endRef, const Vector3F& start, const Vector3F& end, const dtQueryFilter* filter) const
+{
+    PathCacheKey key;
+    key.startRef_ = startRef;
+    key.endRef_ = endRef;
+    key.start_ = Int32Vector3(Quantize(start.x_, quantum_), Quantize(start.y_, quantum_), Quantize(start.z_, quantum_));
+    key.end_ = Int32Vector3(Quantize(end.x_, quantum_), Quantize(end.y_, quantum_), Quantize(end.z_, quantum_));
+
+    // Filters are hashed by value since the same object may be reconfigured between queries
+    if (filter)
+    {
+        std::size_t seed = std::hash<unsigned short>()(filter->getIncludeFlags());
+        HashCombine(seed, std::hash<unsigned short>()(filter->getExcludeFlags()));
+        for (int i = 0; i < DT_MAX_AREAS; ++i)
+            HashCombine(seed, std::hash<float>()(filter->getAreaCost(i)));
+
+        key.filter_ = seed;
+    }
+
+    return key;
+}
+
+std::uint64_t PathCache::GetGeneration() const
+{
+    const std::lock_guard<std::mutex> lock(mutex_);
+    return generation_;
+}
+
+int PathCache::Find(const PathCacheKey& key, const dtNavMesh* navMesh, std::vector<dtPolyRef>& corridor)
+{
+    const std::lock_guard<std::mutex> lock(mutex_);
+
+    auto it = lookup_.find(key);
+    if (it == lookup_.end())
+    {
+        ++misses_;
+        return -1;
+    }
+
+    // Entries crossing a rebuilt tile are dropped on the first lookup
+    const Entry& found = *it->second;
+    const bool valid = IsValid(found.tiles_, found.generation_) && std::all_of(found.corridor_.begin(), found.corridor_.end(),
+        [navMesh](dtPolyRef polyRef) { return navMesh->isValidPolyRef(polyRef); });
+    if (!valid)
+    {
+        entries_.erase(it->second);
+        lookup_.erase(it);
+        ++misses_;
+        return -1;
+    }
+
+    // Move to the front
+    entries_.splice(entries_.begin(), entries_, it->second);
+
+    const Entry& entry = entries_.front();
+    corridor.assign(entry.corridor_.begin(), entry.corridor_.end());
+
+    ++hits_;
+    return static_cast<int>(entry.corridor_.size());
+}
+
+void PathCache::Insert(const PathCacheKey& key, std::uint64_t generation, const dtNavMesh* navMesh, const dtPolyRef* corridor, int numPolys)
+{
+    if (!capacity_ || !navMesh || numPolys <= 0)
+        return;
+
+    Entry entry;
+    entry.key_ = key;
+    entry.corridor_.assign(corridor, corridor + numPolys);
+    entry.generation_ = generation;
+
+    // Consecutive corridor polygons mostly share the tile, so only the last one is compared before the full search
+    std::uint64_t lastTileKey = 0;
+    for (int i = 0; i < numPolys; ++i)
+    {
+        const dtMeshTile* tile = nullptr;
+        const dtPoly* poly = nullptr;
+        navMesh->getTileAndPolyByRefUnsafe(corridor[i], &tile, &poly);
+        if (!tile || !tile->header)
+            continue;
+
+        const std::uint64_t tileKey = MakeTileKey(tile->header->x, tile->header->y);
+        if (!entry.tiles_.empty() && tileKey == lastTileKey)
+            continue;
+
+        lastTileKey = tileKey;
+
+        if (std::find(entry.tiles_.begin(), entry.tiles_.end(), tileKey) == entry.tiles_.end())
+            entry.tiles_.push_back(tileKey);
+    }
+
+    const std::lock_guard<std::mutex> lock(mutex_);
+
+    // The search may have read tiles rebuilt while it ran
+    if (generation < clearGeneration_ || !IsValid(entry.tiles_, generation))
+        return;
+
+    auto it = lookup_.find(key);
+    if (it != lookup_.end())
+    {
+        *it->second = std::move(entry);
+        entries_.splice(entries_.begin(), entries_, it->second);
+        return;
+    }
+
+    entries_.push_front(std::move(entry));
+    lookup_.emplace(key, entries_.begin());
+
+    Trim();
+}
+
+void PathCache::InvalidateTile(const Int32Vector2& tile)
+{
+    const std::lock_guard<std::mutex> lock(mutex_);
+    tileGenerations_[MakeTileKey(tile.x_, tile.y_)] = ++generation_;
+}
+
+void PathCache::Clear()
+{
+    const std::lock_guard<std::mutex> lock(mutex_);
+    entries_.clear();
+    lookup_.clear();
+    tileGenerations_.clear();
+    clearGeneration_ = ++generation_;
+    hits_ = 0;
+    misses_ = 0;
+}
+
+void PathCache::SetCapacity(std::size_t capacity)
+{
+    const std::lock_guard<std::mutex> lock(mutex_);
+    capacity_ = capacity;
+    Trim();
+}
+
+std::size_t PathCache::GetSize() const
+{
+    const std::lock_guard<std::mutex> lock(mutex_);
+    return entries_.size();
+}
+
+std::size_t PathCache::GetHitCount() const
+{
+    const std::lock_guard<std::mutex> lock(mutex_);
+    return hits_;
+}
+
+std::size_t PathCache::GetMissCount() const
+{
+    const std::lock_guard<std::mutex> lock(mutex_);
+    return misses_;
+}
+
+bool PathCache::IsValid(const std::vector<std::uint64_t>& tiles, std::uint64_t generation) const
+{
+    for (const std::uint64_t tileKey : tiles)
+    {
+        if (GetTileGeneration(tileKey) > generation)
+            return false;
+    }
+
+    return true;
+}
+
+std::uint64_t PathCache::GetTileGeneration(std::uint64_t tileKey) const
+{
+    auto it = tileGenerations_.find(tileKey);
+    return it != tileGenerations_.end() ? it->second : 0;
+}
+
+void PathCache::Trim()
+{
+    while (entries_.size() > capacity_)
+    {
+        lookup_.erase(entries_.back().key_);
+        entries_.pop_back();
+    }
+}
+
+}
\ No newline at end of file
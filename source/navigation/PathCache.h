@@ -0,0 +1,114 @@
+#pragma once
+
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <vector>
+#include <unordered_map>
+
+#include "../navigation/NavigationQuery.h"
+#include "../utils/MathUtils.h"
+
+class dtNavMesh;
+class dtQueryFilter;
+
+namespace WorldAssistant
+{
+
+// Key of a cached path.
+struct PathCacheKey
+{
+    // Start polygon.
+    dtPolyRef startRef_{};
+    // End polygon.
+    dtPolyRef endRef_{};
+    // Quantized start position.
+    Int32Vector3 start_;
+    // Quantized end position.
+    Int32Vector3 end_;
+    // Hash of the query filter.
+    std::size_t filter_{};
+
+    bool operator ==(const PathCacheKey& rhs) const
+    {
+        return startRef_ == rhs.startRef_ && endRef_ == rhs.endRef_ && start_ == rhs.start_ && end_ == rhs.end_ && filter_ == rhs.filter_;
+    }
+};
+
+struct PathCacheKeyHasher
+{
+    std::size_t operator ()(const PathCacheKey& key) const;
+};
+
+// Bounded LRU cache of polygon corridors. Every entry remembers the tiles its corridor crosses, rebuilding a tile invalidates only the paths crossing it.
+class PathCache
+{
+public:
+    // Construct with the maximum number of entries and the position quantization step.
+    explicit PathCache(std::size_t capacity = 1024, float quantum = 0.5f);
+
+    // Make a key for the query.
+    PathCacheKey MakeKey(dtPolyRef startRef, dtPolyRef endRef, const Vector3F& start, const Vector3F& end, const dtQueryFilter* filter) const;
+    // Return the current generation. Taken before a search starts and passed to Insert, so tiles changed during the search keep its corridor out.
+    std::uint64_t GetGeneration() const;
+    // Copy a cached corridor whose polygons are all still valid. Return number of polygons, or -1 if there is no valid entry.
+    int Find(const PathCacheKey& key, const dtNavMesh* navMesh, std::vector<dtPolyRef>& corridor);
+    // Store a corridor found for the key by a search started at the generation. Skipped if a tile the corridor crosses changed since.
+    void Insert(const PathCacheKey& key, std::uint64_t generation, const dtNavMesh* navMesh, const dtPolyRef* corridor, int numPolys);
+    // Invalidate paths crossing the tile.
+    void InvalidateTile(const Int32Vector2& tile);
+    // Remove all entries.
+    void Clear();
+
+    // Set the maximum number of entries.
+    void SetCapacity(std::size_t capacity);
+    // Return the maximum number of entries.
+    std::size_t GetCapacity() const { return capacity_; }
+    // Return number of entries.
+    std::size_t GetSize() const;
+    // Return number of cache hits since the last Clear.
+    std::size_t GetHitCount() const;
+    // Return number of cache misses since the last Clear.
+    std::size_t GetMissCount() const;
+
+private:
+    struct Entry
+    {
+        PathCacheKey key_;
+        // Polygon corridor.
+        std::vector<dtPolyRef> corridor_;
+        // Crossed tiles.
+        std::vector<std::uint64_t> tiles_;
+        // Generation the search of the corridor started at.
+        std::uint64_t generation_{};
+    };
+
+    // Return whether none of the tiles changed after the generation.
+    bool IsValid(const std::vector<std::uint64_t>& tiles, std::uint64_t generation) const;
+    // Return generation the tile last changed at.
+    std::uint64_t GetTileGeneration(std::uint64_t tileKey) const;
+    // Remove least recently used entries over the capacity.
+    void Trim();
+
+    // Maximum number of entries.
+    std::size_t capacity_;
+    // Position quantization step.
+    float quantum_;
+    // Entries, most recently used first.
+    std::list<Entry> entries_;
+    // Entries by key.
+    std::unordered_map<PathCacheKey, std::list<Entry>::iterator, PathCacheKeyHasher> lookup_;
+    // Generation every tile last changed at. Missing tiles did not change since the last Clear.
+    std::unordered_map<std::uint64_t, std::uint64_t> tileGenerations_;
+    // Generation advanced on every tile change and Clear.
+    std::uint64_t generation_{};
+    // Generation of the last Clear, searches started before it are not stored.
+    std::uint64_t clearGeneration_{};
+    // Statistics.
+    std::size_t hits_{};
+    std::size_t misses_{};
+    // Guards everything above.
+    mutable std::mutex mutex_;
+};
+
+}
\ No newline at end of file
@@ -0,0 +1,68 @@
+#include "../navigation/PathRequestQueue.h"
+
+#include <spdlog/spdlog.h>
+#include "thread_pool/thread_pool.hpp"
+
+namespace WorldAssistant
+{
+
+PathRequestQueue::PathRequestQueue(thread_pool& workers) :
+    workers_(workers)
+{
+}
+
+PathRequestQueue::~PathRequestQueue()
+{
+    Wait();
+}
+
+void PathRequestQueue::Push(unsigned id, std::shared_ptr<NavigationMesh> navmesh, const Vector3F& start, const Vector3F& end, const Vector3F& extents)
+{
+    {
+        const std::lock_guard<std::mutex> lock(mutex_);
+        ++pending_;
+    }
+
+    // The task keeps the navigation mesh alive until the request is solved
+    workers_.push_task([this, id, navmesh = std::move(navmesh), start, end, extents]() {
+        PathResult result{ id, {} };
+
+        // A request that throws is reported without a path, Wait must not block on it forever
+        try {
+            navmesh->FindPath(result.path_, start, end, extents);
+        }
+        catch (const std::exception& e) {
+            spdlog::error("Could not solve path request {}: {}", id, e.what());
+            result.path_.clear();
+        }
+
+        // The request counts as solved before its result is stored, so Wait returns even if storing it fails
+        const std::lock_guard<std::mutex> lock(mutex_);
+        --pending_;
+        solved_.notify_all();
+        finished_.push_back(std::move(result));
+    });
+}
+
+void PathRequestQueue::Collect(std::vector<PathResult>& dest)
+{
+    const std::lock_guard<std::mutex> lock(mutex_);
+    for (auto& result : finished_)
+        dest.push_back(std::move(result));
+
+    finished_.clear();
+}
+
+void PathRequestQueue::Wait()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    solved_.wait(lock, [this]() { return pending_ == 0; });
+}
+
+unsigned PathRequestQueue::GetPendingCount() const
+{
+    const std::lock_guard<std::mutex> lock(mutex_);
+    return pending_;
+}
+
+}
\ No newline at end of file
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <vector>
+
+#include "../navigation/NavigationMesh.h"
+
+class thread_pool;
+
+namespace WorldAssistant
+{
+
+// Queue of path requests solved by worker threads. Results are picked up by the owner thread with Collect.
+class PathRequestQueue
+{
+public:
+    // Construct with the worker pool used to solve requests.
+    explicit PathRequestQueue(thread_pool& workers);
+    // Destructor. Waits for all in-flight requests.
+    ~PathRequestQueue();
+
+    // Queue a path request under the ID given by the caller.
+    void Push(unsigned id, std::shared_ptr<NavigationMesh> navmesh, const Vector3F& start, const Vector3F& end, const Vector3F& extents);
+    // Move all solved requests into dest.
+    void Collect(std::vector<PathResult>& dest);
+    // Block until all in-flight requests are solved. Must be called before the navigation mesh is modified.
+    void Wait();
+
+    // Return number of requests not solved yet.
+    unsigned GetPendingCount() const;
+
+private:
+    // Worker threads.
+    thread_pool& workers_;
+    // Number of requests not solved yet.
+    unsigned pending_{};
+    // Solved requests waiting to be collected.
+    std::vector<PathResult> finished_;
+    // Guards the counters and the solved requests.
+    mutable std::mutex mutex_;
+    // Signaled when a request is solved.
+    std::condition_variable solved_;
+};
+
+}
\ No newline at end of file
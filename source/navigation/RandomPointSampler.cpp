@@ -0,0 +1,193 @@
+#include "../navigation/RandomPointSampler.h"
+#include "../navigation/NavigationUtils.h"
+
+#include <DetourCommon.h>
+#include <DetourNavMesh.h>
+#include <DetourNavMeshQuery.h>
+
+#include <algorithm>
+
+namespace WorldAssistant
+{
+
+void RandomPointSampler::MarkTileDirty(const Int32Vector2& tile)
+{
+    const std::unique_lock<std::shared_mutex> lock(mutex_);
+    dirtyTiles_.insert(MakeTileKey(tile.x_, tile.y_));
+}
+
+void RandomPointSampler::Update(const dtNavMesh* navMesh, const dtQueryFilter* filter)
+{
+    const std::unique_lock<std::shared_mutex> lock(mutex_);
+
+    // Polygons passing another filter differ in every tile
+    const unsigned short includeFlags = filter ? filter->getIncludeFlags() : 0;
+    const unsigned short excludeFlags = filter ? filter->getExcludeFlags() : 0;
+    if (filter != filter_ || includeFlags != includeFlags_ || excludeFlags != excludeFlags_)
+    {
+        filter_ = filter;
+        includeFlags_ = includeFlags;
+        excludeFlags_ = excludeFlags;
+        dirtyAll_ = true;
+    }
+
+    if (!navMesh || (!dirtyAll_ && dirtyTiles_.empty()))
+        return;
+
+    if (dirtyAll_)
+    {
+        tiles_.clear();
+
+        for (int i = 0; i < navMesh->getMaxTiles(); ++i)
+        {
+            const dtMeshTile* tile = navMesh->getTile(i);
+            if (!tile || !tile->header)
+                continue;
+
+            auto& layers = tiles_[MakeTileKey(tile->header->x, tile->header->y)];
+            if (static_cast<int>(layers.size()) <= tile->header->layer)
+                layers.resize(tile->header->layer + 1);
+
+            BuildTile(navMesh, filter, tile, layers[tile->header->layer]);
+        }
+    }
+    else
+    {
+        const dtMeshTile* layers[MAX_TILE_LAYERS];
+
+        for (const std::uint64_t tileKey : dirtyTiles_)
+        {
+            tiles_.erase(tileKey);
+
+            const Int32Vector2 coords = GetTileKeyCoords(tileKey);
+            const int numLayers = navMesh->getTilesAt(coords.x_, coords.y_, layers, MAX_TILE_LAYERS);
+            for (int i = 0; i < numLayers; ++i)
+            {
+                auto& tileLayers = tiles_[tileKey];
+                if (static_cast<int>(tileLayers.size()) <= layers[i]->header->layer)
+                    tileLayers.resize(layers[i]->header->layer + 1);
+
+                BuildTile(navMesh, filter, layers[i], tileLayers[layers[i]->header->layer]);
+            }
+        }
+    }
+
+    dirtyTiles_.clear();
+    dirtyAll_ = false;
+
+    sampledTiles_.clear();
+    tileAreas_.clear();
+
+    float totalArea = 0.0f;
+    for (const auto& tile : tiles_)
+    {
+        for (const SamplerTile& layer : tile.second)
+        {
+            if (layer.areas_.empty())
+                continue;
+
+            totalArea += layer.areas_.back();
+            sampledTiles_.push_back(&layer);
+            tileAreas_.push_back(totalArea);
+        }
+    }
+}
+
+void RandomPointSampler::Clear()
+{
+    const std::unique_lock<std::shared_mutex> lock(mutex_);
+    tiles_.clear();
+    sampledTiles_.clear();
+    tileAreas_.clear();
+    dirtyTiles_.clear();
+    dirtyAll_ = true;
+}
+
+bool RandomPointSampler::Sample(NavigationQuery& query, float (*frand)(), dtPolyRef& ref, Vector3F& point) const
+{
+    const std::shared_lock<std::shared_mutex> lock(mutex_);
+
+    ref = 0;
+    if (tileAreas_.empty() || tileAreas_.back() <= 0.0f)
+        return false;
+
+    // Pick the tile and then the polygon by area
+    const float tileValue = frand() * tileAreas_.back();
+    const std::size_t tileIndex = std::min(static_cast<std::size_t>(std::upper_bound(tileAreas_.begin(), tileAreas_.end(), tileValue) - tileAreas_.begin()),
+        tileAreas_.size() - 1);
+    const SamplerTile& tile = *sampledTiles_[tileIndex];
+
+    const float polyValue = frand() * tile.areas_.back();
+    const std::size_t polyIndex = std::min(static_cast<std::size_t>(std::upper_bound(tile.areas_.begin(), tile.areas_.end(), polyValue) - tile.areas_.begin()),
+        tile.areas_.size() - 1);
+    const dtPolyRef polyRef = tile.polys_[polyIndex];
+
+    const dtNavMeshQuery* navMeshQuery = query.query_;
+    const dtNavMesh* navMesh = navMeshQuery->getAttachedNavMesh();
+
+    const dtMeshTile* meshTile = nullptr;
+    const dtPoly* poly = nullptr;
+    if (dtStatusFailed(navMesh->getTileAndPolyByRef(polyRef, &meshTile, &poly)))
+        return false;
+
+    float verts[3 * DT_VERTS_PER_POLYGON];
+    float areas[DT_VERTS_PER_POLYGON];
+    for (int i = 0; i < poly->vertCount; ++i)
+        dtVcopy(&verts[i * 3], &meshTile->verts[poly->verts[i] * 3]);
+
+    const float s = frand();
+    const float t = frand();
+    dtRandomPointInConvexPoly(verts, poly->vertCount, areas, s, t, &point.x_);
+
+    float height;
+    if (dtStatusSucceed(navMeshQuery->getPolyHeight(polyRef, &point.x_, &height)))
+        point.y_ = height;
+
+    ref = polyRef;
+    return true;
+}
+
+float RandomPointSampler::GetTotalArea() const
+{
+    const std::shared_lock<std::shared_mutex> lock(mutex_);
+    return tileAreas_.empty() ? 0.0f : tileAreas_.back();
+}
+
+void RandomPointSampler::BuildTile(const dtNavMesh* navMesh, const dtQueryFilter* filter, const dtMeshTile* tile, SamplerTile& dest)
+{
+    dest.polys_.clear();
+    dest.areas_.clear();
+
+    const dtPolyRef base = navMesh->getPolyRefBase(tile);
+    float totalArea = 0.0f;
+
+    for (int i = 0; i < tile->header->polyCount; ++i)
+    {
+        const dtPoly* poly = &tile->polys[i];
+        if (poly->getType() != DT_POLYTYPE_GROUND)
+            continue;
+
+        const dtPolyRef ref = base | static_cast<dtPolyRef>(i);
+        if (filter && !filter->passFilter(ref, tile, poly))
+            continue;
+
+        // Fan triangulation, the area is measured in the horizontal plane like Detour does
+        float polyArea = 0.0f;
+        const float* va = &tile->verts[poly->verts[0] * 3];
+        for (int j = 2; j < poly->vertCount; ++j)
+        {
+            const float* vb = &tile->verts[poly->verts[j - 1] * 3];
+            const float* vc = &tile->verts[poly->verts[j] * 3];
+            polyArea += dtTriArea2D(va, vb, vc);
+        }
+
+        if (polyArea <= 0.0f)
+            continue;
+
+        totalArea += polyArea;
+        dest.polys_.push_back(ref);
+        dest.areas_.push_back(totalArea);
+    }
+}
+
+}
\ No newline at end of file
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <shared_mutex>
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "../navigation/NavigationQuery.h"
+#include "../utils/MathUtils.h"
+
+class dtNavMesh;
+class dtQueryFilter;
+struct dtMeshTile;
+
+namespace WorldAssistant
+{
+
+// Picks random points over the navigation mesh with uniform density. Polygon areas are summed per tile ahead of time, so a sample costs two binary searches
+// instead of the walk over every tile dtNavMeshQuery::findRandomPoint does.
+class RandomPointSampler
+{
+public:
+    // Mark the tile for update.
+    void MarkTileDirty(const Int32Vector2& tile);
+    // Sum the polygon areas of dirty tiles, counting only polygons passing the filter. Everything is summed again if the filter or its flags differ from
+    // the last update. Must be called before sampling once tiles change.
+    void Update(const dtNavMesh* navMesh, const dtQueryFilter* filter);
+    // Remove everything.
+    void Clear();
+
+    // Pick a polygon with probability proportional to its area and a uniform point on it. frand returns numbers in [0, 1). Return false if there are no
+    // polygons. Safe to call from several threads, also while the sampler is updated.
+    bool Sample(NavigationQuery& query, float (*frand)(), dtPolyRef& ref, Vector3F& point) const;
+
+    // Return total area of the sampled polygons.
+    float GetTotalArea() const;
+
+private:
+    struct SamplerTile
+    {
+        // Polygons passing the filter.
+        std::vector<dtPolyRef> polys_;
+        // Running sum of the polygon areas.
+        std::vector<float> areas_;
+    };
+
+    // Sum the polygon areas of the tile layer.
+    static void BuildTile(const dtNavMesh* navMesh, const dtQueryFilter* filter, const dtMeshTile* tile, SamplerTile& dest);
+
+    // Tile layers by tile key.
+    std::unordered_map<std::uint64_t, std::vector<SamplerTile>> tiles_;
+    // Tile layers with polygons in sampling order.
+    std::vector<const SamplerTile*> sampledTiles_;
+    // Running sum of the areas of sampled tiles.
+    std::vector<float> tileAreas_;
+    // Tiles to update.
+    std::unordered_set<std::uint64_t> dirtyTiles_;
+    // Whether everything must be summed again.
+    bool dirtyAll_{true};
+    // Filter of the last update and its flags, compared by value as the same object may be reconfigured.
+    const dtQueryFilter* filter_{};
+    unsigned short includeFlags_{};
+    unsigned short excludeFlags_{};
+    // Guards the sums, shared by the samples on the worker threads and held exclusively by updates.
+    mutable std::shared_mutex mutex_;
+};
+
+}
\ No newline at end of file
@@ -0,0 +1,153 @@
+#include <atomic>
+#include <fstream>
+#include <iomanip>
+#include <random>
+#include <sstream>
+
+#include "../navigation/TileBuildCache.h"
+#include "../navigation/DynamicNavigationMesh.h"
+#include "../utils/UtilsHash.h"
+#include "../utils/UtilsStream.h"
+
+#include <spdlog/spdlog.h>
+
+#include <DetourAlloc.h>
+
+namespace WorldAssistant
+{
+
+static const char* TILE_BUILD_CACHE_FILE_ID = "NTLC";
+// Largest layer accepted from an entry, anything bigger is a damaged file.
+static const std::int32_t TILE_BUILD_CACHE_MAX_LAYER_SIZE = 16 * 1024 * 1024;
+
+// Return suffix of a temporary entry file that no other thread, process or machine writing to the directory picks.
+static std::string MakeTempSuffix()
+{
+    // A random token tells apart the processes sharing the directory, the counter the writes of this process
+    static const std::uint64_t processToken = (static_cast<std::uint64_t>(std::random_device{}()) << 32u) | std::random_device{}();
+    static std::atomic<std::uint64_t> nextWrite{ 0u };
+
+    std::ostringstream suffix;
+    suffix << "." << std::hex << processToken << "." << nextWrite++ << ".tmp";
+    return suffix.str();
+}
+
+TileBuildCache::TileBuildCache(const std::filesystem::path& directory) :
+    directory_(directory)
+{
+}
+
+int TileBuildCache::Read(std::uint64_t hash, TileCacheData* tiles, int maxTiles) const
+{
+    std::ifstream stream(GetEntryPath(hash), std::ios::in | std::ios::binary);
+    if (!stream.is_open())
+        return -1;
+
+    InputFileStream input(stream);
+    if (input.ReadFileID() != TILE_BUILD_CACHE_FILE_ID)
+        return -1;
+
+    const std::int32_t numTiles = input.ReadInt();
+    if (!stream || numTiles < 0 || numTiles > maxTiles)
+        return -1;
+
+    std::uint64_t checksum = HASH_SEED;
+    std::int32_t numRead = 0;
+    for (; numRead < numTiles; ++numRead)
+    {
+        const std::int32_t dataSize = input.ReadInt();
+        auto* data = stream && dataSize > 0 && dataSize <= TILE_BUILD_CACHE_MAX_LAYER_SIZE ?
+            static_cast<unsigned char*>(dtAlloc(dataSize, DT_ALLOC_PERM)) : nullptr;
+
+        if (data)
+            input.Read(data, static_cast<std::size_t>(dataSize));
+
+        if (!data || !stream)
+        {
+            dtFree(data);
+            break;
+        }
+
+        HashValue(checksum, dataSize);
+        HashBytes(checksum, data, static_cast<std::size_t>(dataSize));
+
+        tiles[numRead].data = data;
+        tiles[numRead].dataSize = dataSize;
+    }
+
+    // A damaged entry is built again and overwritten. Entries written before the checksum was stored fail it as well.
+    if (numRead < numTiles || input.ReadUInt64() != checksum || !stream)
+    {
+        for (std::int32_t i = 0; i < numRead; ++i)
+        {
+            dtFree(tiles[i].data);
+            tiles[i] = TileCacheData{};
+        }
+
+        return -1;
+    }
+
+    return numTiles;
+}
+
+bool TileBuildCache::Write(std::uint64_t hash, const TileCacheData* tiles, int numTiles) const
+{
+    std::error_code error;
+    std::filesystem::create_directories(directory_, error);
+
+    // Readers on other threads or machines must never see a half-written entry, so it is renamed into place once complete
+    const std::filesystem::path path = GetEntryPath(hash);
+    std::filesystem::path tempPath = path;
+    tempPath += MakeTempSuffix();
+
+    {
+        std::ofstream stream(tempPath, std::ios::out | std::ios::binary);
+        if (!stream.is_open())
+        {
+            spdlog::warn("Could not write tile build cache entry {}", path.string());
+            return false;
+        }
+
+        OutputFileStream output(stream);
+        output.WriteFileID(TILE_BUILD_CACHE_FILE_ID);
+        output.WriteInt(numTiles);
+
+        // Layers are checked against the checksum when read, a damaged file must not reach the tile cache
+        std::uint64_t checksum = HASH_SEED;
+        for (int i = 0; i < numTiles; ++i)
+        {
+            output.WriteInt(tiles[i].dataSize);
+            output.Write(tiles[i].data, static_cast<std::size_t>(tiles[i].dataSize));
+
+            HashValue(checksum, tiles[i].dataSize);
+            HashBytes(checksum, tiles[i].data, static_cast<std::size_t>(tiles[i].dataSize));
+        }
+
+        output.WriteUInt64(checksum);
+
+        if (!stream)
+        {
+            stream.close();
+            std::filesystem::remove(tempPath, error);
+            return false;
+        }
+    }
+
+    std::filesystem::rename(tempPath, path, error);
+    if (error)
+    {
+        std::filesystem::remove(tempPath, error);
+        return false;
+    }
+
+    return true;
+}
+
+std::filesystem::path TileBuildCache::GetEntryPath(std::uint64_t hash) const
+{
+    std::ostringstream name;
+    name << std::hex << std::setw(16) << std::setfill('0') << hash << ".tile";
+    return directory_ / name.str();
+}
+
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+
+namespace WorldAssistant
+{
+
+struct TileCacheData;
+
+// Directory of compressed tile layers named by the hash of everything they are built from. Builds on any machine with the same world data and settings
+// find the layers of unchanged tiles there and skip Recast for them. Entries are never removed, the directory can be deleted at any time.
+class TileBuildCache
+{
+public:
+    // Construct over the directory, created on the first write.
+    explicit TileBuildCache(const std::filesystem::path& directory);
+
+    // Read the layers built from the input hash into tiles, allocated with dtAlloc. Return number of layers, or -1 if they are not cached.
+    int Read(std::uint64_t hash, TileCacheData* tiles, int maxTiles) const;
+    // Store the layers built from the input hash. Return true if successful.
+    bool Write(std::uint64_t hash, const TileCacheData* tiles, int numTiles) const;
+
+    // Return the cache directory.
+    const std::filesystem::path& GetDirectory() const { return directory_; }
+
+private:
+    // Return path of the entry of the input hash.
+    std::filesystem::path GetEntryPath(std::uint64_t hash) const;
+
+    // Cache directory.
+    std::filesystem::path directory_;
+};
+
+}
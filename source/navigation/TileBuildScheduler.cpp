@@ -0,0 +1,55 @@
+#include <algorithm>
+
+#include "../navigation/TileBuildScheduler.h"
+
+namespace WorldAssistant
+{
+
+void TileBuildScheduler::Reset(const std::vector<std::uint64_t>& costs, std::uint32_t windowSize)
+{
+    const std::lock_guard<std::mutex> lock(mutex_);
+
+    costs_ = costs;
+    open_ = {};
+    windowEnd_ = 0;
+    windowSize_ = std::max(windowSize, 1u);
+    numCommitted_ = 0;
+
+    FillWindow();
+}
+
+bool TileBuildScheduler::Next(std::uint32_t& tileIdx)
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    // An empty window is refilled by the committer, unless every tile has entered it already
+    windowCondition_.wait(lock, [this] { return !open_.empty() || windowEnd_ == costs_.size(); });
+    if (open_.empty())
+        return false;
+
+    // Tile indices are stored negated, so of equally heavy tiles the one committed first comes first
+    tileIdx = static_cast<std::uint32_t>(-open_.top().second);
+    open_.pop();
+    return true;
+}
+
+void TileBuildScheduler::Advance(std::uint32_t numCommitted)
+{
+    {
+        const std::lock_guard<std::mutex> lock(mutex_);
+        numCommitted_ = std::max(numCommitted_, numCommitted);
+        FillWindow();
+    }
+
+    windowCondition_.notify_all();
+}
+
+void TileBuildScheduler::FillWindow()
+{
+    const std::uint32_t numTiles = static_cast<std::uint32_t>(costs_.size());
+    const std::uint32_t end = static_cast<std::uint32_t>(std::min<std::uint64_t>(static_cast<std::uint64_t>(numCommitted_) + windowSize_, numTiles));
+    for (; windowEnd_ < end; ++windowEnd_)
+        open_.emplace(costs_[windowEnd_], -static_cast<std::int64_t>(windowEnd_));
+}
+
+}
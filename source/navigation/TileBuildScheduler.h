@@ -0,0 +1,44 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <queue>
+#include <vector>
+
+namespace WorldAssistant
+{
+
+// Tiles of a parallel build handed out by estimated cost, heaviest first, within a window ahead of the next tile to commit. Tiles are committed in tile
+// index order, so the window bounds how far the workers run ahead of the committer while still starting the expensive tiles of dense areas early.
+class TileBuildScheduler
+{
+public:
+    // Start handing out the tiles, at most windowSize tiles ahead of the next tile to commit. Costs are indexed by tile index.
+    void Reset(const std::vector<std::uint64_t>& costs, std::uint32_t windowSize);
+
+    // Take the heaviest tile of the window, waiting for the window to advance if all of its tiles are taken. Return false when all tiles have been taken.
+    bool Next(std::uint32_t& tileIdx);
+    // Advance the window once the tiles before the given tile index are committed.
+    void Advance(std::uint32_t numCommitted);
+
+private:
+    // Add the tiles entering the window to the open tiles. Requires the lock.
+    void FillWindow();
+
+    std::mutex mutex_;
+    // Signals an advance of the window.
+    std::condition_variable windowCondition_;
+    // Cost of every tile by tile index.
+    std::vector<std::uint64_t> costs_;
+    // Tiles of the window not taken yet, as cost and tile index. The heaviest is on top, ties go to the lower tile index.
+    std::priority_queue<std::pair<std::uint64_t, std::int64_t>> open_;
+    // First tile past the window.
+    std::uint32_t windowEnd_{};
+    // Number of tiles the window may span.
+    std::uint32_t windowSize_{};
+    // Number of tiles committed.
+    std::uint32_t numCommitted_{};
+};
+
+}
@@ -0,0 +1,143 @@
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+#include "../navigation/TileGeometryStore.h"
+#include "../navigation/NavBuildData.h"
+#include "../game/Collision.h"
+#include "../scene/Scene.h"
+#include "../scene/World.h"
+
+#include <spdlog/spdlog.h>
+
+namespace WorldAssistant
+{
+
+void TileGeometryStore::Build(World* world, std::int32_t interior, const BoundingBox& bounds, float tileEdgeLength, int numTilesX, int numTilesZ, float border)
+{
+    Clear();
+
+    numTilesX_ = numTilesX;
+    numTilesZ_ = numTilesZ;
+
+    Scene* scene = world->GetScene();
+    assert(scene);
+
+    BoundingBox queryBounds = bounds;
+    std::vector<const SceneNode*> nodes;
+    scene->Query(&queryBounds.min_.x_, nodes);
+
+    for (const auto& node : nodes) {
+        if (node->GetInterior() != interior)
+            continue;
+
+        auto* collision = world->GetModelCollision(node->GetModel());
+        if (!collision || collision->Empty()) {
+            spdlog::warn("Could not find a collision for model {}", node->GetModel());
+            continue;
+        }
+
+        collision->Unpack(vertices_, indices_, node->GetTransform(), static_cast<std::int32_t>(vertices_.size()));
+    }
+
+    // Range of tiles the grown tiles of which the triangle overlaps, false if none
+    const auto getTileRange = [&](std::size_t triangle, Int32Vector2& from, Int32Vector2& to) {
+        const Vector3F& a = vertices_[indices_[triangle * 3]];
+        const Vector3F& b = vertices_[indices_[triangle * 3 + 1]];
+        const Vector3F& c = vertices_[indices_[triangle * 3 + 2]];
+
+        const float minX = std::min({ a.x_, b.x_, c.x_ }) - border - bounds.min_.x_;
+        const float maxX = std::max({ a.x_, b.x_, c.x_ }) + border - bounds.min_.x_;
+        const float minZ = std::min({ a.z_, b.z_, c.z_ }) - border - bounds.min_.z_;
+        const float maxZ = std::max({ a.z_, b.z_, c.z_ }) + border - bounds.min_.z_;
+
+        from.x_ = std::max(static_cast<int>(std::floor(minX / tileEdgeLength)), 0);
+        from.y_ = std::max(static_cast<int>(std::floor(minZ / tileEdgeLength)), 0);
+        to.x_ = std::min(static_cast<int>(std::floor(maxX / tileEdgeLength)), numTilesX_ - 1);
+        to.y_ = std::min(static_cast<int>(std::floor(maxZ / tileEdgeLength)), numTilesZ_ - 1);
+
+        return from.x_ <= to.x_ && from.y_ <= to.y_;
+    };
+
+    const std::size_t numTriangles = indices_.size() / 3;
+    const std::size_t numTiles = static_cast<std::size_t>(numTilesX_) * static_cast<std::size_t>(numTilesZ_);
+
+    // Count the triangles of every tile first, so all bins fit in one array
+    binOffsets_.assign(numTiles + 1, 0u);
+    Int32Vector2 from;
+    Int32Vector2 to;
+    for (std::size_t i = 0; i < numTriangles; ++i) {
+        if (!getTileRange(i, from, to))
+            continue;
+
+        for (int z = from.y_; z <= to.y_; ++z) {
+            for (int x = from.x_; x <= to.x_; ++x)
+                ++binOffsets_[z * numTilesX_ + x + 1];
+        }
+    }
+
+    for (std::size_t i = 0; i < numTiles; ++i)
+        binOffsets_[i + 1] += binOffsets_[i];
+
+    binTriangles_.resize(binOffsets_[numTiles]);
+    std::vector<std::uint32_t> binEnds(binOffsets_.begin(), binOffsets_.end() - 1);
+    for (std::size_t i = 0; i < numTriangles; ++i) {
+        if (!getTileRange(i, from, to))
+            continue;
+
+        for (int z = from.y_; z <= to.y_; ++z) {
+            for (int x = from.x_; x <= to.x_; ++x)
+                binTriangles_[binEnds[z * numTilesX_ + x]++] = static_cast<std::uint32_t>(i);
+        }
+    }
+
+    spdlog::info("Binned {} collision triangles into {} tiles, {} references", numTriangles, numTiles, binTriangles_.size());
+}
+
+void TileGeometryStore::Clear()
+{
+    vertices_.clear();
+    vertices_.shrink_to_fit();
+    indices_.clear();
+    indices_.shrink_to_fit();
+    binOffsets_.clear();
+    binOffsets_.shrink_to_fit();
+    binTriangles_.clear();
+    binTriangles_.shrink_to_fit();
+    numTilesX_ = 0;
+    numTilesZ_ = 0;
+}
+
+void TileGeometryStore::GetTileGeometry(NavBuildData* build, int x, int z) const
+{
+    if (x < 0 || z < 0 || x >= numTilesX_ || z >= numTilesZ_)
+        return;
+
+    const std::size_t tileIdx = static_cast<std::size_t>(z) * numTilesX_ + x;
+    const std::uint32_t begin = binOffsets_[tileIdx];
+    const std::uint32_t end = binOffsets_[tileIdx + 1];
+
+    // Triangles are copied with their own vertices, the tile does not need to know which ones they share
+    std::int32_t startIndex = static_cast<std::int32_t>(build->vertices_.size());
+    build->vertices_.reserve(build->vertices_.size() + (end - begin) * 3u);
+    build->indices_.reserve(build->indices_.size() + (end - begin) * 3u);
+
+    for (std::uint32_t i = begin; i < end; ++i) {
+        const std::size_t triangle = binTriangles_[i];
+        for (std::size_t j = 0; j < 3; ++j) {
+            build->vertices_.push_back(vertices_[indices_[triangle * 3 + j]]);
+            build->indices_.push_back(startIndex++);
+        }
+    }
+}
+
+unsigned TileGeometryStore::GetNumTriangles(int x, int z) const
+{
+    if (x < 0 || z < 0 || x >= numTilesX_ || z >= numTilesZ_)
+        return 0u;
+
+    const std::size_t tileIdx = static_cast<std::size_t>(z) * numTilesX_ + x;
+    return binOffsets_[tileIdx + 1] - binOffsets_[tileIdx];
+}
+
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "../utils/MathUtils.h"
+
+namespace WorldAssistant
+{
+
+class World;
+struct NavBuildData;
+
+// World-space collision triangles of an interior, transformed once and binned by the tiles of a navigation mesh. A full build slices the geometry of every
+// tile out of it instead of unpacking the collisions of all overlapping scene nodes again for each tile they overlap.
+class TileGeometryStore
+{
+public:
+    // Transform the collisions of the scene nodes of the interior within the bounds and bin their triangles by the tile grid starting at the bounds minimum.
+    // A triangle is binned to every tile it overlaps once the tile is grown by the border on both horizontal axes.
+    void Build(World* world, std::int32_t interior, const BoundingBox& bounds, float tileEdgeLength, int numTilesX, int numTilesZ, float border);
+    // Remove everything.
+    void Clear();
+
+    // Append the triangles binned to the tile to the build data.
+    void GetTileGeometry(NavBuildData* build, int x, int z) const;
+    // Return number of triangles binned to the tile.
+    unsigned GetNumTriangles(int x, int z) const;
+
+private:
+    // Transformed vertices of all scene nodes.
+    std::vector<Vector3F> vertices_;
+    // Triangle indices into vertices_.
+    std::vector<std::int32_t> indices_;
+    // Start of the triangles of every tile in binTriangles_ by tile index, followed by the end of the last one.
+    std::vector<std::uint32_t> binOffsets_;
+    // Triangles of every tile in ascending order, tile after tile.
+    std::vector<std::uint32_t> binTriangles_;
+    // Number of tiles in X direction.
+    int numTilesX_{};
+    // Number of tiles in Z direction.
+    int numTilesZ_{};
+};
+
+}
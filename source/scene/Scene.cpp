@@ -68,7 +68,8 @@ void SceneNode::SetRotation(const glm::quat& rot)
 
 Scene::Scene(World* world) : 
     owner_(world),
-    tree_(Rect(-5000, -5000, 5000, 5000))
+    tree_(Rect(-5000, -5000, 5000, 5000)),
+    navAreaTree_(Rect(-5000, -5000, 5000, 5000))
 {
 }
 
@@ -89,6 +90,7 @@ bool Scene::Load(const std::filesystem::path& path)
     }
 
     bounds_.Clear();
+    interiorBounds_.clear();
  
     for (pugi::xml_node tool = root.child("entry"); tool; tool = tool.next_sibling("entry"))
     {
@@ -105,7 +107,8 @@ bool Scene::Load(const std::filesystem::path& path)
 	    transform[3][1] = tool.attribute("posY").as_float();
 	    transform[3][2] = tool.attribute("posZ").as_float();       
 
-        AddNode(model, transform);       
+        // Scenes saved before interiors were kept have no interior attribute, their nodes are all outside
+        AddNode(model, transform, tool.attribute("interior").as_int());       
     }
 
     return true;
@@ -140,6 +143,9 @@ bool Scene::Save(const std::filesystem::path& filename)
 		entryNode.append_attribute("rotY") = rotation.y;
 		entryNode.append_attribute("rotZ") = rotation.z;
 		entryNode.append_attribute("rotW") = rotation.w;
+		if (node->GetInterior() != 0) {
+			entryNode.append_attribute("interior") = node->GetInterior();
+		}
     }
 
     std::ofstream stream(filename);
@@ -148,7 +154,7 @@ bool Scene::Save(const std::filesystem::path& filename)
     return true;
 }
 
-SceneNode* Scene::AddNode(uint32_t model, const glm::mat4& transform)
+SceneNode* Scene::AddNode(uint32_t model, const glm::mat4& transform, int32_t interior)
 {
     const auto* collision = owner_->GetModelCollision(model);
     if (!collision) {
@@ -160,12 +166,14 @@ SceneNode* Scene::AddNode(uint32_t model, const glm::mat4& transform)
 
     SceneNode* node = new SceneNode;
     node->model_ = model;
+    node->interior_ = interior;
     node->transform_ = transform;
     node->box_.Define(Vector2F(bounds.min_.x_, bounds.min_.z_), 
         Vector2F(bounds.max_.x_, bounds.max_.z_));
     node->dirty_ = false;
  
     bounds_.Merge(bounds);        
+    interiorBounds_[interior].Merge(bounds);
     nodes_.InsertFront(node);
     tree_.Add(node);
 
@@ -186,6 +194,47 @@ void Scene::Query(float* bounds, std::vector<const SceneNode*>& result)
     }
 }
 
+bool Scene::AddNavArea(std::shared_ptr<NavArea> area)
+{
+    if (!area || area->GetAreaID() == 0) {
+        return false;
+    }
+
+    navAreaTree_.Add(area.get());
+    navAreas_.push_back(std::move(area));
+    return true;
+}
+
+void Scene::RemoveNavArea(NavArea* area)
+{
+    auto it = std::find_if(navAreas_.begin(), navAreas_.end(), [area](const auto& entry) { return entry.get() == area; });
+    if (it == navAreas_.end()) {
+        return;
+    }
+
+    navAreaTree_.Remove(area);
+    navAreas_.erase(it);
+}
+
+void Scene::QueryNavAreas(const BoundingBox& box, std::vector<const NavArea*>& result) const
+{
+    result.clear();
+
+    auto results = navAreaTree_.Query(Rect(box.min_.x_, box.min_.z_, box.max_.x_, box.max_.z_));
+    for (const auto& entry : results) {
+        const auto* area = static_cast<const NavArea*>(entry);
+        if (area->IsEnabled() && area->GetBoundingBox().min_.y_ <= box.max_.y_ && area->GetBoundingBox().max_.y_ >= box.min_.y_) {
+            result.push_back(area);
+        }
+    }
+}
+
+BoundingBox Scene::GetInteriorBounds(int32_t interior) const
+{
+    auto found = interiorBounds_.find(interior);
+    return found != interiorBounds_.end() ? found->second : BoundingBox();
+}
+
 bool Scene::Empty() const
 {
     return false;
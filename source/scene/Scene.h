@@ -1,6 +1,7 @@
 #pragma once
 
 #include <filesystem>
+#include <unordered_map>
 
 #include <glm/glm.hpp>
 
@@ -61,7 +62,7 @@ public:
 
 	bool Save(const std::filesystem::path& filename);
 
-	SceneNode* AddNode(uint32_t model, const glm::mat4& transform = {});
+	SceneNode* AddNode(uint32_t model, const glm::mat4& transform = {}, int32_t interior = 0);
 
 	void RemoveNode(SceneNode* node);
 
@@ -75,8 +76,19 @@ public:
 
 	const std::vector<std::shared_ptr<NavArea>>& GetNavAreas() const { return navAreas_; }
 
+	// Add an area volume. Return false for an area ID of zero, which would cut the volume out of the navigation mesh.
+	bool AddNavArea(std::shared_ptr<NavArea> area);
+
+	void RemoveNavArea(NavArea* area);
+
+	// Collect enabled navigation areas intersecting the box.
+	void QueryNavAreas(const BoundingBox& box, std::vector<const NavArea*>& result) const;
+
 	const BoundingBox& GetBounds() const { return bounds_; }
 
+	// Return bounding box of the nodes in the interior, undefined if there are none.
+	BoundingBox GetInteriorBounds(int32_t interior) const;
+
 private:
 	World* owner_{};
 
@@ -90,7 +102,12 @@ private:
 
 	std::vector<std::shared_ptr<NavArea>> navAreas_;
 
+	Quadtree navAreaTree_;
+
 	BoundingBox bounds_;
+
+	// Bounding boxes of the nodes by interior.
+	std::unordered_map<int32_t, BoundingBox> interiorBounds_;
 };
 
 }
\ No newline at end of file
@@ -169,6 +169,12 @@ public:
 	{
 	}
 
+    // Test for equality with another vector.
+    bool operator ==(const IntVector3<T>& rhs) const { return x_ == rhs.x_ && y_ == rhs.y_ && z_ == rhs.z_; }
+
+    // Test for inequality with another vector.
+    bool operator !=(const IntVector3<T>& rhs) const { return x_ != rhs.x_ || y_ != rhs.y_ || z_ != rhs.z_; }
+
 	T x_;
 	T y_;
 	T z_;
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+namespace WorldAssistant
+{
+
+// Initial value of a 64-bit FNV-1a hash.
+static const std::uint64_t HASH_SEED = 14695981039346656037ull;
+
+// Fold bytes into a 64-bit FNV-1a hash. The result is the same on every platform and run, so it can be stored in files.
+inline void HashBytes(std::uint64_t& hash, const void* data, std::size_t size)
+{
+    const auto* bytes = static_cast<const std::uint8_t*>(data);
+    for (std::size_t i = 0; i < size; ++i)
+    {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+}
+
+// Fold a value without padding bytes into a 64-bit FNV-1a hash.
+template <class T> void HashValue(std::uint64_t& hash, const T& value)
+{
+    HashBytes(hash, &value, sizeof(T));
+}
+
+// Fold the elements of a vector into a 64-bit FNV-1a hash. Elements must not have padding bytes.
+template <class T> void HashVector(std::uint64_t& hash, const std::vector<T>& values)
+{
+    const std::uint64_t size = values.size();
+    HashValue(hash, size);
+    HashBytes(hash, values.data(), values.size() * sizeof(T));
+}
+
+}